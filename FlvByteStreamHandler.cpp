@@ -10,7 +10,7 @@ HRESULT FlvByteStreamHandler::BeginCreateObject(
     /* [in] */ IMFByteStream *pByteStream,
     /* [in] */ LPCWSTR /*pwszURL*/,
     /* [in] */ DWORD dwFlags,
-    /* [in] */ IPropertyStore * /*pProps*/,
+    /* [in] */ IPropertyStore *pProps,
     /* [out] */ IUnknown **ppIUnknownCancelCookie,  // Can be NULL
     /* [in] */ IMFAsyncCallback *pCallback,
     /* [in] */ IUnknown *punkState                  // Can be NULL
@@ -38,6 +38,18 @@ HRESULT FlvByteStreamHandler::BeginCreateObject(
     hr = MFCreateAsyncResult(NULL, pCallback, punkState, &pResult);
   }
 
+  // Follow a file which is still being recorded.
+  if (SUCCEEDED(hr) && pProps)
+  {
+    PROPVARIANT follow;
+    PropVariantInit(&follow);
+    if (SUCCEEDED(pProps->GetValue(MFPKEY_FLVSOURCE_FOLLOW_MODE, &follow)) && follow.vt == VT_BOOL)
+    {
+      hr = src->SetFollowMode(follow.boolVal == VARIANT_TRUE);
+    }
+    PropVariantClear(&follow);
+  }
+
   // Start opening the source. This is an async operation.
   // When it completes, the source will invoke our callback
   // and then we will invoke the caller's callback.
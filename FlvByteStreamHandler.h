@@ -1,7 +1,14 @@
 #pragma once
 #include <wrl.h>
+#include <propsys.h>
 using namespace Microsoft::WRL;
 
+// VT_BOOL in the property store passed to BeginCreateObject
+// VARIANT_TRUE: the file is still being recorded, follow it as it grows
+// {5C1A7F0E-3B2D-4E61-9A47-21D86E0B93C4}, 1
+__declspec(selectany) extern const PROPERTYKEY MFPKEY_FLVSOURCE_FOLLOW_MODE =
+  { { 0x5c1a7f0e, 0x3b2d, 0x4e61, { 0x9a, 0x47, 0x21, 0xd8, 0x6e, 0x0b, 0x93, 0xc4 } }, 1 };
+
 // Byte-stream handler for Flv streams.
 class __declspec(uuid("EFE6208A-0A2C-49fa-8A01-3768B559B6DA"))
 FlvByteStreamHandler
@@ -88,6 +88,7 @@ HRESULT flv_parser::tag_header(::tag_header*header){
     header->type = flv::tag_type::eof;
     return S_OK;
   }
+  flv::instrument_count(flv::counter::tags);
   auto f = reader.byte();
   header->type = flv::tag_type(f &  flv::flv_tag_header_type_mask);
   header->filter = (f & (1 << flv::flv_tag_header_filter_mask)) >> flv::flv_tag_header_filter_mask;
@@ -107,7 +108,7 @@ HRESULT flv_parser::skip_previsou_tag_size(){
 HRESULT flv_parser::begin_tag_header(int8_t withprevfield, IMFAsyncCallback*cb, IUnknown*s){
   if (withprevfield)
     skip_previsou_tag_size();
-  return begin_read<::tag_header>(cb, s, flv::flv_tag_header_length, &flv_parser::tag_header);
+  return begin_read<::tag_header>(cb, s, flv::flv_tag_header_length, &flv_parser::tag_header, true);
 }
 HRESULT flv_parser::end_tag_header(IMFAsyncResult*result, ::tag_header*v){
   return end_read<::tag_header>(result, v);
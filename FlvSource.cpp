@@ -4,6 +4,7 @@
 #include "avcc.hpp"
 #include "prop_variant.hpp"
 #include "flvstream.h"
+#include "flv_reader.hpp"
 #pragma comment(lib, "mfplat")
 #pragma comment(lib, "mfuuid")      // Media Foundation GUIDs
 #pragma comment(lib, "strmiids")    // DirectShow GUIDs
@@ -19,6 +20,30 @@ HRESULT NewMFMediaBuffer(const uint8_t*data, uint32_t length, IMFMediaBuffer **r
 HRESULT NewNaluBuffer(uint8_t nallength, packet const&nalu, IMFMediaBuffer **rtn);
 IMFMediaStreamExtPtr to_stream_ext(IMFMediaStreamPtr &);
 
+const LONGLONG follow_poll_interval = 500;  // milliseconds between byte stream length checks in follow mode
+#ifndef MFBYTESTREAM_HAS_SLOW_SEEK
+#define MFBYTESTREAM_HAS_SLOW_SEEK 0x00000100  // mfobjects.h, windows 7 and later
+#endif
+
+// synchronous reads at a position, used at open for the few bytes at the end of the file
+struct byte_stream_source : public flv::byte_source{
+  explicit byte_stream_source(IMFByteStream*s) : stream(s){}
+  int64_t read(uint64_t pos, void*data, uint32_t length) override{
+    ULONG cb = 0;
+    auto hr = stream->SetCurrentPosition(pos);
+    if (ok(hr))
+      hr = stream->Read(static_cast<BYTE*>(data), length, &cb);
+    return ok(hr) ? int64_t(cb) : -1;
+  }
+  int32_t size(uint64_t*v) override{
+    QWORD length = 0;
+    auto hr = stream->GetLength(&length);
+    *v = length;
+    return ok(hr) ? 0 : -1;
+  }
+  IMFByteStream*stream;
+};
+
 struct scope_lock {
   FlvSource* pthis;
   explicit scope_lock(FlvSource* pt) : pthis(pt) { pthis->Lock(); }
@@ -214,6 +239,10 @@ HRESULT FlvSource::Shutdown() {
     auto vs = to_stream_ext(video_stream);// static_cast<FlvStream*>(video_stream.Get());
     vs->Shutdown();
   }
+  if (follow_poll_key) {
+    (void)MFCancelWorkItem(follow_poll_key);
+    follow_poll_key = 0;
+  }
   // Shut down the event queue.
   if (event_queue) {
     (void)event_queue->Shutdown();
@@ -277,9 +306,10 @@ HRESULT FlvSource::Start(
 HRESULT FlvSource::AsyncStart(IMFPresentationDescriptor* pd, PROPVARIANT const*startpos){
   IMFPresentationDescriptorPtr spd(pd);
   _prop_variant_t spos = startpos;
-  return AsyncDo(MFAsyncCallback::New([spd, spos, this](IMFAsyncResult*result)->HRESULT{
+  auto generation = seeks.request(startpos->vt == VT_I8 ? static_cast<uint32_t>(startpos->hVal.QuadPart / 10000) : 0);  // nano to millis
+  return AsyncDo(MFAsyncCallback::New([spd, spos, generation, this](IMFAsyncResult*result)->HRESULT{
     scope_lock l(this);
-    auto hr = this->DoStart(spd.Get(), &spos);
+    auto hr = this->DoStart(spd.Get(), &spos, generation);
     result->SetStatus(hr);
     return S_OK;
   }).Get(), static_cast<IMFMediaSource*>(this));  // state add this's ref
@@ -343,7 +373,9 @@ HRESULT FlvSource::BeginOpen(IMFByteStream *pStream, IMFAsyncCallback *pCB, IUnk
 
     // Cache the byte-stream pointer.
     byte_stream = pStream;
+    auto follow = status.follow;
     ZeroMemory(&status, sizeof(status));  // reset all status flags
+    status.follow = follow;
     // todo: do other initializations here
 
     // Validate the capabilities of the byte stream.
@@ -357,6 +389,12 @@ HRESULT FlvSource::BeginOpen(IMFByteStream *pStream, IMFAsyncCallback *pCB, IUnk
       } else if ((dwCaps & MFBYTESTREAM_IS_READABLE) == 0) {
         hr = E_FAIL;
       }
+      // content is still being downloaded or recorded
+      if (dwCaps & MFBYTESTREAM_IS_PARTIALLY_DOWNLOADED)
+        status.follow = 1;
+      // the tail is read synchronously while opening, only where that costs two local reads
+      if ((dwCaps & (MFBYTESTREAM_IS_REMOTE | MFBYTESTREAM_HAS_SLOW_SEEK)) == 0)
+        status.fast_seek = 1;
     }
 
     // Create an async result object. We'll use it later to invoke the callback.
@@ -379,6 +417,22 @@ HRESULT FlvSource::BeginOpen(IMFByteStream *pStream, IMFAsyncCallback *pCB, IUnk
     return hr;
 }
 
+//-------------------------------------------------------------------
+// SetFollowMode
+// Follow a file which is still being written. At end of file the
+// source waits for the byte stream to grow instead of ending the
+// presentation. Must be called before BeginOpen.
+//-------------------------------------------------------------------
+
+HRESULT FlvSource::SetFollowMode(BOOL follow)
+{
+  scope_lock l(this);
+  if (m_state != SourceState::STATE_INVALID)
+    return MF_E_INVALIDREQUEST;
+  status.follow = follow ? 1 : 0;
+  return S_OK;
+}
+
 HRESULT FlvSource::ReadFlvHeader() {
   auto hr = parser.begin_flv_header(byte_stream, &on_flv_header, nullptr);
   return hr;
@@ -389,7 +443,7 @@ HRESULT FlvSource::OnFlvHeader(IMFAsyncResult *result){
   auto hr = parser.end_flv_header(result, &v);
   scope_lock l(this);
   if (FAILED(hr)) { 
-    StreamingError(hr);
+    ReadFailed(hr);
   } else {
     header.status.file_header_ready = 1;
     ReadFlvTagHeader();
@@ -397,6 +451,7 @@ HRESULT FlvSource::OnFlvHeader(IMFAsyncResult *result){
   return S_OK;
 }
 HRESULT FlvSource::ReadFlvTagHeader() {
+  byte_stream->GetCurrentPosition(&tag_position);
   auto hr = parser.begin_tag_header(1, &on_tag_header, nullptr);
   return hr;
 }
@@ -405,7 +460,7 @@ HRESULT FlvSource::OnFlvTagHeader(IMFAsyncResult *result){
   auto hr = parser.end_tag_header(result, &tagh);
   scope_lock l(this);
   if (FAILED(hr)) {
-    StreamingError(hr);
+    ReadFailed(hr);
     return S_OK;
   }
   if (tagh.type == flv::tag_type::script_data && !status.on_meta_data_ready){
@@ -416,24 +471,29 @@ HRESULT FlvSource::OnFlvTagHeader(IMFAsyncResult *result){
     header.status.has_video = 1;
     if (!header.first_media_tag_offset)
       header.first_media_tag_offset = tagh.data_offset - flv::flv_tag_header_length;
-    if(status.first_video_tag_ready)
-      SeekToNextTag(tagh);
-    else ReadVideoHeader(tagh);
+    if (!status.first_video_tag_ready)
+      ReadVideoHeader(tagh);
+    else if (ok(SeekToNextTag(tagh)))
+      ReadFlvTagHeader();
   }
   else if (tagh.type == flv::tag_type::audio){
     header.status.has_audio = 1;
     if (!header.first_media_tag_offset)
       header.first_media_tag_offset = tagh.data_offset - flv::flv_tag_header_length;
-    if (status.first_audio_tag_ready)
-      SeekToNextTag(tagh);
-    else ReadAudioHeader(tagh);
+    if (!status.first_audio_tag_ready)
+      ReadAudioHeader(tagh);
+    else if (ok(SeekToNextTag(tagh)))
+      ReadFlvTagHeader();
+  }
+  else if (tagh.type == flv::tag_type::eof && status.follow){  // media tags not written yet
+    WaitForGrowth();
   }
   else if (tagh.type == flv::tag_type::eof){  // first round scan done
     header.status.scan_once = 1;
     StreamingError(MF_E_INVALID_FILE_FORMAT);
   }
-  else {
-    SeekToNextTag(tagh);// ignore unknown tags
+  else if (ok(SeekToNextTag(tagh))){  // ignore unknown tags
+    ReadFlvTagHeader();
   }
   return S_OK;
 }
@@ -494,7 +554,8 @@ FlvSource::FlvSource() :
     on_audio_data(this, &FlvSource::OnAudioData),
     on_avc_packet_type(this, &FlvSource::OnAvcPacketType),
     on_video_data(this, &FlvSource::OnVideoData),
-    on_video_header(this, &FlvSource::OnVideoHeader)
+    on_video_header(this, &FlvSource::OnVideoHeader),
+    on_follow_poll(this, &FlvSource::OnFollowPoll)
 {
   ZeroMemory(&status, sizeof(status));
 
@@ -601,13 +662,15 @@ HRESULT FlvSource::InitPresentationDescriptor()
 
     // Create the presentation descriptor.
     hr = MFCreatePresentationDescriptor(cStreams, ppSD,      &presentation_descriptor);
-    if (ok(hr))
-      hr = presentation_descriptor->SetUINT64(MF_PD_DURATION, header.duration * 10000000ull);  // seconds to 100 nano
+    // duration and file size of a file being recorded are open-ended
+    if (ok(hr) && !status.follow)
+      hr = presentation_descriptor->SetUINT64(MF_PD_DURATION, status.tail_ready ? header.last_timestamp * 10000ull  // millis to 100 nano
+                                                                                : header.duration * 10000000ull);    // seconds to 100 nano
     if (ok(hr))
       hr = presentation_descriptor->SetUINT32(MF_PD_AUDIO_ENCODING_BITRATE, header.audiodatarate);
     if (ok(hr))
       hr = presentation_descriptor->SetUINT32(MF_PD_VIDEO_ENCODING_BITRATE, header.videodatarate);
-    if (ok(hr))
+    if (ok(hr) && !status.follow)
       hr = presentation_descriptor->SetUINT64(MF_PD_TOTAL_FILE_SIZE, header.filesize);
 
     if (FAILED(hr))
@@ -723,18 +786,35 @@ HRESULT FlvSource::ValidateOperation()
 // Start() method fails if the caller requests a seek.
 //-------------------------------------------------------------------
 
-HRESULT FlvSource::DoStart(IMFPresentationDescriptor*pd, PROPVARIANT const*startpos)
+HRESULT FlvSource::DoStart(IMFPresentationDescriptor*pd, PROPVARIANT const*startpos, uint64_t generation)
 {
   auto hr = ValidateOperation();
   assert(ok(hr));  // overlapped operations arenot permitted
   enter_op();
 
+  // starts superseded by a later Start call still get their events, the latest one positions the byte stream
+  flv::seek_request latest;
+  std::vector<flv::seek_request> dropped;
+  if (seeks.current(generation) && seeks.take(&latest, &dropped))
+    started_generation = generation;
+  flv::instrument_count(flv::counter::dropped_seeks, dropped.size());
+
   //startpos->vt == vt_empty) current pos
+  seek_target = 0;
   bool isseek = false;
   bool restart = false;
   keyframe k;
-  if (startpos->vt == VT_I8){
+  if (startpos->vt == VT_I8 && header.keyframes.empty()){
+    k = keyframe{ header.first_media_tag_offset, 0 };  // not seekable, restart from the first media tag
+    pending_seek_file_position = k.position - flv::flv_previous_tag_size_field_length;
+    status.pending_seek = 1;
+    if (m_state != SourceState::STATE_STOPPED)
+      isseek = true;
+  } else if (startpos->vt == VT_I8){
+    // targets beyond the last indexed keyframe are clamped to it,
+    // in follow mode the index grows while the file is demuxed
     k = header.keyframes.seek(startpos->hVal.QuadPart);
+    seek_target = startpos->hVal.QuadPart > k.time ? startpos->hVal.QuadPart : 0;
     pending_seek_file_position = k.position - flv::flv_previous_tag_size_field_length;  // - previous_tag_size
     status.pending_seek = 1;
     if (m_state != SourceState::STATE_STOPPED)
@@ -958,16 +1038,24 @@ HRESULT FlvSource::DoRequestData()
 }
 
 void FlvSource::DemuxSample(){
-  if (!NeedDemux())
-    return;
+  if (!NeedDemux() || !seeks.current(started_generation))
+    return;  // a queued start will position the byte stream
   if (status.pending_seek){
     status.pending_seek = 0;
+    status.pending_skip = 0;
     byte_stream->SetCurrentPosition(pending_seek_file_position);
+    flv::instrument_count(flv::counter::seeks);
   }
+  read_generation = started_generation;
   status.pending_request = 1;
   ReadSampleHeader();
 }
 HRESULT FlvSource::ReadSampleHeader(){
+  if (status.pending_skip){
+    status.pending_skip = 0;
+    byte_stream->SetCurrentPosition(skip_file_position);
+  }
+  byte_stream->GetCurrentPosition(&tag_position);
   auto hr= parser.begin_tag_header(1, &on_demux_sample_header, nullptr);
   if (fail(hr)){
     Shutdown();
@@ -977,24 +1065,64 @@ HRESULT FlvSource::ReadSampleHeader(){
 HRESULT FlvSource::OnSampleHeader(IMFAsyncResult *result){
   tag_header tagh;
   auto hr = parser.end_tag_header(result, &tagh);
-  if (tagh.type == flv::tag_type::eof){
-    hr = EndOfFile();
+  if (Superseded())
+    return S_OK;
+  if (fail(hr)){
+    hr = ReadFailed(hr);
   }
-  else if (tagh.type == flv::tag_type::audio){
+  else if (tagh.type == flv::tag_type::eof){
+    hr = status.follow ? WaitForGrowth() : EndOfFile();
+  }
+  else if (tagh.type == flv::tag_type::audio && StreamActive(audio_stream) && !EndsBeforeTarget(tagh)){
     hr = ReadAudioHeader(tagh);
   }
-  else if (tagh.type == flv::tag_type::video){
+  else if (tagh.type == flv::tag_type::video && StreamActive(video_stream)){
     hr = ReadVideoHeader(tagh);
   }
-  else if (fail(hr)){
-    hr = Shutdown();
-  }
   else {
-    hr = SeekToNextTag(tagh);
+    SkipTag(tagh);
+    hr = ReadSampleHeader();
   }
   return hr;
 }
 
+// audio tags played out before the seek target are skipped like deselected ones.
+// only aac frames have a known duration, 1024 samples
+bool FlvSource::EndsBeforeTarget(tag_header const&tagh){
+  if (!seek_target || header.audiocodecid != flv::audio_codec::aac || !header.audiosamplerate)
+    return false;
+  return tagh.nano_timestamp + 1024 * 10000000ull / header.audiosamplerate <= seek_target;
+}
+
+bool FlvSource::StreamActive(IMFMediaStreamPtr&stream){
+  auto s = to_stream_ext(stream);
+  return s && s->IsActived() == S_OK;
+}
+
+// tags of deselected streams and script tags are stepped over at tag header time,
+// neither codec headers nor payload are read. each skipped tag still costs its header read
+// and one repositioning of the byte stream, to skip_file_position before the next header
+void FlvSource::SkipTag(tag_header const&tagh){
+  status.pending_skip = 1;
+  skip_file_position = tagh.data_offset + tagh.data_size;
+}
+
+// a tag read begun before the latest start is dropped at its next completion, whatever it
+// completed with: a header, data, end of file or a failure. demuxing goes on at the new position
+// if that start already ran, otherwise it waits for it. a start without a position, a resume,
+// reads the dropped tag again from its previous_tag_size field
+bool FlvSource::Superseded(){
+  if (read_generation == started_generation && seeks.current(started_generation))
+    return false;
+  status.pending_request = 0;
+  if (!status.pending_seek){
+    pending_seek_file_position = tag_position;
+    status.pending_seek = 1;
+  }
+  DemuxSample();
+  return true;
+}
+
 HRESULT FlvSource::ReadVideoHeader(tag_header const&h){
   auto hr = parser.begin_video_header(&on_video_header, NewMFState(h).Get());
   if (fail(hr))
@@ -1005,6 +1133,8 @@ HRESULT FlvSource::ReadVideoHeader(tag_header const&h){
 HRESULT FlvSource::OnVideoHeader(IMFAsyncResult*result){
   video_header vh;
   auto hr = parser.end_video_header(result, &vh);
+  if (Superseded())
+    return S_OK;
   video_packet_header vsh(FromAsyncResultState<tag_header>(result), vh);
   if (ok(hr)){
     if (vsh.codec_id == flv::video_codec::avc) {
@@ -1016,7 +1146,7 @@ HRESULT FlvSource::OnVideoHeader(IMFAsyncResult*result){
     }
   }
   if (fail(hr))
-    Shutdown();
+    ReadFailed(hr);
   return hr;
 }
 
@@ -1029,6 +1159,8 @@ HRESULT FlvSource::ReadAudioHeader(tag_header const&h){
 HRESULT FlvSource::OnAudioHeader(IMFAsyncResult* result){
   audio_header ah;
   auto hr = parser.end_audio_header(result, &ah);
+  if (Superseded())
+    return S_OK;
   tag_header const&th = FromAsyncResultState<tag_header>(result);
   audio_packet_header ash(th, ah);
   if (ok(hr)){
@@ -1040,7 +1172,7 @@ HRESULT FlvSource::OnAudioHeader(IMFAsyncResult* result){
     }
   }
   if (fail(hr)){
-    Shutdown();
+    ReadFailed(hr);
   }
   return hr;
 }
@@ -1054,13 +1186,15 @@ HRESULT FlvSource::ReadAacPacketType(audio_packet_header const&ash){
 HRESULT FlvSource::OnAacPacketType(IMFAsyncResult*result){
   auto &ash = FromAsyncResultState<audio_packet_header>(result);
   auto hr = parser.end_aac_packet_type(result, &ash.aac_packet_type);
+  if (Superseded())
+    return S_OK;
 //  if (ok(hr))
 //    hr = byte_stream->GetCurrentPosition(&ash.payload_offset);
   if (ok(hr))
     ReadAudioData(ash);
 
   if (fail(hr))
-    Shutdown();
+    ReadFailed(hr);
   return hr;
 }
 
@@ -1073,6 +1207,8 @@ HRESULT FlvSource::ReadAvcPacketType(video_packet_header const&vsh){
 HRESULT FlvSource::OnAvcPacketType(IMFAsyncResult*result){
   avc_header v;
   auto hr = parser.end_avc_header(result, &v);
+  if (Superseded())
+    return S_OK;
   auto &vsh = FromAsyncResultState<video_packet_header>(result);
   vsh.avc_packet_type = v.avc_packet_type;
   vsh.composition_time = v.composite_time;
@@ -1082,7 +1218,7 @@ HRESULT FlvSource::OnAvcPacketType(IMFAsyncResult*result){
     ReadVideoData(vsh);
 
   if (fail(hr))
-    Shutdown();
+    ReadFailed(hr);
   return hr;
 }
 HRESULT FlvSource::ReadAudioData(audio_packet_header const& ash){
@@ -1112,6 +1248,8 @@ HRESULT FlvSource::OnAudioData(IMFAsyncResult *result){
   auto &ash = FromAsyncResultState<audio_packet_header>(result);
 //  packet pack;
   auto  hr = parser.end_audio_data(result, &ash.payload);
+  if (Superseded())
+    return S_OK;
   if (ok(hr) && status.first_audio_tag_ready){
     hr = DeliverAudioPacket(ash);
   }
@@ -1121,7 +1259,7 @@ HRESULT FlvSource::OnAudioData(IMFAsyncResult *result){
     CheckFirstPacketsReady();
   }
   if (fail(hr))
-    Shutdown();
+    ReadFailed(hr);
   return hr;
 }
 HRESULT FlvSource::CheckFirstPacketsReady(){
@@ -1155,6 +1293,7 @@ HRESULT FlvSource::DeliverAvcPacket(video_packet_header const&vsh){
   }
 
   if (vsh.avc_packet_type == flv::avc_packet_type::avc_nalu){
+    flv::stage_scope annexb(flv::stage::annexb);
     auto nal = header.avcc.nal;
     flv::nalu_reader reader(vsh.payload._, vsh.payload.length);
     for (auto nalu = reader.nalu(); nalu.length; nalu = reader.nalu()){
@@ -1202,6 +1341,8 @@ HRESULT FlvSource::DeliverVideoPacket(video_packet_header const& vsh){
   auto isk = vsh.frame_type == flv::frame_type::key_frame || vsh.frame_type == flv::frame_type::generated_key_frame;
   if (isk)
     current_keyframe = keyframe{ vsh.data_offset - flv::flv_tag_header_length, vsh.nano_timestamp  + vsh.composition_time * 10000};
+  if (isk && status.follow)
+    header.keyframes.push_keyframe(keyframe{ vsh.data_offset - flv::flv_tag_header_length, vsh.nano_timestamp });
   if (vsh.codec_id == flv::video_codec::avc)
     return DeliverAvcPacket(vsh);
   else
@@ -1211,6 +1352,8 @@ HRESULT FlvSource::DeliverVideoPacket(video_packet_header const& vsh){
 HRESULT FlvSource::OnVideoData(IMFAsyncResult *result){
   auto &ash = FromAsyncResultState<video_packet_header>(result);
   auto  hr = parser.end_video_data(result, &ash.payload);
+  if (Superseded())
+    return S_OK;
   if (ok(hr) && status.first_video_tag_ready){
     hr = DeliverVideoPacket(ash);
   }
@@ -1222,10 +1365,72 @@ HRESULT FlvSource::OnVideoData(IMFAsyncResult *result){
   }
 
   if (fail(hr))
+    ReadFailed(hr);
+  return hr;
+}
+
+//-------------------------------------------------------------------
+// ReadFailed
+// Handles a failed or short read while opening or demuxing.
+// In follow mode a short read means the tag is not completely
+// written yet, so the source waits for the byte stream to grow.
+//-------------------------------------------------------------------
+
+HRESULT FlvSource::ReadFailed(HRESULT hr){
+  if (hr == E_FLV_TRUNCATED && status.follow)
+    return WaitForGrowth();
+  if (m_state == SourceState::STATE_OPENING)
+    StreamingError(hr);
+  else if (hr == E_FLV_TRUNCATED)
+    return EndOfFile();
+  else
     Shutdown();
   return hr;
 }
 
+//-------------------------------------------------------------------
+// WaitForGrowth
+// Rewinds to the last complete tag and polls the byte stream length.
+//-------------------------------------------------------------------
+
+HRESULT FlvSource::WaitForGrowth(){
+  flv::instrument_count(flv::counter::resyncs);
+  auto hr = byte_stream->SetCurrentPosition(tag_position);
+  if (ok(hr))
+    hr = byte_stream->GetLength(&known_length);
+  if (ok(hr))
+    hr = MFScheduleWorkItem(&on_follow_poll, nullptr, -follow_poll_interval, &follow_poll_key);
+  if (fail(hr))
+    StreamingError(hr);
+  return hr;
+}
+
+HRESULT FlvSource::OnFollowPoll(IMFAsyncResult*){
+  scope_lock l(this);
+  follow_poll_key = 0;
+  if (fail(CheckShutdown()))
+    return S_OK;
+  QWORD length = 0;
+  auto hr = byte_stream->GetLength(&length);
+  // a pending seek is served from the indexed range right away
+  if (ok(hr) && length <= known_length && !status.pending_seek){
+    hr = MFScheduleWorkItem(&on_follow_poll, nullptr, -follow_poll_interval, &follow_poll_key);
+    if (ok(hr))
+      return S_OK;
+  }
+  if (fail(hr))
+    StreamingError(hr);
+  else if (!header.status.file_header_ready)
+    ReadFlvHeader();
+  else if (m_state == SourceState::STATE_OPENING)
+    ReadFlvTagHeader();
+  else {
+    status.pending_request = 0;
+    DemuxSample();
+  }
+  return S_OK;
+}
+
 HRESULT FlvSource::EndOfFile(){
   auto vstream = to_stream_ext(video_stream);// static_cast<FlvStream*>(video_stream.Get());
   auto astream = to_stream_ext(audio_stream);// static_cast<FlvStream*>(audio_stream.Get());
@@ -1300,6 +1505,8 @@ HRESULT FlvSource::FinishInitialize(){
 //  if (header.first_media_tag_offset) {
 //    hr = byte_stream->SetCurrentPosition(header.first_media_tag_offset - flv::flv_previous_tag_size_field_length);
   //}
+  if (!status.follow && status.fast_seek)
+    (void)ReadTail();  // onMetaData stays in use if the tail is damaged or not read
   CreateAudioStream();
   CreateVideoStream();
   hr = InitPresentationDescriptor();
@@ -1307,6 +1514,40 @@ HRESULT FlvSource::FinishInitialize(){
   return hr;
 }
 
+// the real last timestamp with a backward PreviousTagSize walk, two small reads at the end of the file
+// instead of trusting onMetaData, which is zero or stale for recordings cut by a crash.
+// a tail torn inside a tag is walked forward from the last indexed keyframe.
+// the last keyframe found extends a stale index so seeks reach the end.
+// the reads block the open, so remote and slow seeking byte streams keep onMetaData
+HRESULT FlvSource::ReadTail(){
+  QWORD length = 0, position = 0;
+  auto hr = byte_stream->GetLength(&length);
+  if (ok(hr))
+    hr = byte_stream->GetCurrentPosition(&position);
+  if (fail(hr))
+    return hr;
+  byte_stream_source source(byte_stream.Get());
+  uint32_t last = 0;
+  flv::raw_tag last_keyframe;
+  uint64_t scan_from = 0;
+  auto&k = header.keyframes.positions;
+  for (auto i = k.rbegin(); i != k.rend() && !scan_from; ++i){
+    if (*i >= header.first_media_tag_offset && *i < length)
+      scan_from = *i;
+  }
+  if (flv::read_tail(&source, header.first_media_tag_offset, length, &last, &last_keyframe, 256, scan_from) == 0 && last){
+    header.last_timestamp = last;
+    header.duration = (last + 500) / 1000;
+    status.tail_ready = 1;
+  }
+  if (last_keyframe.type == flv::tag_type::video){
+    header.last_keyframe_timestamp = last_keyframe.timestamp;
+    if (!header.keyframes.empty())  // a single keyframe is no index
+      header.keyframes.push_keyframe(keyframe{ last_keyframe.position, uint64_t(last_keyframe.timestamp) * 10000 });  // millis to nano
+  }
+  return byte_stream->SetCurrentPosition(position);
+}
+
 HRESULT FlvSource::CreateStream(DWORD index, IMFMediaType*media_type, IMFMediaStream**v) {
   ComPtr<IMFStreamDescriptor> pSD;
   ComPtr<IMFMediaTypeHandler> pHandler;
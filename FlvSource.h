@@ -6,6 +6,7 @@
 #include "asynccallback.hpp"
 #include "MFMediaSourceExt.hpp"
 #include "FlvParse.hpp" // Flv parser
+#include "flv_seek_queue.hpp"
 
 using namespace Microsoft::WRL;
 
@@ -37,6 +38,7 @@ public:
 
     HRESULT STDMETHODCALLTYPE AsyncRequestData();
     HRESULT STDMETHODCALLTYPE AsyncEndOfStream();
+    HRESULT STDMETHODCALLTYPE SetFollowMode(BOOL follow);
     HRESULT STDMETHODCALLTYPE Lock() { EnterCriticalSection(&crit_sec); return S_OK; }
     HRESULT STDMETHODCALLTYPE Unlock() { LeaveCriticalSection(&crit_sec); return S_OK; }
 
@@ -60,7 +62,7 @@ private:
     HRESULT AsyncPause();
     HRESULT AsyncDo(IMFAsyncCallback*, IUnknown*);
 
-    HRESULT DoStart(IMFPresentationDescriptor*, PROPVARIANT const*);
+    HRESULT DoStart(IMFPresentationDescriptor*, PROPVARIANT const*, uint64_t generation);
     HRESULT DoStop();
     HRESULT DoPause();
     HRESULT DoRequestData();
@@ -72,6 +74,7 @@ private:
     HRESULT CreateAudioStream();
     HRESULT CreateVideoStream();
     HRESULT CreateStream(DWORD index, IMFMediaType*media_type, IMFMediaStream**v);
+    HRESULT ReadTail();
     HRESULT ValidatePresentationDescriptor(IMFPresentationDescriptor *pPD);
 
     // Handler for async errors.
@@ -95,6 +98,10 @@ private:
       uint32_t processing_op                          : 1;
       uint32_t code_private_data_sent                 : 1;
       uint32_t pending_seek : 1;
+      uint32_t follow                                 : 1;  // file is still being written, wait at eof
+      uint32_t pending_skip                           : 1;  // skip_file_position is where the next tag header is read
+      uint32_t tail_ready                             : 1;  // last_timestamp read from the end of the file
+      uint32_t fast_seek                              : 1;  // local byte stream, neither remote nor slow to seek
     }status;
 
     flv_parser                      parser;
@@ -110,6 +117,14 @@ private:
     ULONG                       restart_counter = 0;          // Counter for sample requests.
     uint64_t                    pending_seek_file_position = 0;
     keyframe                    current_keyframe;
+    uint64_t                    seek_target = 0;  // requested start past the keyframe, earlier audio is not read
+    uint64_t                    tag_position = 0;             // previous_tag_size field of the tag being read
+    uint64_t                    skip_file_position = 0;       // end of the last skipped tag
+    flv::seek_queue             seeks;                        // Start calls, a dragged seek bar queues many
+    uint64_t                    started_generation = 0;       // of the last start that positioned the byte stream
+    uint64_t                    read_generation = 0;          // started_generation when the tag being read was begun
+    QWORD                       known_length = 0;             // byte stream length when waiting for growth
+    MFWORKITEM_KEY              follow_poll_key = 0;
     // Async callback helper.
     AsyncCallback<FlvSource> on_flv_header;
     AsyncCallback<FlvSource> on_tag_header;
@@ -121,6 +136,7 @@ private:
     AsyncCallback<FlvSource> on_avc_packet_type;
     AsyncCallback<FlvSource> on_video_data;
     AsyncCallback<FlvSource> on_video_header;
+    AsyncCallback<FlvSource> on_follow_poll;
 
     HRESULT FinishInitialize();
     HRESULT ReadFlvHeader();
@@ -138,6 +154,10 @@ private:
 
     HRESULT ReadSampleHeader();
     HRESULT STDMETHODCALLTYPE OnSampleHeader(IMFAsyncResult*result);
+    bool    StreamActive(IMFMediaStreamPtr&);
+    bool    EndsBeforeTarget(::tag_header const&);
+    void    SkipTag(::tag_header const&);
+    bool    Superseded();
 
     HRESULT ReadAudioHeader(tag_header const&);
     HRESULT STDMETHODCALLTYPE OnAudioHeader(IMFAsyncResult*result);
@@ -165,6 +185,10 @@ private:
 
     HRESULT EndOfFile();
     HRESULT CheckFirstPacketsReady();
+    HRESULT ReadFailed(HRESULT hr);
+
+    HRESULT WaitForGrowth();
+    HRESULT STDMETHODCALLTYPE OnFollowPoll(IMFAsyncResult*);
 
     void DemuxSample();
     bool NeedDemux();
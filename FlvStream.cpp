@@ -3,6 +3,11 @@
 #include <mfapi.h>
 #include "MFMediaSourceExt.hpp"
 #include "prop_variant.hpp"
+#include "flv_instrument.hpp"
+
+// {D821704F-2308-4F16-A52F-37DE506F6AF0} UINT64 sample attribute, instrument_now() when the sample was queued.
+// set only when instrumented and removed again before the sample is sent
+const static GUID MFSampleExtension_FlvQueued = { 0xd821704f, 0x2308, 0x4f16, { 0xa5, 0x2f, 0x37, 0xde, 0x50, 0x6f, 0x6a, 0xf0 } };
 
 struct SourceLock {
   IMFMediaSourceExt *source;
@@ -248,6 +253,8 @@ HRESULT FlvStream::DeliverPayload(IMFSample* sample)
   SourceLock lock(source);
 
   // Queue the sample.
+  if (flv::instrumented)
+    sample->SetUINT64(MFSampleExtension_FlvQueued, flv::instrument_now());
   samples.push_back(sample);
 
   // Deliver the sample if there is an outstanding request.
@@ -281,6 +288,12 @@ HRESULT FlvStream::DispatchSamples()
         // Pull the next request token from the queue. Tokens can be NULL.
       assert(sample); // token can be null
 
+      UINT64 queued = 0;
+      if (flv::instrumented && ok(sample->GetUINT64(MFSampleExtension_FlvQueued, &queued))){
+        flv::instrument_record(flv::stage::queue_wait, flv::instrument_now() - queued);
+        sample->DeleteItem(MFSampleExtension_FlvQueued);
+      }
+
       if (token)
         hr = sample->SetUnknown(MFSampleExtension_Token, token.Get());
 
@@ -42,6 +42,7 @@ IMFMediaSourceExt : public IUnknown
 
   virtual HRESULT STDMETHODCALLTYPE BeginOpen(IMFByteStream *pStream, IMFAsyncCallback *, IUnknown *) = 0;
   virtual HRESULT STDMETHODCALLTYPE EndOpen(IMFAsyncResult *pResult) = 0;
+  virtual HRESULT STDMETHODCALLTYPE SetFollowMode(BOOL follow) = 0;  // before BeginOpen, appended to keep the vtable
 };
 typedef Microsoft::WRL::ComPtr<IMFMediaSourceExt> IMFMediaSourceExtPtr;
 
@@ -0,0 +1,49 @@
+#include "aac.hpp"
+
+const static uint32_t sampling_rates[] = {
+  96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+uint32_t flv::aac_sampling_rate(uint8_t index){
+  return index < sizeof(sampling_rates) / sizeof(sampling_rates[0]) ? sampling_rates[index] : 0;
+}
+
+uint8_t flv::aac_sampling_index(uint32_t rate){
+  for (uint8_t i = 0; i < sizeof(sampling_rates) / sizeof(sampling_rates[0]); ++i){
+    if (sampling_rates[i] == rate)
+      return i;
+  }
+  return 15;
+}
+
+packet flv::audio_specific_config::encode()const{
+  packet v(2);
+  bigendian::binary_writer writer(v._, v.length);
+  writer.ui16(uint16_t((object_type & 0x1f) << 11 | (sampling_index & 0x0f) << 7 | (channels & 0x0f) << 3));
+  return v;
+}
+
+int32_t flv::audio_specific_config_reader::audio_specific_config(flv::audio_specific_config*v){
+  // bits are read msb first across byte boundaries
+  uint64_t bits = 0;
+  uint32_t available = 0;
+  while (available <= 56 && pointer < length){
+    bits |= uint64_t(byte()) << (56 - available);
+    available += 8;
+  }
+  uint32_t used = 0;
+  auto take = [&](uint32_t n){
+    auto x = uint32_t((bits << used) >> (64 - n));
+    used += n;
+    return x;
+  };
+  if (available < 16)
+    return -1;
+  v->object_type = uint8_t(take(5));
+  if (v->object_type == 31)
+    v->object_type = uint8_t(32 + take(6));
+  v->sampling_index = uint8_t(take(4));
+  v->sampling_rate = v->sampling_index == 15 ? take(24) : aac_sampling_rate(v->sampling_index);
+  v->channels = uint8_t(take(4));
+  return used <= available ? 0 : -1;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include "bigendian.hpp"
+#include "packet.hpp"
+
+namespace flv {
+// AudioSpecificConfig of ISO 14496-3, the data of an aac sequence header
+struct audio_specific_config{
+  uint8_t  object_type    = 2;  // audioObjectType, 2: aac lc
+  uint8_t  sampling_index = 4;  // samplingFrequencyIndex, 4: 44100
+  uint32_t sampling_rate  = 44100;
+  uint8_t  channels       = 2;  // channelConfiguration
+  packet   encode()const;       // two bytes, explicit frequency is not written
+};
+// sampling rate of a samplingFrequencyIndex, 0 if reserved
+uint32_t aac_sampling_rate(uint8_t index);
+// samplingFrequencyIndex of a rate, 15 if there is none
+uint8_t  aac_sampling_index(uint32_t rate);
+
+struct audio_specific_config_reader : public bigendian::binary_reader{
+  audio_specific_config_reader(uint8_t const*d, uint32_t len) : binary_reader(d, len){}
+  int32_t audio_specific_config(flv::audio_specific_config*v);  // 0: ok, -1: too short
+};
+}
+/*
+audioObjectType              5 bits, 31: escape, 6 more bits
+samplingFrequencyIndex       4 bits, 15: explicit 24 bits samplingFrequency
+channelConfiguration         4 bits
+*/
@@ -1,5 +1,6 @@
 #include "amf.hpp"
 #include <cassert>
+#include <cstring>
 #include "flv.hpp"
 #include "flv_meta.hpp"
 int32_t flv::amf_reader::skip_script_data_value(){
@@ -41,7 +42,7 @@ int32_t flv::amf_reader::skip_script_data_value(){
   skip(sizeof(uint16_t));
   break;
   case flv::script_data_value_type::long_string:
-  hr = skip_script_data_string();
+  skip(ui32());  // 32 bits length
   break;
   default:
   hr = -1;
@@ -97,7 +98,7 @@ int32_t flv::amf_reader::skip_script_data_object_property(bool*notend){
   if (v.empty()){
     auto x = byte();
     if (x == (uint8_t)flv::script_data_value_type::object_end_marker){
-      notend = false;
+      *notend = false;
       return 0;
     }
     else
@@ -248,11 +249,11 @@ uint32_t flv::on_meta_data_decoder::decode(flv::amf_reader &reader, flv_meta*v){
     else if (vname == "canSeekToEnd"){
       v->can_seek_to_end = reader.script_data_value_toui8();
     }
-    else if (vname == "lasttimestamp"){
-      v->last_timestamp = reader.script_data_value_toui32();
+    else if (vname == "lasttimestamp"){  // seconds
+      v->last_timestamp = static_cast<uint32_t>(reader.script_data_value_tod() * 1000);
     }
     else if (vname == "lastkeyframetimestamp"){
-      v->last_keyframe_timestamp = reader.script_data_value_toui32();
+      v->last_keyframe_timestamp = static_cast<uint32_t>(reader.script_data_value_tod() * 1000);
     }
     else if (vname == "audiosize"){
       v->audiosize = reader.script_data_value_toui32();
@@ -270,3 +271,202 @@ uint32_t flv::on_meta_data_decoder::decode(flv::amf_reader &reader, flv_meta*v){
   assert(reader.pointer == reader.length);
   return hr;
 }
+
+void flv::amf_writer::ui8(uint8_t v){
+  data.push_back(v);
+}
+void flv::amf_writer::ui16(uint16_t v){
+  data.push_back(uint8_t(v >> 8));
+  data.push_back(uint8_t(v));
+}
+void flv::amf_writer::ui32(uint32_t v){
+  for (int i = 3; i >= 0; --i)
+    data.push_back(uint8_t(v >> (i * 8)));
+}
+void flv::amf_writer::ui64(uint64_t v){
+  for (int i = 7; i >= 0; --i)
+    data.push_back(uint8_t(v >> (i * 8)));
+}
+void flv::amf_writer::patch_ui32(size_t at, uint32_t v){
+  for (int i = 0; i < 4; ++i)
+    data[at + i] = uint8_t(v >> ((3 - i) * 8));
+}
+void flv::amf_writer::number(double v){
+  uint64_t x;
+  memcpy(&x, &v, sizeof(x));
+  ui8((uint8_t)flv::script_data_value_type::number);
+  ui64(x);
+}
+void flv::amf_writer::boolean(bool v){
+  ui8((uint8_t)flv::script_data_value_type::boolean);
+  ui8(v ? 1 : 0);
+}
+// strings longer than 65535 bytes are written as long strings
+void flv::amf_writer::string(std::string const&v){
+  if (v.size() <= UINT16_MAX){
+    ui8((uint8_t)flv::script_data_value_type::string);
+    script_data_string(v);
+    return;
+  }
+  ui8((uint8_t)flv::script_data_value_type::long_string);
+  ui32(static_cast<uint32_t>(v.size()));
+  data.insert(data.end(), v.begin(), v.end());
+}
+void flv::amf_writer::null(){
+  ui8((uint8_t)flv::script_data_value_type::null);
+}
+void flv::amf_writer::undefined(){
+  ui8((uint8_t)flv::script_data_value_type::undefined);
+}
+void flv::amf_writer::date(double ms, int16_t offset){
+  uint64_t x;
+  memcpy(&x, &ms, sizeof(x));
+  ui8((uint8_t)flv::script_data_value_type::date);
+  ui64(x);
+  ui16(static_cast<uint16_t>(offset));
+}
+void flv::amf_writer::script_data_string(std::string const&v){
+  auto l = static_cast<uint16_t>(v.size());
+  ui16(l);
+  data.insert(data.end(), v.begin(), v.begin() + l);
+}
+void flv::amf_writer::begin_object(){
+  ui8((uint8_t)flv::script_data_value_type::object);
+}
+size_t flv::amf_writer::begin_ecma_array(uint32_t count){
+  ui8((uint8_t)flv::script_data_value_type::ecma);
+  auto at = data.size();
+  ui32(count);
+  return at;
+}
+void flv::amf_writer::end_object(){
+  ui16(0);
+  ui8((uint8_t)flv::script_data_value_type::object_end_marker);
+}
+void flv::amf_writer::begin_strict_array(uint32_t count){
+  ui8((uint8_t)flv::script_data_value_type::array);
+  ui32(count);
+}
+
+// object with filepositions and times, both strict arrays of numbers
+void flv::keyframes_encoder::encode(flv::amf_writer&writer, ::keyframes const&v){
+  assert(v.positions.size() == v.times.size());
+  writer.begin_object();
+  writer.property("filepositions");
+  writer.begin_strict_array(static_cast<uint32_t>(v.positions.size()));
+  for (auto p : v.positions)
+    writer.number(static_cast<double>(p));
+  writer.property("times");
+  writer.begin_strict_array(static_cast<uint32_t>(v.times.size()));
+  for (auto t : v.times)
+    writer.number(t / 10000000.0);  // nano to seconds
+  writer.end_object();
+}
+
+// duration is taken from last_timestamp when it's known, it keeps milliseconds
+namespace{
+// properties an index rewrite changes, replaced by on_meta_data_encoder::patch
+char const*const index_properties[] = { "duration", "filesize", "hasVideo", "hasAudio", "hasMetadata", "hasKeyframes",
+                                        "canSeekToEnd", "lasttimestamp", "lastkeyframetimestamp", "keyframes", "padding" };
+
+bool index_property(std::string const&name){
+  for (auto p : index_properties)
+    if (name == p)
+      return true;
+  return false;
+}
+
+// appends the index properties of v, returns their count
+uint32_t encode_index(flv::amf_writer&writer, flv_meta const&v){
+  writer.property("duration");
+  writer.number(v.last_timestamp ? v.last_timestamp / 1000.0 : double(v.duration));
+  writer.property("filesize");
+  writer.number(double(v.filesize));
+  writer.property("hasVideo");
+  writer.boolean(v.has_video != 0);
+  writer.property("hasAudio");
+  writer.boolean(v.has_audio != 0);
+  writer.property("hasMetadata");
+  writer.boolean(true);
+  writer.property("hasKeyframes");
+  writer.boolean(!v.keyframes.positions.empty());
+  writer.property("canSeekToEnd");
+  writer.boolean(v.can_seek_to_end != 0);
+  writer.property("lasttimestamp");
+  writer.number(v.last_timestamp / 1000.0);
+  writer.property("lastkeyframetimestamp");
+  writer.number(v.last_keyframe_timestamp / 1000.0);
+  writer.property("keyframes");
+  flv::keyframes_encoder().encode(writer, v.keyframes);
+  return 10;
+}
+}
+
+void flv::on_meta_data_encoder::encode(flv::amf_writer&writer, flv_meta const&v){
+  writer.string("onMetaData");
+  uint32_t count = 0;
+  auto at = writer.begin_ecma_array(0);
+  auto number = [&](char const*name, double x){
+    writer.property(name);
+    writer.number(x);
+    ++count;
+  };
+  auto boolean = [&](char const*name, bool x){
+    writer.property(name);
+    writer.boolean(x);
+    ++count;
+  };
+  if (v.has_video){
+    number("width", v.width);
+    number("height", v.height);
+    number("videodatarate", v.videodatarate / 1000.0);
+    number("framerate", v.framerate);
+    number("videocodecid", double(v.videocodecid));
+  }
+  if (v.has_audio){
+    number("audiosamplerate", v.audiosamplerate);
+    number("audiosamplesize", v.audiosamplesize);
+    boolean("stereo", v.stereo != 0);
+    number("audiocodecid", double(v.audiocodecid));
+    number("audiodatarate", v.audiodatarate / 1000.0);
+  }
+  count += encode_index(writer, v);
+  writer.end_object();
+  writer.patch_ui32(at, count);
+}
+
+// entries of the original ecma array are copied as raw bytes, name and value
+int32_t flv::on_meta_data_encoder::patch(flv::amf_writer&writer, uint8_t const*original, uint32_t length, flv_meta const&v){
+  auto reader = flv::amf_reader(original, length);
+  auto header = 1 + sizeof(uint16_t) + 10 + 1 + sizeof(uint32_t);  // "onMetaData" string value, ecma type and count
+  if (original == nullptr || length < header || reader.byte() != (uint8_t)flv::script_data_value_type::string
+      || reader.script_data_string() != "onMetaData" || reader.byte() != (uint8_t)flv::script_data_value_type::ecma){
+    encode(writer, v);
+    return 0;
+  }
+  reader.ui32();
+  writer.string("onMetaData");
+  uint32_t count = 0;
+  auto at = writer.begin_ecma_array(0);
+  for (;;){
+    if (reader.length - reader.pointer < sizeof(uint16_t) + 1)
+      return -1;
+    auto begin = reader.pointer;
+    auto name = reader.script_data_string();
+    if (name.empty()){
+      if (reader.pointer >= reader.length || reader.byte() != (uint8_t)flv::script_data_value_type::object_end_marker)
+        return -1;
+      break;
+    }
+    if (reader.pointer >= reader.length || reader.skip_script_data_value() != 0 || reader.pointer > reader.length)
+      return -1;
+    if (index_property(name))
+      continue;
+    writer.data.insert(writer.data.end(), original + begin, original + reader.pointer);
+    ++count;
+  }
+  count += encode_index(writer, v);
+  writer.end_object();
+  writer.patch_ui32(at, count);
+  return 0;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <string>
+#include <vector>
 #include "bigendian.hpp"
 #include "keyframes.hpp"
 #include "flv_meta.hpp"
@@ -25,10 +26,46 @@ struct amf_reader : public bigendian::binary_reader{
   explicit amf_reader(const uint8_t*d, uint32_t len) : binary_reader(d, len){};
   amf_reader() = delete;
 };
+// amf0 script data encoder, appends to data
+struct amf_writer{
+  std::vector<uint8_t> data;
+
+  void   number(double v);                    // script_data_value number
+  void   boolean(bool v);                     // script_data_value boolean
+  void   string(std::string const&v);         // script_data_value string or long string
+  void   null();
+  void   undefined();
+  void   date(double ms, int16_t offset);     // milliseconds since 1970, local time offset in minutes
+  void   script_data_string(std::string const&v);  // without type field, names of properties
+  void   begin_object();
+  size_t begin_ecma_array(uint32_t count);    // returns offset of the count field
+  void   end_object();                        // object-end-marker {0, 0, 9}, ends object and ecma array
+  void   begin_strict_array(uint32_t count);
+  void   property(std::string const&name){ script_data_string(name); }
+  void   patch_ui32(size_t at, uint32_t v);
+
+  void   ui8(uint8_t v);
+  void   ui16(uint16_t v);
+  void   ui32(uint32_t v);
+  void   ui64(uint64_t v);
+};
 struct keyframes_decoder{
   ::keyframes decode(amf_reader&reader, int32_t*ret);
 };
 struct on_meta_data_decoder{
   uint32_t decode(amf_reader&reader, flv_meta*v);
 };
+struct keyframes_encoder{
+  void encode(amf_writer&writer, ::keyframes const&v);
+};
+// writes "onMetaData" followed by an ecma array, the body of a script data tag
+// the encoded length depends only on the fields present and the keyframe count
+struct on_meta_data_encoder{
+  void encode(amf_writer&writer, flv_meta const&v);
+  // the onMetaData of original, the data of a script tag, with the index properties taken from v:
+  // duration, filesize, keyframes and the has* flags and timestamps that go with them.
+  // every other entry is copied through unchanged, all of v is encoded if original is no onMetaData ecma array
+  // 0: ok, -1: original is damaged
+  int32_t patch(amf_writer&writer, uint8_t const*original, uint32_t length, flv_meta const&v);
+};
 }
@@ -0,0 +1,124 @@
+#include "amf.hpp"
+#include <map>
+#include <string>
+#include <vector>
+#include "test.hpp"
+
+namespace{
+flv_meta sample_meta(){
+  flv_meta v;
+  v.has_video = 1;
+  v.has_audio = 1;
+  v.width = 1280;
+  v.height = 720;
+  v.framerate = 25;
+  v.videodatarate = 2500000;
+  v.videocodecid = flv::video_codec::avc;
+  v.audiosamplerate = 44100;
+  v.audiosamplesize = 16;
+  v.stereo = 1;
+  v.audiocodecid = flv::audio_codec::aac;
+  v.audiodatarate = 128000;
+  v.filesize = 123456789;
+  v.last_timestamp = 61480;
+  v.last_keyframe_timestamp = 60000;
+  for (uint32_t i = 0; i <= 30; ++i)
+    v.keyframes.push_keyframe(keyframe{ 1000 + i * 200000ull, i * 2000 * 10000ull });
+  return v;
+}
+
+int32_t decode(std::vector<uint8_t> const&data, flv_meta*v){
+  auto reader = flv::amf_reader(data.data(), static_cast<uint32_t>(data.size()));
+  if (reader.skip_script_data_value() != 0)  // "onMetaData"
+    return -1;
+  return flv::on_meta_data_decoder().decode(reader, v) == 0 && reader.pointer == reader.length ? 0 : -1;
+}
+
+// names of the onMetaData entries with their encoded values
+std::multimap<std::string, std::vector<uint8_t>> entries(std::vector<uint8_t> const&data){
+  std::multimap<std::string, std::vector<uint8_t>> v;
+  auto reader = flv::amf_reader(data.data(), static_cast<uint32_t>(data.size()));
+  reader.skip_script_data_value();
+  reader.byte();
+  reader.ui32();
+  for (;;){
+    auto name = reader.script_data_string();
+    if (name.empty())
+      break;
+    auto begin = reader.pointer;
+    if (reader.skip_script_data_value() != 0 || reader.pointer > reader.length)
+      break;
+    v.insert(std::make_pair(name, std::vector<uint8_t>(data.begin() + begin, data.begin() + reader.pointer)));
+  }
+  return v;
+}
+}
+
+FLV_TEST(amf_meta_encodes_and_decodes_back){
+  auto meta = sample_meta();
+  auto writer = flv::amf_writer();
+  flv::on_meta_data_encoder().encode(writer, meta);
+  flv_meta v;
+  FLV_CHECK(decode(writer.data, &v) == 0);
+  FLV_CHECK(v.width == 1280 && v.height == 720 && v.framerate == 25 && v.videodatarate == 2500000);
+  FLV_CHECK(v.videocodecid == flv::video_codec::avc && v.audiocodecid == flv::audio_codec::aac);
+  FLV_CHECK(v.audiosamplerate == 44100 && v.audiosamplesize == 16 && v.stereo == 1 && v.audiodatarate == 128000);
+  FLV_CHECK(v.has_video == 1 && v.has_audio == 1 && v.has_metadata == 1 && v.can_seek_to_end == 0);
+  FLV_CHECK(v.filesize == 123456789 && v.duration == 61);
+  FLV_CHECK(v.last_timestamp == 61480 && v.last_keyframe_timestamp == 60000);
+  FLV_CHECK(v.keyframes.positions == meta.keyframes.positions && v.keyframes.times == meta.keyframes.times);
+
+  // the length depends on the keyframe count only, not on the values
+  meta.filesize = 1;
+  meta.last_timestamp = 1;
+  meta.keyframes.positions.back() = 7;
+  auto other = flv::amf_writer();
+  flv::on_meta_data_encoder().encode(other, meta);
+  FLV_CHECK(other.data.size() == writer.data.size());
+}
+
+FLV_TEST(amf_patch_keeps_unknown_properties){
+  auto original = flv::amf_writer();
+  original.string("onMetaData");
+  original.begin_ecma_array(5);
+  original.property("duration");
+  original.number(1);
+  original.property("encoder");
+  original.string("amf test");
+  original.property("creator");
+  original.begin_object();
+  original.property("version");
+  original.number(7);
+  original.end_object();
+  original.property("filesize");
+  original.number(10);
+  original.property("width");
+  original.number(320);
+  original.end_object();
+
+  auto meta = sample_meta();
+  auto writer = flv::amf_writer();
+  FLV_CHECK(flv::on_meta_data_encoder().patch(writer, original.data.data(), static_cast<uint32_t>(original.data.size()), meta) == 0);
+  auto before = entries(original.data);
+  auto after = entries(writer.data);
+  // entries outside the index are copied byte for byte, width is one of them
+  FLV_CHECK(after.count("encoder") == 1 && after.find("encoder")->second == before.find("encoder")->second);
+  FLV_CHECK(after.count("creator") == 1 && after.find("creator")->second == before.find("creator")->second);
+  FLV_CHECK(after.count("width") == 1 && after.find("width")->second == before.find("width")->second);
+  FLV_CHECK(after.count("duration") == 1 && after.count("filesize") == 1 && after.count("keyframes") == 1);
+  FLV_CHECK(after.count("height") == 0);
+
+  flv_meta v;
+  FLV_CHECK(decode(writer.data, &v) == 0);
+  FLV_CHECK(v.width == 320 && v.filesize == 123456789 && v.duration == 61);
+  FLV_CHECK(v.keyframes.positions == meta.keyframes.positions && v.keyframes.times == meta.keyframes.times);
+
+  // patched twice, nothing is repeated
+  auto again = flv::amf_writer();
+  FLV_CHECK(flv::on_meta_data_encoder().patch(again, writer.data.data(), static_cast<uint32_t>(writer.data.size()), meta) == 0);
+  FLV_CHECK(again.data == writer.data);
+
+  // a damaged original is reported
+  auto damaged = flv::amf_writer();
+  FLV_CHECK(flv::on_meta_data_encoder().patch(damaged, original.data.data(), static_cast<uint32_t>(original.data.size()) - 4, meta) == -1);
+}
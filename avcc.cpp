@@ -1,5 +1,45 @@
 #include "avcc.hpp"
 #include <cassert>
+#include <vector>
+
+namespace{
+// exp-golomb reader over rbsp, emulation prevention bytes removed
+struct bit_reader{
+  std::vector<uint8_t> rbsp;
+  size_t               bit = 0;
+  bool                 overrun = false;
+
+  bit_reader(uint8_t const*d, uint32_t len){
+    rbsp.reserve(len);
+    for (uint32_t i = 0; i < len; ++i){
+      if (i >= 2 && d[i] == 3 && d[i - 1] == 0 && d[i - 2] == 0)
+        continue;
+      rbsp.push_back(d[i]);
+    }
+  }
+  uint32_t u(uint32_t n){
+    uint32_t v = 0;
+    for (uint32_t i = 0; i < n; ++i, ++bit){
+      if (bit >= rbsp.size() * 8){
+        overrun = true;
+        return 0;
+      }
+      v = (v << 1) | ((rbsp[bit / 8] >> (7 - bit % 8)) & 1);
+    }
+    return v;
+  }
+  uint32_t ue(){
+    uint32_t zeros = 0;
+    while (!overrun && u(1) == 0 && zeros < 32)
+      ++zeros;
+    return zeros ? (1u << zeros) - 1 + u(zeros) : 0;
+  }
+  int32_t se(){
+    auto v = ue();
+    return (v & 1) ? int32_t((v + 1) / 2) : -int32_t(v / 2);
+  }
+};
+}
 
 //startcode + sps[0] + startcode + pps[0]
 packet flv::avcc::code_private_data()const{  // sequence_header
@@ -26,11 +66,99 @@ packet flv::avcc::sequence_header()const{
   writer.packet(pps[0]);
   return std::move(v);
 }
+packet flv::avcc::decoder_configuration_record()const{
+  uint32_t l = 6 + 1;  // header, numOfPictureParameterSets
+  for (auto&x : sps)
+    l += sizeof(uint16_t) + x.length;
+  for (auto&x : pps)
+    l += sizeof(uint16_t) + x.length;
+  packet v(l);
+  bigendian::binary_writer writer(v._, v.length);
+  writer.byte(1);  // configurationVersion
+  writer.byte(profile);
+  writer.byte(compatibility);
+  writer.byte(level);
+  writer.byte(uint8_t(0xfc | ((nal ? nal : 4) - 1)));
+  writer.byte(uint8_t(0xe0 | sps.size()));
+  for (auto&x : sps){
+    writer.ui16(static_cast<uint16_t>(x.length));
+    writer.packet(x);
+  }
+  writer.byte(static_cast<uint8_t>(pps.size()));
+  for (auto&x : pps){
+    writer.ui16(static_cast<uint16_t>(x.length));
+    writer.packet(x);
+  }
+  return v;
+}
+int32_t flv::sps_dimensions(packet const&sps, uint32_t*width, uint32_t*height){
+  if (sps.length < 4)
+    return -1;
+  bit_reader r(sps._ + 1, sps.length - 1);  // nal header
+  auto profile = r.u(8);
+  r.u(16);  // constraint flags, level
+  r.ue();   // seq_parameter_set_id
+  uint32_t chroma_format = 1;
+  if (profile == 100 || profile == 110 || profile == 122 || profile == 244 || profile == 44 || profile == 83
+    || profile == 86 || profile == 118 || profile == 128 || profile == 138 || profile == 139 || profile == 134 || profile == 135){
+    chroma_format = r.ue();
+    if (chroma_format == 3 && r.u(1))  // separate_colour_plane_flag
+      chroma_format = 0;
+    r.ue();  // bit_depth_luma_minus8
+    r.ue();  // bit_depth_chroma_minus8
+    r.u(1);  // qpprime_y_zero_transform_bypass_flag
+    if (r.u(1)){  // seq_scaling_matrix_present_flag
+      for (int i = 0; i < (chroma_format != 3 ? 8 : 12); ++i){
+        if (!r.u(1))
+          continue;
+        int32_t last = 8, next = 8;
+        for (int j = 0; j < (i < 6 ? 16 : 64) && next; ++j){
+          next = (last + r.se() + 256) % 256;
+          last = next ? next : last;
+        }
+      }
+    }
+  }
+  r.ue();  // log2_max_frame_num_minus4
+  auto poc_type = r.ue();
+  if (poc_type == 0)
+    r.ue();  // log2_max_pic_order_cnt_lsb_minus4
+  else if (poc_type == 1){
+    r.u(1);  // delta_pic_order_always_zero_flag
+    r.se();  // offset_for_non_ref_pic
+    r.se();  // offset_for_top_to_bottom_field
+    auto cycle = r.ue();
+    for (uint32_t i = 0; i < cycle && !r.overrun; ++i)
+      r.se();
+  }
+  r.ue();  // max_num_ref_frames
+  r.u(1);  // gaps_in_frame_num_value_allowed_flag
+  auto width_mbs = r.ue() + 1;
+  auto height_units = r.ue() + 1;
+  auto frame_mbs_only = r.u(1);
+  if (!frame_mbs_only)
+    r.u(1);  // mb_adaptive_frame_field_flag
+  r.u(1);    // direct_8x8_inference_flag
+  uint32_t left = 0, right = 0, top = 0, bottom = 0;
+  if (r.u(1)){
+    left = r.ue();
+    right = r.ue();
+    top = r.ue();
+    bottom = r.ue();
+  }
+  if (r.overrun)
+    return -1;
+  auto crop_x = (chroma_format == 1 || chroma_format == 2) ? 2u : 1u;
+  auto crop_y = (chroma_format == 1 ? 2u : 1u) * (2 - frame_mbs_only);
+  *width = width_mbs * 16 - crop_x * (left + right);
+  *height = (2 - frame_mbs_only) * height_units * 16 - crop_y * (top + bottom);
+  return 0;
+}
 flv::avcc flv::avcc_reader::avcc(){
   flv::avcc v;
   byte();  // version;
   v.profile = byte();
-  byte();  // profile-compatibility
+  v.compatibility = byte();
   v.level = byte();
   v.nal = (byte() & 0x03) + 1;
   auto sps_count = byte() & 0x1f;
@@ -6,15 +6,21 @@
 namespace flv {
 struct avcc //avc_decoder_configuration_record
 {
-  uint8_t profile   = 0;  //AVCProfileIndication
-  uint8_t level     = 0;  //AVCLevelIndication
-  uint8_t nal       = 0;  // <- lengthSizeMinusOne
+  uint8_t profile       = 0;  //AVCProfileIndication
+  uint8_t compatibility = 0;  //profile_compatibility
+  uint8_t level         = 0;  //AVCLevelIndication
+  uint8_t nal           = 0;  // <- lengthSizeMinusOne
   std::vector<packet> sps;
   std::vector<packet> pps;
   packet code_private_data()const;
   packet sequence_header()const;
+  packet decoder_configuration_record()const;  // avcC, the data of an avc sequence header
 };
 
+// picture size from a sequence parameter set nal unit, cropping applied
+// 0: ok, -1: sps is truncated
+int32_t sps_dimensions(packet const&sps, uint32_t*width, uint32_t*height);
+
 struct avcc_reader : public bigendian::binary_reader
 {
   avcc_reader(uint8_t const*d, uint32_t len):binary_reader(d, len){}
@@ -0,0 +1,61 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "flv_bench.hpp"
+
+// FlvBench [options] [dir]: generates the synthetic corpus into dir, the working directory without one,
+// benches every file and prints the results as json
+//   --repeats n    runs of open and full demux, the median is reported
+//   --seeks n      random seeks per file
+//   --long         adds a 10 hour file to the corpus
+//   --memory       files are read into memory before each pass, the numbers leave out the file system
+//   --throttle latency_us[,bytes_per_second]   reads are delayed like a network would, the delays are reported
+//   -o path        writes the json to path
+int main(int argc, char**argv){
+  flv::bench_options o;
+  flv::throttled_source throttle(nullptr);
+  char const*dir = ".";
+  char const*out = nullptr;
+  for (int i = 1; i < argc; ++i){
+    auto more = i + 1 < argc;
+    if (strcmp(argv[i], "--repeats") == 0 && more)
+      o.repeats = static_cast<uint32_t>(atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seeks") == 0 && more)
+      o.seeks = static_cast<uint32_t>(atoi(argv[++i]));
+    else if (strcmp(argv[i], "--long") == 0)
+      o.long_corpus = true;
+    else if (strcmp(argv[i], "--memory") == 0)
+      o.in_memory = true;
+    else if (strcmp(argv[i], "--throttle") == 0 && more){
+      char*end = nullptr;
+      throttle.latency_us = static_cast<uint32_t>(strtoul(argv[++i], &end, 10));
+      if (*end == ',')
+        throttle.bytes_per_second = strtoull(end + 1, nullptr, 10);
+      o.throttle = &throttle;
+    }
+    else if (strcmp(argv[i], "-o") == 0 && more)
+      out = argv[++i];
+    else if (argv[i][0] != '-')
+      dir = argv[i];
+    else{
+      fprintf(stderr, "usage: %s [--repeats n] [--seeks n] [--long] [--memory] [--throttle latency_us[,bytes_per_second]] [-o path] [dir]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::string json;
+  if (flv::run_benchmarks(dir, o, &json) != 0){
+    fprintf(stderr, "benchmark failed in %s\n", dir);
+    return 1;
+  }
+  auto f = out ? fopen(out, "wb") : stdout;
+  if (!f){
+    fprintf(stderr, "can't write %s\n", out);
+    return 1;
+  }
+  fwrite(json.data(), 1, json.size(), f);
+  if (out)
+    fclose(f);
+  return 0;
+}
@@ -1,20 +1,38 @@
 #include "bigendian.hpp"
+#include <cstring>
 #include <utility>
-#include <WinSock2.h>  // htond/ ntohd
+// byte order is decoded with shifts, no dependency on WinSock or host endianness
 namespace bigendian{
-uint64_t toui64(const uint8_t *input)
-{
-  return ntohll(*(const uint64_t*)input);
+uint64_t toui64(const uint8_t *input){
+  return (uint64_t(touint32(input)) << 32) | touint32(input + 4);
 }
 uint32_t touint32(uint8_t const*input){
-  return ntohl(*(const u_long*)input);
+  return (uint32_t(input[0]) << 24) | (uint32_t(input[1]) << 16) | (uint32_t(input[2]) << 8) | uint32_t(input[3]);
+}
+uint32_t touint24(uint8_t const*input){
+  return (uint32_t(input[0]) << 16) | (uint32_t(input[1]) << 8) | uint32_t(input[2]);
+}
+uint16_t touint16(uint8_t const*input){
+  return uint16_t((input[0] << 8) | input[1]);
+}
+uint8_t touint8(uint8_t const*input){
+  return input[0];
+}
+int32_t toint32(uint8_t const*input){
+  return static_cast<int32_t>(touint32(input));
+}
+int16_t toint16(uint8_t const*input){
+  return static_cast<int16_t>(touint16(input));
+}
+int8_t toint8(uint8_t const*input){
+  return static_cast<int8_t>(input[0]);
 }
 uint8_t binary_reader::byte(){
   auto v = data[pointer++];
   return v;
 }
 uint16_t binary_reader::ui16(){
-  auto v= ntohs(*(const u_short*)(data + pointer));
+  auto v = touint16(data + pointer);
   pointer += sizeof(uint16_t);
   return v;
 }
@@ -29,7 +47,7 @@ uint64_t binary_reader::ui64(){
   return v;
 }
 uint32_t binary_reader::ui24(){
-  auto v = (uint32_t(data[pointer] << 16)) | (uint32_t(data[pointer + 1]) << 8) | (uint32_t(data[pointer + 2]));
+  auto v = touint24(data + pointer);
   pointer += 3;// ui24
   return v;
 }
@@ -37,41 +55,70 @@ void binary_reader::skip(uint32_t bytes){
   pointer += bytes;
 }
 double binary_reader::numberic(){
-  const uint64_t* lv = reinterpret_cast<const uint64_t*>(data + pointer);
-  auto v = ntohd(*lv);
+  auto x = toui64(data + pointer);
+  double v;
+  memcpy(&v, &x, sizeof(v));
   pointer += sizeof(uint64_t);
   return v;
 }
 ::packet binary_reader::packet(uint32_t l){
-  auto v = ::packet(l);
-  memcpy_s(v._, v.length, data+pointer, l);
+  auto v = ::packet(data + pointer, l);
   pointer += l;
-  return std::move(v);
+  return v;
 }
 
-void binary_writer::ui32(uint32_t v){
-  const uint8_t *p = reinterpret_cast<const uint8_t*>(&v);
-  data[pointer]     = p[3];
-  data[pointer + 1] = p[2];
-  data[pointer + 2] = p[1];
-  data[pointer + 3] = p[0];
-  pointer += sizeof(uint32_t);
+// writes past length are dropped and mark the writer overflowed
+bool binary_writer::reserve(uint32_t bytes){
+  if (overflow || length - pointer < bytes)
+    overflow = true;
+  return !overflow;
 }
-void binary_writer::ui24(uint32_t v){
-  const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
-  data[pointer]     = p[2];
-  data[pointer + 1] = p[1];
-  data[pointer + 2] = p[0];
-  pointer += 3;
+void binary_writer::byte(uint8_t v){
+  if (reserve(1))
+    data[pointer++] = v;
 }
 void binary_writer::ui16(uint16_t v){
-  const uint8_t*p = reinterpret_cast<const uint8_t*>(&v);
-  data[pointer] = p[1];
-  data[pointer + 1] = p[0];
+  if (!reserve(sizeof(uint16_t)))
+    return;
+  data[pointer]     = uint8_t(v >> 8);
+  data[pointer + 1] = uint8_t(v);
   pointer += sizeof(uint16_t);
 }
+void binary_writer::ui24(uint32_t v){
+  if (!reserve(3))
+    return;
+  data[pointer]     = uint8_t(v >> 16);
+  data[pointer + 1] = uint8_t(v >> 8);
+  data[pointer + 2] = uint8_t(v);
+  pointer += 3;
+}
+void binary_writer::ui32(uint32_t v){
+  if (!reserve(sizeof(uint32_t)))
+    return;
+  data[pointer]     = uint8_t(v >> 24);
+  data[pointer + 1] = uint8_t(v >> 16);
+  data[pointer + 2] = uint8_t(v >> 8);
+  data[pointer + 3] = uint8_t(v);
+  pointer += sizeof(uint32_t);
+}
+void binary_writer::ui64(uint64_t v){
+  if (!reserve(sizeof(uint64_t)))  // not half of it
+    return;
+  ui32(uint32_t(v >> 32));
+  ui32(uint32_t(v));
+}
+void binary_writer::numberic(double v){
+  uint64_t x;
+  memcpy(&x, &v, sizeof(x));
+  ui64(x);
+}
+void binary_writer::bytes(uint8_t const*v, uint32_t l){
+  if (!l || !reserve(l))
+    return;
+  memcpy(data + pointer, v, l);
+  pointer += l;
+}
 void binary_writer::packet(::packet const&v){
-  memcpy_s(data + pointer, length - pointer, v._, v.length);
-  pointer += v.length;
+  bytes(v._, v.length);
+}
 }
-}
\ No newline at end of file
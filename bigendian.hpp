@@ -27,13 +27,20 @@ namespace bigendian{
     ::packet packet(uint32_t len);
     void     skip(uint32_t bytes);
   };
+  // bounds checked, a write that does not fit sets overflow and leaves data as it is
   struct binary_writer{
     uint8_t* data;
     uint32_t length;
     uint32_t pointer;
+    bool     overflow = false;
+    bool     reserve(uint32_t bytes);   // false if bytes do not fit
+    void     byte(uint8_t);
     void     ui16(uint16_t);
     void     ui24(uint32_t);
     void     ui32(uint32_t);
+    void     ui64(uint64_t);
+    void     numberic(double);
+    void     bytes(uint8_t const*v, uint32_t length);
     void     packet(::packet const&);
 
     binary_writer(const binary_writer&) = delete;
@@ -0,0 +1,32 @@
+#include "bigendian.hpp"
+#include <cstring>
+#include "test.hpp"
+
+FLV_TEST(binary_writer_round_trip){
+  uint8_t data[3 + 4 + 8 + 8];
+  bigendian::binary_writer w(data, sizeof(data));
+  w.ui24(0x123456);
+  w.ui32(0x89abcdef);
+  w.ui64(0x0102030405060708ull);
+  w.numberic(2.5);
+  FLV_CHECK(!w.overflow && w.pointer == sizeof(data));
+  bigendian::binary_reader r(data, sizeof(data));
+  FLV_CHECK(r.ui24() == 0x123456 && r.ui32() == 0x89abcdef && r.ui64() == 0x0102030405060708ull && r.numberic() == 2.5);
+}
+
+// a write that does not fit sets overflow and leaves the buffer and every later write alone
+FLV_TEST(binary_writer_overflow_writes_nothing){
+  uint8_t data[8];
+  memset(data, 0xee, sizeof(data));
+  bigendian::binary_writer w(data, 6);
+  w.ui16(0x0102);
+  w.ui64(0x0304050607080900ull);  // 8 bytes where 4 are left
+  FLV_CHECK(w.overflow && w.pointer == 2);
+  w.byte(0x0a);  // would fit, but the writer has overflowed
+  uint8_t const more[] = { 1, 2 };
+  w.bytes(more, sizeof(more));
+  FLV_CHECK(w.pointer == 2);
+  FLV_CHECK(data[0] == 0x01 && data[1] == 0x02);
+  for (int i = 2; i < 8; ++i)
+    FLV_CHECK(data[i] == 0xee);
+}
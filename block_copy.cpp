@@ -0,0 +1,38 @@
+#include "block_copy.hpp"
+#include <algorithm>
+
+// bytes read into user space at a time, enough for a tag header and small audio or sequence header tags.
+// the rest of a bigger tag is past the block and goes through copy_range
+const static uint32_t block_copy_size = 4096;
+
+flv::block_copy::block_copy(file&from, file&to, uint64_t from_pos, uint64_t to_pos)
+  : in(from), out(to), block(block_copy_size), block_pos(from_pos), copied(from_pos), out_pos(to_pos){
+}
+
+int32_t flv::block_copy::fill(uint64_t pos){
+  auto cb = in.read(pos, block.data(), static_cast<uint32_t>(block.size()));
+  if (cb < 0)
+    return -1;
+  block_pos = pos;
+  block_len = static_cast<uint32_t>(cb);
+  return 0;
+}
+
+int32_t flv::block_copy::flush(uint64_t upto){
+  auto block_end = block_pos + block_len;
+  if (copied >= block_pos && copied < block_end && copied < upto){
+    auto n = static_cast<uint32_t>(std::min(block_end, upto) - copied);
+    if (out.write(out_pos, at(copied), n) != n)
+      return -1;
+    copied += n;
+    out_pos += n;
+  }
+  if (copied < upto){
+    auto length = upto - copied;
+    if (flv::copy_range(in, copied, out, out_pos, length) != static_cast<int64_t>(length))
+      return -1;
+    copied += length;
+    out_pos += length;
+  }
+  return 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "file_io.hpp"
+
+namespace flv{
+// copies a byte range of one file to another through a small block the caller may patch.
+// a block is filled at each tag header the block does not hold, so most payload bytes
+// lie outside it and are copied by copy_range without being read
+struct block_copy{
+  block_copy(file&from, file&to, uint64_t from_pos, uint64_t to_pos);
+
+  int32_t  fill(uint64_t pos);                 // reads the block at pos, 0: ok, -1: error
+  int32_t  flush(uint64_t upto);               // writes source bytes up to upto, 0: ok, -1: error
+  void     skip(uint64_t upto){ copied = upto; }  // drops source bytes, flush first
+  bool     holds(uint64_t pos, uint64_t length)const{
+    return pos >= block_pos && pos + length <= block_pos + block_len;
+  }
+  uint32_t available(uint64_t pos)const{ return static_cast<uint32_t>(block_pos + block_len - pos); }
+  uint8_t* at(uint64_t pos){ return block.data() + (pos - block_pos); }
+  uint64_t output_position(uint64_t pos)const{ return out_pos + (pos - copied); }  // pos at or after copied
+
+  file                &in;
+  file                &out;
+  std::vector<uint8_t> block;
+  uint64_t             block_pos = 0;  // fileposition of block[0]
+  uint32_t             block_len = 0;
+  uint64_t             copied    = 0;  // source position written or skipped so far
+  uint64_t             out_pos   = 0;  // output position of copied
+};
+}
@@ -1,23 +1,25 @@
+#include <algorithm>
 #include <cassert>
-#include <windows.h>
+#include <cstring>
 #include "buffer.hpp"
 
+const static uint32_t buffer_min_allocation = 4096;
+
 uint8_t* buffer::current()
 {
     return _ + pointer;
 }
 
-void buffer::reset(uint32_t sz) {
-  count = 0;
-  pointer = 0;
-  allocate(sz);
+uint8_t* buffer::tail()
+{
+    return _ + count;
 }
 
 //-------------------------------------------------------------------
 // size
-// Returns the size of the buffer.
+// Returns the number of unread bytes.
 //
-// Note: The "size" is determined by the start and end pointers.
+// Note: The "size" is determined by the read and write cursors.
 // The memory allocated for the buffer can be larger.
 //-------------------------------------------------------------------
 
@@ -26,12 +28,56 @@ uint32_t buffer::size() const
     return count - pointer;
 }
 
-// Reserves memory for the array, but does not increase the count.
+uint32_t buffer::room() const
+{
+    return allocated - count;
+}
+
+void buffer::consume(uint32_t cb)
+{
+  assert(cb <= size());
+  pointer += cb;
+  if (pointer == count)
+    pointer = count = 0;  // empty, the next read starts at the front for free
+}
+
+// compacts when the unread bytes take at most half of the allocation and that makes room,
+// otherwise grows geometrically. either way only unread bytes are copied
+int32_t buffer::reserve(uint32_t cb) {
+  if (room() >= cb)
+    return 0;
+  auto unread = size();
+  if (uint64_t(unread) + cb > limit)
+    return -1;
+  if (unread + cb <= allocated && unread <= allocated / 2) {
+    memmove(_, _ + pointer, unread);
+    pointer = 0;
+    count = unread;
+    return 0;
+  }
+  uint32_t alloc = buffer_min_allocation;
+  while (alloc < unread + cb || (alloc <= allocated && alloc < limit))
+    alloc = alloc > limit / 2 ? limit : alloc * 2;
+  alloc = std::min(alloc, limit);  // a limit below the minimum allocation
+  if (alloc > allocated)
+    allocate(alloc);
+  else {
+    memmove(_, _ + pointer, unread);  // at the limit already, compacting is all that is left
+    pointer = 0;
+    count = unread;
+  }
+  return 0;
+}
+
+// Reallocates to alloc bytes, unread bytes are moved to the front of the new allocation.
 void buffer::allocate(uint32_t alloc) {
   if (alloc > allocated) {
     auto tmp = new uint8_t[alloc];
-    assert(pointer <= allocated);
-    memcpy_s(tmp, alloc, _, allocated);
+    assert(pointer <= count && count <= allocated);
+    if (count > pointer)
+      memcpy(tmp, _ + pointer, count - pointer);
+    count -= pointer;
+    pointer = 0;
     delete[] _;
     _ = tmp;
     allocated = alloc;
@@ -40,5 +86,6 @@ void buffer::allocate(uint32_t alloc) {
 
 void buffer::move_end(uint32_t cb)
 {
+  assert(cb <= room());
   count += cb;
 }
@@ -1,6 +1,10 @@
 #pragma once
 #include <cstdint>
 
+// compacting byte buffer with separate read and write cursors
+// [pointer, count) are unread bytes, [count, allocated) is room for the next read.
+// parsers append partial reads with tail/move_end and drop parsed bytes with consume,
+// unread bytes are moved to the front only when the room runs out
 struct buffer
 {
   buffer()              = default;
@@ -10,17 +14,22 @@ struct buffer
   {
     delete[] _;
   }
-  uint8_t*   current();
-  uint32_t   size() const;
+  uint8_t*   current();       // first unread byte
+  uint32_t   size() const;    // unread bytes, contiguous from current()
+  uint8_t*   tail();          // where the next read goes
+  uint32_t   room() const;    // bytes that fit at tail()
 
   // move_end: Moves the end of the buffer.
   // Call this method after reading data into the buffer.
-  void move_end(uint32_t cb);
-  void reset(uint32_t cb);  // reset buffer and reserve
+  void    move_end(uint32_t cb);
+  void    consume(uint32_t cb);    // drops cb parsed bytes from the front
+  int32_t reserve(uint32_t cb);    // room for cb more bytes, unread bytes are kept. -1: over limit
+
+  uint32_t limit = 64 << 20;       // hard cap of the allocation
 private:
   void      allocate(uint32_t alloc);
   uint8_t  *_         = nullptr;
-  uint32_t  count     = 0;
+  uint32_t  count     = 0;              // 1 past the last unread byte
   uint32_t  allocated = 0;              // Actual allocation size.
-  uint32_t  pointer   = 0;              // 1 past the last element
+  uint32_t  pointer   = 0;              // first unread byte
 };
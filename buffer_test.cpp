@@ -0,0 +1,57 @@
+#include "buffer.hpp"
+#include <cstring>
+#include "test.hpp"
+
+namespace{
+// appends n bytes counting up from first, like a partial read
+void append(buffer&b, uint32_t n, uint8_t first){
+  for (uint32_t i = 0; i < n; ++i)
+    b.tail()[i] = uint8_t(first + i);
+  b.move_end(n);
+}
+}
+
+FLV_TEST(buffer_keeps_unread_bytes_across_reads){
+  buffer b;
+  FLV_CHECK(b.reserve(10) == 0 && b.room() >= 10);
+  append(b, 10, 0);
+  b.consume(6);  // a parser took the first six
+  FLV_CHECK(b.size() == 4 && b.current()[0] == 6);
+
+  // a read larger than the allocation grows it, the unread bytes stay in front
+  FLV_CHECK(b.reserve(100000) == 0 && b.room() >= 100000);
+  FLV_CHECK(b.size() == 4 && b.current()[0] == 6 && b.current()[3] == 9);
+  append(b, 100000, 10);
+  FLV_CHECK(b.size() == 100004 && b.current()[4] == 10);
+
+  // consuming everything rewinds to the front, the next read needs no copy
+  b.consume(b.size());
+  FLV_CHECK(b.size() == 0 && b.tail() == b.current());
+}
+
+FLV_TEST(buffer_compacts_before_growing_and_stops_at_the_limit){
+  buffer b;
+  FLV_CHECK(b.reserve(4096) == 0);
+  auto room = b.room();
+  append(b, room, 1);
+  b.consume(room - 8);
+  auto front = b.current();
+  FLV_CHECK(b.reserve(1000) == 0);  // eight unread bytes are moved down instead of reallocating
+  FLV_CHECK(b.room() + b.size() == room && b.size() == 8 && b.current()[0] == uint8_t(1 + room - 8));
+  FLV_CHECK(b.current() != front);
+
+  buffer small;
+  small.limit = 1 << 16;
+  FLV_CHECK(small.reserve(1 << 16) == 0);
+  append(small, 16, 0);
+  FLV_CHECK(small.reserve(1 << 16) == -1);  // unread and requested bytes exceed the limit
+  FLV_CHECK(small.size() == 16);
+}
+
+FLV_TEST(buffer_allocation_stays_under_a_small_limit){
+  buffer b;
+  b.limit = 1000;
+  FLV_CHECK(b.reserve(10) == 0);
+  FLV_CHECK(b.room() == 1000);  // not the 4096 bytes of the minimum allocation
+  FLV_CHECK(b.reserve(1001) == -1);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+namespace flv{
+// random access source of flv bytes, a file, memory or anything wrapping them
+struct byte_source{
+  virtual ~byte_source() = default;
+  // reads up to length bytes at pos
+  // returns bytes read, less than length only at end of file, -1 on error
+  virtual int64_t read(uint64_t pos, void*data, uint32_t length) = 0;
+  virtual int32_t size(uint64_t*v) = 0;   // 0: ok, -1: error
+};
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// language and crt features v120 (visual studio 2013) lacks
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define FLV_NOEXCEPT throw()
+// always terminated, returns -1 instead of the full length when the output is cut
+#define FLV_SNPRINTF(buffer, size, ...) _snprintf_s(buffer, size, _TRUNCATE, __VA_ARGS__)
+#else
+#define FLV_NOEXCEPT noexcept
+#define FLV_SNPRINTF snprintf
+#endif
@@ -0,0 +1,248 @@
+#include "file_io.hpp"
+#include <vector>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <climits>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+const static uint32_t copy_block_size = 1 << 20;
+
+flv::file::~file(){
+  close();
+}
+
+#ifdef _WIN32
+static void* open_file(char const*path, DWORD access, DWORD disposition){
+  auto h = CreateFileA(path, access, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+  return h == INVALID_HANDLE_VALUE ? nullptr : h;
+}
+int32_t flv::file::open(char const*path){
+  close();
+  handle = open_file(path, GENERIC_READ, OPEN_EXISTING);
+  return handle ? 0 : -1;
+}
+int32_t flv::file::open_rw(char const*path){
+  close();
+  handle = open_file(path, GENERIC_READ | GENERIC_WRITE, OPEN_EXISTING);
+  return handle ? 0 : -1;
+}
+int32_t flv::file::create(char const*path){
+  close();
+  handle = open_file(path, GENERIC_READ | GENERIC_WRITE, CREATE_ALWAYS);
+  return handle ? 0 : -1;
+}
+void flv::file::close(){
+  if (handle)
+    CloseHandle(handle);
+  handle = nullptr;
+}
+bool flv::file::is_open()const{
+  return handle != nullptr;
+}
+int64_t flv::file::read(uint64_t pos, void*data, uint32_t length){
+  uint32_t done = 0;
+  while (done < length){
+    OVERLAPPED ov = {};
+    ov.Offset = static_cast<DWORD>(pos + done);
+    ov.OffsetHigh = static_cast<DWORD>((pos + done) >> 32);
+    DWORD cb = 0;
+    if (!ReadFile(handle, static_cast<uint8_t*>(data) + done, length - done, &cb, &ov))
+      return GetLastError() == ERROR_HANDLE_EOF ? done : -1;
+    if (cb == 0)
+      break;
+    done += cb;
+  }
+  return done;
+}
+int64_t flv::file::write(uint64_t pos, void const*data, uint32_t length){
+  uint32_t done = 0;
+  while (done < length){
+    OVERLAPPED ov = {};
+    ov.Offset = static_cast<DWORD>(pos + done);
+    ov.OffsetHigh = static_cast<DWORD>((pos + done) >> 32);
+    DWORD cb = 0;
+    if (!WriteFile(handle, static_cast<uint8_t const*>(data) + done, length - done, &cb, &ov))
+      return -1;
+    done += cb;
+  }
+  return done;
+}
+int64_t flv::file::write(uint64_t pos, io_slice const*v, uint32_t count){
+  uint64_t done = 0;
+  for (uint32_t i = 0; i < count; ++i){
+    if (v[i].length && write(pos + done, v[i].data, v[i].length) < 0)
+      return -1;
+    done += v[i].length;
+  }
+  return static_cast<int64_t>(done);
+}
+int32_t flv::file::size(uint64_t*v){
+  LARGE_INTEGER l;
+  if (!GetFileSizeEx(handle, &l))
+    return -1;
+  *v = static_cast<uint64_t>(l.QuadPart);
+  return 0;
+}
+int32_t flv::file::truncate(uint64_t length){
+  FILE_END_OF_FILE_INFO eof;
+  eof.EndOfFile.QuadPart = static_cast<LONGLONG>(length);
+  return SetFileInformationByHandle(handle, FileEndOfFileInfo, &eof, sizeof(eof)) ? 0 : -1;
+}
+#else
+int32_t flv::file::open(char const*path){
+  close();
+  fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  return fd >= 0 ? 0 : -1;
+}
+int32_t flv::file::open_rw(char const*path){
+  close();
+  fd = ::open(path, O_RDWR | O_CLOEXEC);
+  return fd >= 0 ? 0 : -1;
+}
+int32_t flv::file::create(char const*path){
+  close();
+  fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  return fd >= 0 ? 0 : -1;
+}
+void flv::file::close(){
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+}
+bool flv::file::is_open()const{
+  return fd >= 0;
+}
+int64_t flv::file::read(uint64_t pos, void*data, uint32_t length){
+  uint32_t done = 0;
+  while (done < length){
+    auto cb = pread(fd, static_cast<uint8_t*>(data) + done, length - done, static_cast<off_t>(pos + done));
+    if (cb < 0 && errno == EINTR)
+      continue;
+    if (cb < 0)
+      return -1;
+    if (cb == 0)
+      break;
+    done += static_cast<uint32_t>(cb);
+  }
+  return done;
+}
+int64_t flv::file::write(uint64_t pos, void const*data, uint32_t length){
+  uint32_t done = 0;
+  while (done < length){
+    auto cb = pwrite(fd, static_cast<uint8_t const*>(data) + done, length - done, static_cast<off_t>(pos + done));
+    if (cb < 0 && errno == EINTR)
+      continue;
+    if (cb <= 0)
+      return -1;
+    done += static_cast<uint32_t>(cb);
+  }
+  return done;
+}
+int64_t flv::file::write(uint64_t pos, io_slice const*v, uint32_t count){
+  const static uint32_t max_slices = 64;
+  struct iovec iov[max_slices];
+  uint64_t done = 0;
+  uint32_t i = 0;
+  size_t skip = 0;  // bytes of v[i] already written
+  for (;;){
+    for (; i < count && v[i].length == skip; ++i)
+      skip = 0;
+    if (i == count)
+      break;
+    uint32_t n = 0;
+    for (auto j = i; j < count && n < max_slices && n < IOV_MAX; ++j, ++n){
+      iov[n].iov_base = const_cast<uint8_t*>(static_cast<uint8_t const*>(v[j].data)) + (j == i ? skip : 0);
+      iov[n].iov_len = v[j].length - (j == i ? skip : 0);
+    }
+    auto cb = pwritev(fd, iov, static_cast<int>(n), static_cast<off_t>(pos + done));
+    if (cb < 0 && errno == EINTR)
+      continue;
+    if (cb <= 0)
+      return -1;
+    done += static_cast<uint64_t>(cb);
+    // advance over fully written slices, a short write resumes inside a slice
+    size_t left = static_cast<size_t>(cb) + skip;
+    while (i < count && left >= v[i].length){
+      left -= v[i].length;
+      ++i;
+    }
+    skip = left;
+  }
+  return static_cast<int64_t>(done);
+}
+int32_t flv::file::size(uint64_t*v){
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    return -1;
+  *v = static_cast<uint64_t>(st.st_size);
+  return 0;
+}
+int32_t flv::file::truncate(uint64_t length){
+  return ftruncate(fd, static_cast<off_t>(length)) == 0 ? 0 : -1;
+}
+#endif
+
+// read and write through a user space buffer
+static int64_t buffered_copy(flv::file&from, uint64_t from_pos, flv::file&to, uint64_t to_pos, uint64_t length){
+  std::vector<uint8_t> block(static_cast<size_t>(std::min<uint64_t>(length, copy_block_size)));
+  uint64_t done = 0;
+  while (done < length){
+    auto n = static_cast<uint32_t>(std::min<uint64_t>(length - done, block.size()));
+    auto cb = from.read(from_pos + done, block.data(), n);
+    if (cb < 0)
+      return -1;
+    if (cb > 0 && to.write(to_pos + done, block.data(), static_cast<uint32_t>(cb)) < 0)
+      return -1;
+    done += cb;
+    if (cb < n)
+      break;
+  }
+  return static_cast<int64_t>(done);
+}
+
+int64_t flv::copy_range(file&from, uint64_t from_pos, file&to, uint64_t to_pos, uint64_t length){
+#ifdef __linux__
+  uint64_t done = 0;
+  // copy_file_range shares extents or copies inside the kernel
+  while (done < length){
+    loff_t in = static_cast<loff_t>(from_pos + done);
+    loff_t out = static_cast<loff_t>(to_pos + done);
+    auto cb = copy_file_range(from.fd, &in, to.fd, &out, static_cast<size_t>(length - done), 0);
+    if (cb < 0 && errno == EINTR)
+      continue;
+    if (cb <= 0)
+      break;
+    done += static_cast<uint64_t>(cb);
+  }
+  if (done == length)
+    return static_cast<int64_t>(done);
+  // sendfile writes at the file pointer of the destination
+  if (lseek(to.fd, static_cast<off_t>(to_pos + done), SEEK_SET) >= 0){
+    while (done < length){
+      off_t in = static_cast<off_t>(from_pos + done);
+      auto cb = sendfile(to.fd, from.fd, &in, static_cast<size_t>(std::min<uint64_t>(length - done, 0x7ffff000)));
+      if (cb < 0 && errno == EINTR)
+        continue;
+      if (cb <= 0)
+        break;
+      done += static_cast<uint64_t>(cb);
+    }
+  }
+  if (done == length)
+    return static_cast<int64_t>(done);
+  auto rest = buffered_copy(from, from_pos + done, to, to_pos + done, length - done);
+  return rest < 0 ? -1 : static_cast<int64_t>(done + rest);
+#else
+  return buffered_copy(from, from_pos, to, to_pos, length);
+#endif
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include "byte_source.hpp"
+
+namespace flv{
+// one buffer of a vectored write
+struct io_slice{
+  void const* data;
+  uint32_t    length;
+};
+
+// positional file i/o, no shared file pointer
+struct file : public byte_source{
+  file() = default;
+  file(file const&) = delete;
+  file&operator=(file const&) = delete;
+  ~file();
+
+  int32_t open(char const*path);      // read only
+  int32_t open_rw(char const*path);   // read and write an existing file
+  int32_t create(char const*path);    // read and write, truncated
+  void    close();
+  bool    is_open()const;
+
+  int64_t read(uint64_t pos, void*data, uint32_t length) override;
+  int64_t write(uint64_t pos, void const*data, uint32_t length);  // returns length or -1
+  int64_t write(uint64_t pos, io_slice const*v, uint32_t count);   // pwritev, returns bytes or -1
+  int32_t size(uint64_t*v) override;
+  int32_t truncate(uint64_t length);
+
+#ifdef _WIN32
+  void*   handle = nullptr;
+#else
+  int     fd     = -1;
+#endif
+};
+
+// copies length bytes from one file to another without passing them through user space
+// if the platform allows it, copy_file_range then sendfile on linux, buffered copy elsewhere
+// returns bytes copied, less than length if from ends early, -1 on error
+int64_t copy_range(file&from, uint64_t from_pos, file&to, uint64_t to_pos, uint64_t length);
+}
@@ -0,0 +1,502 @@
+#include "flv_bench.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include "compat.hpp"
+#include "file_io.hpp"
+#include "flv_block_cache.hpp"
+#include "flv_gop_prefetch.hpp"
+#include "flv_push_parser.hpp"
+#include "flv_reader.hpp"
+#include "flv_uring.hpp"
+#include "keyframes.hpp"
+#include "ts_remux.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi")
+#else
+#include <sys/resource.h>
+#endif
+
+std::atomic<uint64_t> flv::bench_allocations{ 0 };
+
+#ifdef FLV_BENCH_COUNT_ALLOCATIONS
+void* operator new(size_t n){
+  flv::bench_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto p = malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void*p)FLV_NOEXCEPT{ free(p); }
+void operator delete(void*p, size_t)FLV_NOEXCEPT{ free(p); }
+#endif
+
+const static uint32_t scrub_frames = 5;  // video frames a demuxer reads after a scrub seek
+
+namespace{
+using bench_clock = std::chrono::steady_clock;
+
+double elapsed_us(bench_clock::time_point since){
+  return std::chrono::duration<double, std::micro>(bench_clock::now() - since).count();
+}
+
+double median(std::vector<double> v){
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  return v[v.size() / 2];
+}
+
+double percentile(std::vector<double> const&sorted, double p){
+  if (sorted.empty())
+    return 0;
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+uint64_t peak_rss(){
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS c;
+  return GetProcessMemoryInfo(GetCurrentProcess(), &c, sizeof(c)) ? c.PeakWorkingSetSize : 0;
+#else
+  rusage u;
+  if (getrusage(RUSAGE_SELF, &u) != 0)
+    return 0;
+#ifdef __APPLE__
+  return static_cast<uint64_t>(u.ru_maxrss);
+#else
+  return static_cast<uint64_t>(u.ru_maxrss) * 1024;  // kilobytes
+#endif
+#endif
+}
+
+struct counting_sink : public flv::push_parser_sink{
+  uint32_t tags = 0;
+  int32_t on_tag_begin(flv::push_tag const&)override{ return 0; }
+  int32_t on_tag_data(uint8_t const*, uint32_t)override{ return 0; }
+  int32_t on_tag_end(flv::push_tag const&)override{ ++tags; return 0; }
+};
+
+// one of the push demuxes driven through io_uring, a finished read feeds the parser and submits the next
+struct uring_stream{
+  uring_stream() : parser(&sink){}
+
+  counting_sink      sink;
+  flv::push_parser   parser;
+  flv::uring_source *ring   = nullptr;
+  flv::uring_read    r;
+  uint32_t           buffer = 0;  // pool buffer the reads go to
+  uint32_t           length = 0;
+
+  int32_t submit(uint64_t pos){
+    r.pos = pos;
+    r.data = ring->pool_buffer(buffer);
+    r.length = length;
+    r.buffer = static_cast<int32_t>(buffer);
+    r.user = this;
+    r.done = &uring_stream::finished;
+    return ring->submit(&r);
+  }
+  static void finished(flv::uring_read*r){
+    auto s = static_cast<uring_stream*>(r->user);
+    if (r->result > 0 && s->parser.feed(s->ring->pool_buffer(s->buffer), static_cast<size_t>(r->result)) == 0)
+      s->submit(r->pos + static_cast<uint64_t>(r->result));
+  }
+};
+
+struct discarding_ts_sink : public flv::ts_sink{
+  uint64_t bytes = 0;
+  int32_t write(uint8_t const*, uint32_t length)override{ bytes += length; return 0; }
+};
+
+// the file or its bytes in memory, and a throttled copy of the options' source in front of it
+struct bench_source{
+  flv::file              f;
+  std::vector<uint8_t>   bytes;
+  flv::memory_source     memory{ nullptr, 0 };
+  flv::throttled_source  throttle{ &f };
+  flv::byte_source      *source = &f;
+  int32_t open(char const*path, flv::bench_options const&o){
+    if (f.open(path) != 0)
+      return -1;
+    if (o.in_memory){
+      uint64_t size = 0;
+      if (f.size(&size) != 0 || size > UINT32_MAX)
+        return -1;
+      bytes.resize(static_cast<size_t>(size));
+      if (f.read(0, bytes.data(), static_cast<uint32_t>(size)) != int64_t(size))
+        return -1;
+      memory = flv::memory_source(bytes);
+      source = &memory;
+    }
+    if (o.throttle){
+      throttle = *o.throttle;
+      throttle.source = source;
+      throttle.sleep = false;
+      throttle.reset();
+      source = &throttle;
+    }
+    return 0;
+  }
+};
+
+// the tags of the first scrub_frames video frames from the keyframe tag at pos
+void read_frames(flv::reader&rd, uint64_t pos){
+  flv::raw_tag t;
+  packet p;
+  for (uint32_t frames = 0; frames < scrub_frames && rd.read_tag(pos, &t) == 0 && rd.read_data(t, &p) == 0; pos = t.next()){
+    if (t.type == flv::tag_type::video)
+      ++frames;
+  }
+}
+
+// scrub targets, stepping forward through the file and back again
+std::vector<uint32_t> scrub_targets(uint32_t seeks, uint64_t duration_ms){
+  std::vector<uint32_t> v;
+  auto half = std::max<uint32_t>(seeks / 2, 1);
+  for (uint32_t i = 0; i < half; ++i)
+    v.push_back(static_cast<uint32_t>(duration_ms * i / half));
+  for (uint32_t i = half; i-- > 0;)
+    v.push_back(static_cast<uint32_t>(duration_ms * i / half));
+  return v;
+}
+
+void json_number(std::string&s, char const*key, double v, bool last = false){
+  char b[96];
+  FLV_SNPRINTF(b, sizeof(b), "      \"%s\": %.15g%s\n", key, v, last ? "" : ",");
+  s += b;
+}
+}
+
+std::vector<flv::bench_case> flv::bench_corpus(bool long_corpus){
+  std::vector<bench_case> v;
+  bench_case c;
+  c.name = "720p_1min";
+  c.synth.width = 1280;
+  c.synth.height = 720;
+  v.push_back(c);
+  c.name = "1080p_10min_interleave500";
+  c.synth = synth_options();
+  c.synth.width = 1920;
+  c.synth.height = 1080;
+  c.synth.duration_ms = 10 * 60 * 1000;
+  c.synth.interleave_ms = 500;
+  v.push_back(c);
+  c.name = "360p_10min_gop250_no_keyframes";
+  c.synth = synth_options();
+  c.synth.width = 640;
+  c.synth.height = 360;
+  c.synth.duration_ms = 10 * 60 * 1000;
+  c.synth.gop_frames = 250;
+  c.synth.meta_keyframes = false;
+  v.push_back(c);
+  c.name = "audio_only_10min";
+  c.synth = synth_options();
+  c.synth.video = false;
+  c.synth.duration_ms = 10 * 60 * 1000;
+  v.push_back(c);
+  if (long_corpus){
+    c.name = "360p_10h";
+    c.synth = synth_options();
+    c.synth.width = 640;
+    c.synth.height = 360;
+    c.synth.duration_ms = 10 * 3600 * 1000;
+    v.push_back(c);
+  }
+  return v;
+}
+
+int32_t flv::bench_file(char const*name, char const*path, bench_options const&o, bench_metrics*v){
+  *v = bench_metrics();
+  v->name = name;
+  demux_instruments().reset();
+  auto repeats = std::max<uint32_t>(o.repeats, 1);
+
+  // open
+  std::vector<double> times;
+  for (uint32_t i = 0; i < repeats; ++i){
+    bench_source s;
+    if (s.open(path, o) != 0)
+      return -1;
+    flv::reader rd(s.source);
+    auto t0 = bench_clock::now();
+    if (rd.open() != 0)
+      return -1;
+    times.push_back(elapsed_us(t0));
+    v->open_simulated_us = s.throttle.elapsed_us;
+    v->bytes = rd.file_size;
+  }
+  v->open_us = median(times);
+
+  // full demux with the reader
+  times.clear();
+  for (uint32_t i = 0; i < repeats; ++i){
+    bench_source s;
+    if (s.open(path, o) != 0)
+      return -1;
+    flv::reader rd(s.source);
+    if (rd.open() != 0)
+      return -1;
+    raw_tag t;
+    packet p;
+    uint32_t tags = 0;
+    auto allocations = bench_allocations.load();
+    auto t0 = bench_clock::now();
+    for (auto pos = rd.first_tag; rd.read_tag(pos, &t) == 0 && rd.read_data(t, &p) == 0; pos = t.next())
+      ++tags;
+    times.push_back(elapsed_us(t0));
+    v->tags = tags;
+    v->demux_simulated_us = s.throttle.elapsed_us;
+#ifdef FLV_BENCH_COUNT_ALLOCATIONS
+    v->allocations_per_tag = tags ? double(bench_allocations.load() - allocations) / tags : 0;
+#else
+    (void)allocations;
+#endif
+  }
+  auto us = std::max(median(times), 1.0);
+  v->demux_tags_per_second = v->tags / us * 1e6;
+  v->demux_gb_per_second = v->bytes / us / 1e3;
+
+  // full demux again through the block cache, reads of the reader reach the source in blocks
+  times.clear();
+  for (uint32_t i = 0; i < repeats; ++i){
+    bench_source s;
+    if (s.open(path, o) != 0)
+      return -1;
+    flv::block_cache_source cache(s.source);
+    flv::reader rd(&cache);
+    if (rd.open() != 0)
+      return -1;
+    raw_tag t;
+    packet p;
+    auto simulated = s.throttle.elapsed_us;
+    auto t0 = bench_clock::now();
+    for (auto pos = rd.first_tag; rd.read_tag(pos, &t) == 0 && rd.read_data(t, &p) == 0; pos = t.next())
+      ;
+    times.push_back(elapsed_us(t0));
+    v->cached_demux_simulated_us = s.throttle.elapsed_us - simulated;
+    v->cache_source_reads = cache.source_reads;
+    v->cache_amplification = cache.amplification();
+  }
+  us = std::max(median(times), 1.0);
+  v->cached_demux_tags_per_second = v->tags / us * 1e6;
+
+  // push parser fed in chunks
+  times.clear();
+  std::vector<uint8_t> chunk(std::max<uint32_t>(o.chunk, 1));
+  uint32_t push_tags = 0;
+  for (uint32_t i = 0; i < repeats; ++i){
+    bench_source s;
+    if (s.open(path, o) != 0)
+      return -1;
+    counting_sink sink;
+    flv::push_parser parser(&sink);
+    auto t0 = bench_clock::now();
+    uint64_t pos = 0;
+    for (int64_t cb; (cb = s.source->read(pos, chunk.data(), static_cast<uint32_t>(chunk.size()))) > 0; pos += static_cast<uint64_t>(cb)){
+      if (parser.feed(chunk.data(), static_cast<size_t>(cb)) != 0)
+        return -1;
+    }
+    times.push_back(elapsed_us(t0));
+    push_tags = sink.tags;
+  }
+  us = std::max(median(times), 1.0);
+  v->push_tags_per_second = push_tags / us * 1e6;
+  v->push_gb_per_second = v->bytes / us / 1e3;
+
+  // uring_streams push demuxes of the file at once, one thread submits and completes all their reads
+  // through io_uring. linux only, the throttle does not apply
+  if (o.uring_streams){
+    flv::uring_source ring;
+    auto n = o.uring_streams;
+    if (ring.open(path, n) == 0 && ring.register_pool(n, static_cast<uint32_t>(chunk.size())) == 0){
+      std::unique_ptr<uring_stream[]> streams(new uring_stream[n]);
+      auto t0 = bench_clock::now();
+      for (uint32_t i = 0; i < n; ++i){
+        streams[i].ring = &ring;
+        streams[i].buffer = i;
+        streams[i].length = static_cast<uint32_t>(chunk.size());
+        streams[i].submit(0);
+      }
+      while (ring.in_flight && ring.complete(1) >= 0)
+        ;
+      us = std::max(elapsed_us(t0), 1.0);
+      uint32_t complete = 0;
+      for (uint32_t i = 0; i < n; ++i)
+        complete += streams[i].sink.tags == push_tags ? 1 : 0;
+      if (complete == n){
+        v->uring_push_gb_per_second = double(v->bytes) * n / us / 1e3;
+        v->uring_enters = ring.enters;
+      }
+    }
+  }
+
+  // remux to mpeg-ts, the packets are dropped
+  times.clear();
+  for (uint32_t i = 0; i < repeats; ++i){
+    bench_source s;
+    if (s.open(path, o) != 0)
+      return -1;
+    flv::ts_remuxer ts(s.source);
+    if (ts.open() != 0)
+      return -1;
+    discarding_ts_sink sink;
+    auto t0 = bench_clock::now();
+    ts.sink = &sink;
+    if (ts.tables() != 0 || ts.remux_range(ts.rd.first_media_tag, ts.rd.file_size, &sink) != 0 || ts.flush() != 0)
+      return -1;
+    times.push_back(elapsed_us(t0));
+  }
+  v->ts_mb_per_second = v->bytes / std::max(median(times), 1.0);
+
+  // seeks to random times, keyframe lookup and its tag read
+  {
+    bench_source s;
+    if (s.open(path, o) != 0)
+      return -1;
+    flv::reader rd(s.source);
+    ::keyframes index;
+    if (rd.open() != 0)
+      return -1;
+    // files without keyframes have nothing to seek to
+    if (rd.keyframe_index(&index) == 0 && !index.empty()){
+      auto open_us = s.throttle.elapsed_us;
+      uint64_t state = o.seed;
+      times.clear();
+      raw_tag t;
+      packet p;
+      for (uint32_t i = 0; i < o.seeks; ++i){
+        state = state * 6364136223846793005ull + 1442695040888963407ull;  // lcg, the same targets everywhere
+        auto target = (state >> 33) % (uint64_t(index.times.back()) + 1);
+        auto t0 = bench_clock::now();
+        auto k = index.seek(target);
+        if (rd.read_tag(k.position, &t) == 0)
+          rd.read_data(t, &p);
+        times.push_back(elapsed_us(t0));
+      }
+      std::sort(times.begin(), times.end());
+      v->seek_p50_us = percentile(times, 0.5);
+      v->seek_p90_us = percentile(times, 0.9);
+      v->seek_p99_us = percentile(times, 0.99);
+      v->seek_max_us = times.empty() ? 0 : times.back();
+      v->seek_simulated_us = s.throttle.elapsed_us - open_us;
+    }
+  }
+
+  // scrubbing, the first frames after each seek read directly and through the gop prefetch
+  {
+    bench_source s;
+    if (s.open(path, o) != 0)
+      return -1;
+    flv::reader rd(s.source);
+    ::keyframes index;
+    if (rd.open() != 0)
+      return -1;
+    if (rd.keyframe_index(&index) == 0 && !index.empty()){
+      auto targets = scrub_targets(o.scrub_seeks, index.times.back() / 10000);
+      auto simulated = s.throttle.elapsed_us;
+      auto t0 = bench_clock::now();
+      for (auto ms : targets)
+        read_frames(rd, index.seek(uint64_t(ms) * 10000).position);
+      v->scrub_us = elapsed_us(t0);
+      v->scrub_simulated_us = s.throttle.elapsed_us - simulated;
+    }
+
+    bench_source ps;
+    if (ps.open(path, o) != 0)
+      return -1;
+    flv::gop_prefetch_source prefetch(ps.source);
+    flv::reader prd(&prefetch);
+    if (prd.open() != 0)
+      return -1;
+    if (prefetch.open() == 0){
+      auto targets = scrub_targets(o.scrub_seeks, prefetch.gops.index.times.back() / 10000);
+      auto simulated = ps.throttle.elapsed_us;
+      auto t0 = bench_clock::now();
+      uint64_t pos = 0;
+      for (auto ms : targets){
+        if (prefetch.seek(ms, &pos) != 0)
+          return -1;
+        read_frames(prd, pos);
+        prefetch.prefetch();
+      }
+      v->scrub_prefetch_us = elapsed_us(t0);
+      v->scrub_prefetch_simulated_us = ps.throttle.elapsed_us - simulated;
+      auto bytes = prefetch.hit_bytes + prefetch.miss_bytes;
+      v->scrub_prefetch_hit_ratio = bytes ? double(prefetch.hit_bytes) / bytes : 0;
+    }
+  }
+  v->peak_rss_bytes = peak_rss();
+  v->instruments = demux_instruments().snapshot();
+  return 0;
+}
+
+int32_t flv::run_benchmarks(char const*dir, bench_options const&o, std::string*json){
+  std::vector<bench_metrics> results;
+  for (auto&c : bench_corpus(o.long_corpus)){
+    auto path = std::string(dir) + "/" + c.name + ".flv";
+    synth_result r;
+    if (synthesize(path.c_str(), c.synth, &r) != 0)
+      return -1;
+    bench_metrics m;
+    if (bench_file(c.name.c_str(), path.c_str(), o, &m) != 0)
+      return -1;
+    results.push_back(m);
+  }
+  *json = bench_json(results);
+  return 0;
+}
+
+std::string flv::bench_json(std::vector<bench_metrics> const&v){
+  std::string s = "{\n  \"results\": [\n";
+  for (size_t i = 0; i < v.size(); ++i){
+    auto&m = v[i];
+    s += "    {\n      \"name\": \"" + m.name + "\",\n";
+    json_number(s, "bytes", double(m.bytes));
+    json_number(s, "tags", m.tags);
+    json_number(s, "open_us", m.open_us);
+    json_number(s, "open_simulated_us", double(m.open_simulated_us));
+    json_number(s, "demux_tags_per_second", m.demux_tags_per_second);
+    json_number(s, "demux_gb_per_second", m.demux_gb_per_second);
+    json_number(s, "demux_simulated_us", double(m.demux_simulated_us));
+    json_number(s, "cached_demux_tags_per_second", m.cached_demux_tags_per_second);
+    json_number(s, "cached_demux_simulated_us", double(m.cached_demux_simulated_us));
+    json_number(s, "cache_source_reads", m.cache_source_reads);
+    json_number(s, "cache_amplification", m.cache_amplification);
+    json_number(s, "push_tags_per_second", m.push_tags_per_second);
+    json_number(s, "push_gb_per_second", m.push_gb_per_second);
+    json_number(s, "uring_push_gb_per_second", m.uring_push_gb_per_second);
+    json_number(s, "uring_enters", double(m.uring_enters));
+    json_number(s, "ts_mb_per_second", m.ts_mb_per_second);
+    json_number(s, "seek_p50_us", m.seek_p50_us);
+    json_number(s, "seek_p90_us", m.seek_p90_us);
+    json_number(s, "seek_p99_us", m.seek_p99_us);
+    json_number(s, "seek_max_us", m.seek_max_us);
+    json_number(s, "seek_simulated_us", double(m.seek_simulated_us));
+    json_number(s, "scrub_us", m.scrub_us);
+    json_number(s, "scrub_simulated_us", double(m.scrub_simulated_us));
+    json_number(s, "scrub_prefetch_us", m.scrub_prefetch_us);
+    json_number(s, "scrub_prefetch_simulated_us", double(m.scrub_prefetch_simulated_us));
+    json_number(s, "scrub_prefetch_hit_ratio", m.scrub_prefetch_hit_ratio);
+    json_number(s, "peak_rss_bytes", double(m.peak_rss_bytes));
+    json_number(s, "instrumented", m.instruments.enabled ? 1 : 0);
+    if (m.instruments.enabled){
+      for (uint32_t k = 0; k < stage_count; ++k){
+        auto&t = m.instruments.stages[k];
+        auto name = std::string(stage_name(static_cast<stage>(k)));
+        json_number(s, (name + "_count").c_str(), double(t.count));
+        json_number(s, (name + "_p50_us").c_str(), t.p50_ns / 1e3);
+        json_number(s, (name + "_p99_us").c_str(), t.p99_ns / 1e3);
+      }
+      for (uint32_t k = 0; k < counter_count; ++k)
+        json_number(s, counter_name(static_cast<counter>(k)), double(m.instruments.counters[k]));
+    }
+    json_number(s, "allocations_per_tag", m.allocations_per_tag, true);
+    s += i + 1 < v.size() ? "    },\n" : "    }\n";
+  }
+  s += "  ]\n}\n";
+  return s;
+}
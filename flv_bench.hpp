@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "flv_synth.hpp"
+#include "flv_sim_source.hpp"
+#include "flv_instrument.hpp"
+
+namespace flv{
+// allocations seen by operator new, counted only when flv_bench.cpp is compiled with FLV_BENCH_COUNT_ALLOCATIONS
+extern std::atomic<uint64_t> bench_allocations;
+
+struct bench_options{
+  uint32_t                 repeats = 5;          // runs of open and full demux, the median is reported
+  uint32_t                 seeks   = 200;
+  uint32_t                 uring_streams = 16;   // push demuxes of a file at once through io_uring, 0: skipped
+  uint32_t                 scrub_seeks = 100;    // seeks stepping through the file and back, see scrub_*
+  uint32_t                 chunk   = 64 * 1024;  // bytes fed to the push parser at once
+  uint64_t                 seed    = 1;          // seek targets
+  bool                     long_corpus = false;  // adds a 10 hour file to the generated corpus
+  bool                     in_memory   = false;  // files are read into memory first, reads then go to a memory_source
+  // reads go through a copy of it when set, sleep off, its delays are reported as simulated times
+  throttled_source const  *throttle = nullptr;
+};
+
+struct bench_case{
+  std::string   name;
+  synth_options synth;
+};
+
+struct bench_metrics{
+  std::string name;
+  uint64_t    bytes                = 0;
+  uint32_t    tags                 = 0;
+  double      open_us              = 0;   // reader::open, median
+  uint64_t    open_simulated_us    = 0;   // throttled reads of one open
+  double      demux_tags_per_second = 0;  // reader, tag headers and data, median
+  double      demux_gb_per_second  = 0;
+  uint64_t    demux_simulated_us   = 0;
+  double      cached_demux_tags_per_second = 0;  // the same through block_cache_source
+  uint64_t    cached_demux_simulated_us    = 0;
+  uint32_t    cache_source_reads           = 0;
+  double      cache_amplification          = 0;  // bytes read from the file per byte the reader asked for
+  double      push_tags_per_second = 0;   // push_parser fed in chunks, median
+  double      push_gb_per_second   = 0;
+  double      uring_push_gb_per_second = 0;  // all streams together, 0 without io_uring
+  uint64_t    uring_enters         = 0;
+  double      ts_mb_per_second     = 0;   // ts_remuxer into a sink that drops the packets, flv bytes in, median
+  double      seek_p50_us          = 0;   // keyframe lookup and reading its tag
+  double      seek_p90_us          = 0;
+  double      seek_p99_us          = 0;
+  double      seek_max_us          = 0;
+  uint64_t    seek_simulated_us    = 0;   // all seeks
+  double      scrub_us             = 0;   // scrub seeks and the first frames after each, reader on the file
+  uint64_t    scrub_simulated_us   = 0;
+  double      scrub_prefetch_us    = 0;   // the same through gop_prefetch_source
+  uint64_t    scrub_prefetch_simulated_us = 0;
+  double      scrub_prefetch_hit_ratio    = 0;  // bytes served from prefetched gops
+  uint64_t    peak_rss_bytes       = 0;   // of the process so far
+  double      allocations_per_tag  = -1;  // full demux, -1 if not counted
+  instrument_snapshot instruments;        // the whole run of this file, when built with FLV_INSTRUMENT
+};
+
+std::vector<bench_case> bench_corpus(bool long_corpus);
+// 0: ok, -1: the file can not be read
+int32_t     bench_file(char const*name, char const*path, bench_options const&o, bench_metrics*v);
+// generates the corpus into dir, benches every file and writes the results as json
+int32_t     run_benchmarks(char const*dir, bench_options const&o, std::string*json);
+std::string bench_json(std::vector<bench_metrics> const&v);
+}
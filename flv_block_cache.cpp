@@ -0,0 +1,116 @@
+#include "flv_block_cache.hpp"
+#include <algorithm>
+#include <cstring>
+
+flv::block_cache_source::block_cache_source(byte_source*src, uint32_t block_size, uint64_t budget)
+  : source(src), block_size(std::max<uint32_t>(block_size, 1)), budget(budget){
+}
+
+void flv::block_cache_source::clear(){
+  blocks.clear();
+  map.clear();
+  cached = 0;
+  last_end = UINT64_MAX;
+  read_ahead = 0;
+}
+
+flv::block_cache_source::block* flv::block_cache_source::find(uint64_t index){
+  auto i = map.find(index);
+  if (i == map.end())
+    return nullptr;
+  blocks.splice(blocks.begin(), blocks, i->second);
+  return &blocks.front();
+}
+
+void flv::block_cache_source::insert(uint64_t index, uint8_t const*data, uint32_t length){
+  if (map.count(index) || length > budget)
+    return;
+  while (!blocks.empty() && cached + length > budget){
+    auto&b = blocks.back();
+    cached -= b.length;
+    map.erase(b.index);
+    if (cached + length <= budget){  // the evicted block's storage is reused
+      b.index = index;
+      b.length = length;
+      memcpy(b.data.data(), data, length);
+      blocks.splice(blocks.begin(), blocks, std::prev(blocks.end()));
+      map[index] = blocks.begin();
+      cached += length;
+      return;
+    }
+    blocks.pop_back();
+  }
+  blocks.emplace_front();
+  auto&b = blocks.front();
+  b.index = index;
+  b.length = length;
+  b.data.resize(block_size);
+  memcpy(b.data.data(), data, length);
+  map[index] = blocks.begin();
+  cached += length;
+}
+
+// reads count blocks from first into scratch with one source read
+int32_t flv::block_cache_source::fetch(uint64_t first, uint64_t count){
+  auto length = static_cast<uint32_t>(count * block_size);
+  scratch.resize(length);
+  auto cb = source->read(first * block_size, scratch.data(), length);
+  if (cb < 0)
+    return -1;
+  ++source_reads;
+  source_bytes += static_cast<uint64_t>(cb);
+  scratch.resize(static_cast<size_t>(cb));
+  return 0;
+}
+
+int64_t flv::block_cache_source::read(uint64_t pos, void*data, uint32_t length){
+  requested_bytes += length;
+  // forward, overlapping the last read or starting less than a block past it
+  if (last_end != UINT64_MAX && pos >= last_begin && pos <= last_end + block_size)
+    read_ahead = std::min(max_read_ahead, read_ahead ? read_ahead * 2 : 1);
+  else
+    read_ahead = 0;
+  last_begin = pos;
+  last_end = pos + length;
+  if (!length)
+    return 0;
+
+  auto p = static_cast<uint8_t*>(data);
+  auto last = (pos + length - 1) / block_size;  // last block of the read
+  uint32_t done = 0;
+  while (done < length){
+    auto at = pos + done;
+    auto index = at / block_size;
+    auto offset = static_cast<uint32_t>(at - index * block_size);
+    if (auto b = find(index)){
+      ++hits;
+      if (offset >= b->length)
+        break;  // end of file
+      auto n = std::min(length - done, b->length - offset);
+      memcpy(p + done, b->data.data() + offset, n);
+      done += n;
+      if (b->length < block_size)
+        break;
+      continue;
+    }
+
+    // the run of missing blocks up to the end of the read, and read-ahead past it
+    uint64_t count = 1;
+    while (index + count <= last + read_ahead && count < UINT32_MAX / block_size && !map.count(index + count))
+      ++count;
+    misses += std::min(count, last - index + 1);
+    if (fetch(index, count) != 0)
+      return -1;
+    auto fetched = static_cast<uint32_t>(scratch.size());
+    if (offset >= fetched)
+      break;
+    auto n = std::min(length - done, fetched - offset);
+    memcpy(p + done, scratch.data() + offset, n);
+    done += n;
+    for (uint32_t o = 0; o < fetched; o += block_size)
+      insert(index + o / block_size, scratch.data() + o, std::min(block_size, fetched - o));
+    if (fetched < count * block_size)
+      break;  // end of file
+  }
+  return done;
+}
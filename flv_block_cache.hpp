@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "byte_source.hpp"
+
+namespace flv{
+// byte source caching another one in fixed size blocks, least recently used blocks go first.
+// reads moving forward from the last one by less than a block double the read-ahead
+// up to max_read_ahead blocks, any other read turns it off. missing blocks of a read and its
+// read-ahead are fetched with one source read, so the parser above can read a few bytes at a time
+struct block_cache_source : public byte_source{
+  explicit block_cache_source(byte_source*src, uint32_t block_size = 64 * 1024, uint64_t budget = 4 * 1024 * 1024);
+  block_cache_source(block_cache_source const&) = delete;
+
+  int64_t read(uint64_t pos, void*data, uint32_t length) override;
+  int32_t size(uint64_t*v) override{ return source->size(v); }
+  void    clear();                       // drops every block, counters are kept
+  double  amplification()const{ return requested_bytes ? double(source_bytes) / requested_bytes : 0; }
+
+  byte_source *source;
+  uint32_t     block_size;
+  uint64_t     budget;                   // bytes of cached blocks
+  uint32_t     max_read_ahead = 16;      // blocks
+  uint32_t     read_ahead     = 0;       // current, in blocks
+
+  uint64_t     hits            = 0;      // blocks found in the cache
+  uint64_t     misses          = 0;      // blocks fetched because a read needed them
+  uint64_t     requested_bytes = 0;      // asked for by reads
+  uint64_t     source_bytes    = 0;      // read from the source
+  uint32_t     source_reads    = 0;
+
+private:
+  struct block{
+    uint64_t             index  = 0;
+    uint32_t             length = 0;     // less than block_size only at end of file
+    std::vector<uint8_t> data;
+  };
+  using lru = std::list<block>;
+
+  block*  find(uint64_t index);
+  int32_t fetch(uint64_t first, uint64_t count);
+  void    insert(uint64_t index, uint8_t const*data, uint32_t length);
+
+  lru                                        blocks;   // most recently used first
+  std::unordered_map<uint64_t, lru::iterator> map;
+  uint64_t                                   cached     = 0;           // bytes
+  uint64_t                                   last_begin = 0;           // of the previous read
+  uint64_t                                   last_end   = UINT64_MAX;
+  std::vector<uint8_t>                       scratch;                  // fetched run before it is split into blocks
+};
+}
@@ -0,0 +1,181 @@
+#include "flv_concat.hpp"
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include "amf.hpp"
+#include "flv_reader.hpp"
+#include "flv_writer.hpp"
+#include "block_copy.hpp"
+
+namespace{
+struct input{
+  explicit input(flv::file*f) : rd(f){}
+  flv::reader rd;
+  ::keyframes index;
+  uint32_t    first_timestamp = 0;  // milliseconds, of the first audio or video tag
+};
+
+// keyframes of onMetaData are used when every entry points at a key frame in file order, else tag headers are scanned
+int32_t load_index(input&v){
+  auto&rd = v.rd;
+  flv::raw_tag t;
+  if (rd.read_tag(rd.first_media_tag, &t) == 0)
+    v.first_timestamp = t.timestamp;
+  v.index = rd.meta.keyframes;
+  auto valid = v.index.positions.size() == v.index.times.size();
+  for (size_t i = 0; valid && i < v.index.positions.size(); ++i){
+    valid = rd.read_tag(v.index.positions[i], &t) == 0 && t.keyframe()
+      && uint64_t(t.timestamp) * 10000 == v.index.times[i] && (!i || v.index.positions[i] > v.index.positions[i - 1]);
+  }
+  uint32_t last_timestamp;
+  return (valid && !v.index.empty()) ? 0 : rd.build_index(&v.index, &last_timestamp);
+}
+}
+
+int32_t flv::concatenator::concat(std::vector<std::string> const&in, char const*out, concat_result*r){
+  std::vector<std::unique_ptr<flv::file>> files;
+  std::vector<flv::file*> sources;
+  for (auto&path : in){
+    files.emplace_back(new flv::file());
+    if (files.back()->open(path.c_str()) != 0)
+      return -1;
+    sources.push_back(files.back().get());
+  }
+  flv::file o;
+  if (o.create(out) != 0)
+    return -1;
+  return concat(sources, o, r);
+}
+
+int32_t flv::concatenator::concat(std::vector<file*> const&in, file&out, concat_result*r){
+  if (in.empty())
+    return -1;
+  std::vector<input> inputs;
+  inputs.reserve(in.size());
+  size_t keyframe_count = 0;
+  uint8_t has_audio = 0, has_video = 0;
+  for (auto f : in){
+    inputs.emplace_back(f);
+    if (inputs.back().rd.open() != 0 || load_index(inputs.back()) != 0)
+      return -1;
+    keyframe_count += inputs.back().index.positions.size();
+    has_audio |= inputs.back().rd.header.has_audio || inputs.back().rd.aac_tag.type != flv::tag_type::eof;
+    has_video |= inputs.back().rd.header.has_video || inputs.back().rd.avc_tag.type != flv::tag_type::eof;
+  }
+
+  // onMetaData of the first input, sized for every keyframe and written again at the end
+  flv_meta meta = inputs.front().rd.meta;
+  meta.has_audio = has_audio;
+  meta.has_video = has_video;
+  meta.can_seek_to_end = 0;
+  meta.keyframes.positions.assign(keyframe_count, 0);
+  meta.keyframes.times.assign(keyframe_count, 0);
+  ::packet original;
+  auto&first = inputs.front().rd;
+  if (first.script_tag.type == flv::tag_type::script_data && first.read_data(first.script_tag, &original) != 0)
+    return -1;
+  auto writer = flv::amf_writer();
+  if (flv::on_meta_data_encoder().patch(writer, original._, original.length, meta) != 0)
+    return -1;
+  auto meta_length = static_cast<uint32_t>(writer.data.size());
+  meta.keyframes = ::keyframes();
+
+  uint64_t out_pos = 0, meta_pos = 0;
+  {
+    flv::muxer mux(&out);
+    mux.header(has_audio != 0, has_video != 0);
+    meta_pos = mux.position();
+    mux.tag(flv::tag_type::script_data, 0, writer.data.data(), meta_length);
+    if (mux.flush() != 0)
+      return -1;
+    out_pos = mux.position();
+  }
+  auto data_start = out_pos;
+
+  packet avc, aac;  // sequence headers in effect
+  uint32_t tags = 0, dropped = 0, duration = 0, offset = 0;
+  for (size_t k = 0; k < inputs.size(); ++k){
+    auto&rd = inputs[k].rd;
+    auto&index = inputs[k].index;
+    auto t0 = inputs[k].first_timestamp;
+    auto rebase = [&](uint32_t ms){ return ms > t0 ? ms - t0 + offset : offset; };
+    flv::block_copy w(*in[k], out, rd.first_media_tag, out_pos);
+    if (w.fill(rd.first_media_tag) != 0)
+      return -1;
+    size_t next_keyframe = 0;
+    uint32_t frame_interval = 0, last_video = UINT32_MAX;
+    auto pos = rd.first_media_tag;
+    for (;;){
+      if (!w.holds(pos, raw_tag_peek_length)){  // codec bytes too, they tell sequence headers
+        if (w.flush(pos) != 0 || w.fill(pos) != 0)
+          return -1;
+        if (w.block_len < flv_tag_header_length)
+          break;
+      }
+      raw_tag t;
+      decode_raw_tag(w.at(pos), w.available(pos), pos, &t);
+      if (t.data_offset() + t.data_size > rd.file_size)
+        break;  // incomplete tag at the end of a recording
+      auto next = std::min(t.next(), rd.file_size);
+      if (t.sequence_header()){
+        // compared in the block, sequence headers are far smaller than it
+        if (!w.holds(t.data_offset(), t.data_size)){
+          if (w.flush(pos) != 0 || w.fill(pos) != 0 || !w.holds(t.data_offset(), t.data_size))
+            return -1;
+        }
+        auto&current = t.is_avc() ? avc : aac;
+        auto data = w.at(t.data_offset());
+        if (current.length == t.data_size && memcmp(current._, data, t.data_size) == 0){
+          if (w.flush(pos) != 0)
+            return -1;
+          w.skip(next);
+          ++dropped;
+          pos = next;
+          continue;
+        }
+        current = packet(data, t.data_size);
+      }
+      for (; next_keyframe < index.positions.size() && index.positions[next_keyframe] <= pos; ++next_keyframe){
+        meta.keyframes.positions.push_back(w.output_position(pos));
+        meta.keyframes.times.push_back(uint64_t(rebase(static_cast<uint32_t>(index.times[next_keyframe] / 10000))) * 10000);
+      }
+      auto ts = rebase(t.timestamp);
+      patch_timestamp(w.at(pos), ts);
+      if (t.type == flv::tag_type::video && !t.sequence_header()){
+        if (last_video != UINT32_MAX && t.timestamp > last_video)
+          frame_interval = t.timestamp - last_video;
+        last_video = t.timestamp;
+      }
+      if (t.type == flv::tag_type::audio || t.type == flv::tag_type::video)
+        duration = std::max(duration, ts);
+      ++tags;
+      pos = next;
+    }
+    if (w.flush(pos) != 0)
+      return -1;
+    out_pos = w.out_pos;
+    // next input starts one frame after the last one of this input
+    offset = duration + std::max<uint32_t>(frame_interval, 1);
+  }
+
+  // onMetaData in front of the tags is sized for keyframe_count entries. a keyframe the walk
+  // never reached leaves its slot to a copy of the last one, an amf number has a fixed size
+  while (meta.keyframes.positions.size() < keyframe_count){
+    meta.keyframes.positions.push_back(meta.keyframes.positions.empty() ? data_start : meta.keyframes.positions.back());
+    meta.keyframes.times.push_back(meta.keyframes.times.empty() ? 0 : meta.keyframes.times.back());
+  }
+  meta.last_timestamp = duration;
+  meta.last_keyframe_timestamp = meta.keyframes.empty() ? 0 : static_cast<uint32_t>(meta.keyframes.times.back() / 10000);
+  meta.filesize = out_pos;
+  writer.data.clear();
+  flv::on_meta_data_encoder().patch(writer, original._, original.length, meta);
+  if (writer.data.size() != meta_length || out.write(meta_pos + flv_tag_header_length, writer.data.data(), meta_length) != meta_length)
+    return -1;
+  if (r){
+    r->duration = duration;
+    r->tags = tags;
+    r->sequence_headers = dropped;
+    r->file_size = out_pos;
+  }
+  return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "file_io.hpp"
+
+namespace flv{
+struct concat_result{
+  uint32_t duration         = 0;  // milliseconds, last timestamp of the output
+  uint32_t tags             = 0;  // tags copied
+  uint32_t sequence_headers = 0;  // repeated sequence headers dropped
+  uint64_t file_size        = 0;  // bytes written
+};
+
+// joins flv files into one, tags are copied as they are.
+// each input is rebased onto the end of the previous one, a sequence header equal to
+// the one in effect is dropped, a changed one is kept. onMetaData of the first input
+// is written with the merged keyframes index
+struct concatenator{
+  int32_t concat(std::vector<file*> const&in, file&out, concat_result*r);  // 0: ok, -1: error
+  int32_t concat(std::vector<std::string> const&in, char const*out, concat_result*r);
+};
+}
@@ -0,0 +1,128 @@
+#include "flv_concat.hpp"
+#include <string>
+#include <vector>
+#include "flv_reader.hpp"
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+// a keyframe every second
+std::string segment(char const*name, uint32_t duration_ms, uint32_t width, uint32_t height){
+  auto path = flv::test::temp_path(name);
+  flv::synth_options o;
+  o.duration_ms = duration_ms;
+  o.width = width;
+  o.height = height;
+  o.gop_frames = 25;
+  flv::synth_result r;
+  if (flv::synthesize(path.c_str(), o, &r) != 0)
+    flv::test::fail(__FILE__, __LINE__, "segment");
+  return path;
+}
+
+// timestamp of the last audio or video tag
+uint32_t last_timestamp(std::string const&path){
+  flv::file f;
+  if (f.open(path.c_str()) != 0)
+    return 0;
+  auto rd = flv::reader(&f);
+  return rd.open() == 0 ? rd.last_timestamp : 0;
+}
+
+// every onMetaData keyframes entry is a keyframe tag with that time
+bool index_points_at_keyframes(flv::reader&rd){
+  auto&k = rd.meta.keyframes;
+  if (k.positions.size() != k.times.size())
+    return false;
+  for (size_t i = 0; i < k.positions.size(); ++i){
+    flv::raw_tag t;
+    if (rd.read_tag(k.positions[i], &t) != 0 || !t.keyframe() || uint64_t(t.timestamp) * 10000 != k.times[i])
+      return false;
+  }
+  return true;
+}
+}
+
+FLV_TEST(concat_rebases_segments_and_drops_repeated_sequence_headers){
+  std::vector<std::string> in;
+  in.push_back(segment("concat_a.flv", 3000, 320, 240));
+  in.push_back(segment("concat_b.flv", 2000, 320, 240));
+  in.push_back(segment("concat_c.flv", 4000, 640, 360));  // new avc sequence header, same aac one
+  auto path = flv::test::temp_path("concat.flv");
+  flv::concat_result r;
+  FLV_CHECK(flv::concatenator().concat(in, path.c_str(), &r) == 0);
+  FLV_CHECK(r.sequence_headers == 3);
+
+  flv::file f;
+  FLV_CHECK(f.open(path.c_str()) == 0);
+  auto rd = flv::reader(&f);
+  FLV_CHECK(rd.open() == 0);
+  FLV_CHECK(rd.file_size == r.file_size && rd.has_meta);
+  FLV_CHECK(rd.meta.keyframes.positions.size() == 3 + 2 + 4);
+  FLV_CHECK(index_points_at_keyframes(rd));
+
+  // each segment starts one frame interval after the last tag before it
+  std::vector<uint32_t> keyframe_times;
+  uint32_t tags = 0, avc_headers = 0, aac_headers = 0, last = 0;
+  bool ordered = true;
+  flv::raw_tag t;
+  for (auto pos = rd.first_media_tag; rd.read_tag(pos, &t) == 0; pos = t.next()){
+    ++tags;
+    if (t.sequence_header()){
+      ++(t.is_avc() ? avc_headers : aac_headers);
+      continue;
+    }
+    ordered = ordered && t.timestamp + 50 >= last;  // audio runs a little ahead of video
+    last = std::max(last, t.timestamp);
+    if (t.keyframe())
+      keyframe_times.push_back(t.timestamp);
+  }
+  FLV_CHECK(ordered && tags == r.tags && last == r.duration && rd.meta.last_timestamp == r.duration);
+  FLV_CHECK(avc_headers == 2 && aac_headers == 1);
+  FLV_CHECK(keyframe_times.size() == 9);
+  auto b = last_timestamp(in[0]) + 40;
+  auto c = b + last_timestamp(in[1]) + 40;
+  FLV_CHECK(b > 2900 && c > b + 1900);
+  uint32_t const expected[] = { 0, 1000, 2000, b, b + 1000, c, c + 1000, c + 2000, c + 3000 };
+  for (size_t i = 0; i < keyframe_times.size() && i < 9; ++i)
+    FLV_CHECK(keyframe_times[i] == expected[i]);
+  f.close();
+  flv::test::remove_file(path);
+  for (auto&v : in)
+    flv::test::remove_file(v);
+}
+
+// a damaged tag stops the copy of its input early, the keyframes of onMetaData after it
+// are never reached. onMetaData keeps its size and still points at keyframe tags
+FLV_TEST(concat_input_damaged_in_the_middle){
+  std::vector<std::string> in;
+  in.push_back(segment("concat_d.flv", 2000, 320, 240));
+  in.push_back(segment("concat_e.flv", 4000, 320, 240));
+  {
+    flv::file f;
+    FLV_CHECK(f.open_rw(in[1].c_str()) == 0);
+    auto rd = flv::reader(&f);
+    FLV_CHECK(rd.open() == 0 && rd.meta.keyframes.positions.size() == 4);
+    // the tag after the second keyframe claims more data than the file holds
+    flv::raw_tag t;
+    FLV_CHECK(rd.read_tag(rd.meta.keyframes.positions[1], &t) == 0);
+    uint8_t size[3] = { 0xff, 0xff, 0xff };
+    FLV_CHECK(f.write(t.next() + 1, size, sizeof(size)) == sizeof(size));
+  }
+  auto path = flv::test::temp_path("concat_damaged.flv");
+  flv::concat_result r;
+  FLV_CHECK(flv::concatenator().concat(in, path.c_str(), &r) == 0);
+
+  flv::file f;
+  FLV_CHECK(f.open(path.c_str()) == 0);
+  auto rd = flv::reader(&f);
+  FLV_CHECK(rd.open() == 0);
+  FLV_CHECK(rd.meta.keyframes.positions.size() == 2 + 4);
+  FLV_CHECK(index_points_at_keyframes(rd));
+  auto second = last_timestamp(in[0]) + 40 + 1000;  // the second keyframe of the damaged input
+  FLV_CHECK(rd.meta.keyframes.times.back() == second * 10000ull && r.duration < second + 1000);
+  f.close();
+  flv::test::remove_file(path);
+  for (auto&v : in)
+    flv::test::remove_file(v);
+}
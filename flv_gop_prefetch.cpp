@@ -0,0 +1,56 @@
+#include "flv_gop_prefetch.hpp"
+#include <algorithm>
+#include <cstring>
+
+int32_t flv::gop_prefetch_source::open(){
+  gops.cache_gops = ahead + 2;
+  return gops.open();
+}
+
+int32_t flv::gop_prefetch_source::seek(uint32_t ms, uint64_t*position){
+  auto i = gops.find(ms);
+  if (i != target)
+    direction = i > target ? 1 : -1;
+  target = i;
+  gop const*g = nullptr;
+  if (gops.at(i, &g) != 0)
+    return -1;
+  *position = g->begin;
+  return 0;
+}
+
+int32_t flv::gop_prefetch_source::prefetch(){
+  gop const*g = nullptr;
+  for (uint32_t n = 1; n <= ahead; ++n){
+    if (direction < 0 && target < n)
+      break;
+    auto i = direction > 0 ? target + n : target - n;
+    if (i >= gops.gop_count())
+      break;
+    if (gops.at(i, &g) != 0)
+      return -1;
+  }
+  return gops.at(target, &g);  // the target stays most recently used
+}
+
+int64_t flv::gop_prefetch_source::read(uint64_t pos, void*data, uint32_t length){
+  auto p = static_cast<uint8_t*>(data);
+  uint32_t done = 0;
+  while (done < length){
+    auto at = pos + done;
+    auto g = std::find_if(gops.cache.begin(), gops.cache.end(), [at](gop const&v){ return v.begin <= at && at < v.end; });
+    if (g == gops.cache.end())
+      break;
+    auto n = static_cast<uint32_t>(std::min<uint64_t>(length - done, g->end - at));
+    memcpy(p + done, g->arena.data() + (at - g->begin), n);
+    done += n;
+    hit_bytes += n;
+  }
+  if (done == length)
+    return done;
+  auto cb = source->read(pos + done, p + done, length - done);
+  if (cb < 0)
+    return -1;
+  miss_bytes += static_cast<uint64_t>(cb);
+  return done + cb;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include "byte_source.hpp"
+#include "flv_reverse.hpp"
+
+namespace flv{
+// byte source in front of another one for seeking demuxers.
+// a seek reads the whole gop of the target with one read, prefetch reads the gops next to it
+// in the direction the target moved. reads inside cached gops are served from memory,
+// others go to the source as they are
+struct gop_prefetch_source : public byte_source{
+  explicit gop_prefetch_source(byte_source*src) : source(src), gops(src){}
+  gop_prefetch_source(gop_prefetch_source const&) = delete;
+
+  uint32_t ahead = 1;  // gops prefetched in the scrub direction, the cache holds them, the target and the one behind
+
+  int32_t open();                                 // 0: ok, -1: not flv or no keyframes
+  int32_t seek(uint32_t ms, uint64_t*position);   // position: keyframe tag the demuxer restarts at. 0: ok, -1: error
+  int32_t prefetch();                             // 0: ok, -1: error. call when the first frames are out
+
+  int64_t read(uint64_t pos, void*data, uint32_t length) override;
+  int32_t size(uint64_t*v) override{ return source->size(v); }
+
+  byte_source  *source;
+  gop_iterator  gops;
+  size_t        target    = 0;   // gop of the last seek
+  int32_t       direction = 1;   // of the last seek relative to the one before, 1 or -1
+  uint64_t      hit_bytes  = 0;  // served from cached gops
+  uint64_t      miss_bytes = 0;  // passed to the source
+};
+}
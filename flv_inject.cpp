@@ -0,0 +1,116 @@
+#include "flv_inject.hpp"
+#include <algorithm>
+#include <vector>
+#include "amf.hpp"
+#include "flv_reader.hpp"
+#include "flv_writer.hpp"
+
+const static uint32_t move_block_size   = 1 << 20;
+const static char     padding_name[]    = "padding";
+// property name, long string type and length
+const static uint32_t padding_overhead  = sizeof(uint16_t) + sizeof(padding_name) - 1 + 1 + sizeof(uint32_t);
+// "onMetaData" string value then the ecma array type
+const static uint32_t ecma_count_offset = 1 + sizeof(uint16_t) + 10 + 1;
+
+namespace{
+// grows encoded onMetaData to length with a padding property at the end of the ecma array
+int32_t pad(std::vector<uint8_t>&data, uint32_t length){
+  if (data.size() == length)
+    return 0;
+  if (data.size() + padding_overhead > length)
+    return -1;
+  auto fill = static_cast<uint32_t>(length - data.size() - padding_overhead);
+  auto writer = flv::amf_writer();
+  writer.data.swap(data);
+  writer.data.resize(writer.data.size() - 3);  // object end marker
+  writer.property(padding_name);
+  writer.ui8((uint8_t)flv::script_data_value_type::long_string);
+  writer.ui32(fill);
+  writer.data.resize(writer.data.size() + fill, ' ');
+  writer.end_object();
+  writer.patch_ui32(ecma_count_offset, bigendian::touint32(writer.data.data() + ecma_count_offset) + 1);
+  writer.data.swap(data);
+  return 0;
+}
+
+// moves [from, from + length) forward by delta, last block first so nothing is overwritten before it is read
+int32_t move_forward(flv::file&f, uint64_t from, uint64_t length, uint64_t delta){
+  std::vector<uint8_t> block(static_cast<size_t>(std::min<uint64_t>(length, move_block_size)));
+  for (uint64_t done = 0; done < length;){
+    auto n = static_cast<uint32_t>(std::min<uint64_t>(length - done, block.size()));
+    auto pos = from + length - done - n;
+    if (f.read(pos, block.data(), n) != n || f.write(pos + delta, block.data(), n) != n)
+      return -1;
+    done += n;
+  }
+  return 0;
+}
+}
+
+int32_t flv::injector::inject(char const*path, inject_result*r){
+  flv::file f;
+  if (f.open_rw(path) != 0)
+    return -1;
+  return inject(f, r);
+}
+
+int32_t flv::injector::inject(file&f, inject_result*r){
+  auto rd = flv::reader(&f);
+  if (rd.open() != 0)
+    return -1;
+  ::keyframes index;
+  uint32_t last_timestamp = 0;
+  raw_tag last_video;
+  if (rd.build_index(&index, &last_timestamp, &last_video) != 0)
+    return -1;
+
+  flv_meta meta = rd.meta;
+  meta.has_video = (rd.header.has_video || rd.avc_tag.type != flv::tag_type::eof) ? 1 : 0;
+  meta.has_audio = (rd.header.has_audio || rd.aac_tag.type != flv::tag_type::eof) ? 1 : 0;
+  meta.has_metadata = 1;
+  meta.last_timestamp = last_timestamp;
+  meta.duration = last_timestamp / 1000;
+  meta.last_keyframe_timestamp = index.empty() ? 0 : static_cast<uint32_t>(index.times.back() / 10000);
+  meta.can_seek_to_end = last_video.keyframe() ? 1 : 0;
+  meta.keyframes = index;
+
+  // onMetaData replaced is the first tag, anything else is kept and a new one is put in front
+  auto has_script = rd.script_tag.type == flv::tag_type::script_data && rd.script_tag.position == rd.first_tag;
+  auto old_data_size = has_script ? rd.script_tag.data_size : 0;
+  auto old_size = has_script ? rd.script_tag.next() - rd.first_tag : 0;
+  ::packet original;
+  if (rd.script_tag.type == flv::tag_type::script_data && rd.read_data(rd.script_tag, &original) != 0)
+    return -1;
+  auto writer = flv::amf_writer();
+  if (flv::on_meta_data_encoder().patch(writer, original._, original.length, meta) != 0)
+    return -1;
+  auto length = static_cast<uint32_t>(writer.data.size());
+  auto data_size = old_data_size;
+  int64_t delta = 0;
+  if (!has_script || (length != old_data_size && length + padding_overhead > old_data_size)){
+    data_size = length + padding_overhead + reserve;
+    delta = static_cast<int64_t>(flv_tag_header_length + data_size + flv_previous_tag_size_field_length) - static_cast<int64_t>(old_size);
+  }
+
+  // numbers are fixed size, filepositions and filesize do not change the encoded length
+  for (auto&pos : meta.keyframes.positions)
+    pos += delta;
+  meta.filesize = rd.file_size + delta;
+  writer.data.clear();
+  flv::on_meta_data_encoder().patch(writer, original._, original.length, meta);
+  if (writer.data.size() != length || pad(writer.data, data_size) != 0)
+    return -1;
+
+  auto body = rd.first_tag + old_size;
+  if (delta > 0 && move_forward(f, body, rd.file_size - body, static_cast<uint64_t>(delta)) != 0)
+    return -1;
+  flv::muxer mux(&f, rd.first_tag);
+  mux.tag(flv::tag_type::script_data, 0, writer.data.data(), data_size);
+  if (mux.flush() != 0)
+    return -1;
+  if (r){
+    r->keyframes = static_cast<uint32_t>(index.positions.size());
+    r->shift = delta;
+  }
+  return 0;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include "file_io.hpp"
+
+namespace flv{
+struct inject_result{
+  uint32_t keyframes = 0;  // entries written to keyframes
+  int64_t  shift     = 0;  // bytes the tags after onMetaData moved, 0 if the head was rewritten in place
+};
+
+// writes onMetaData with a keyframes index into an existing file.
+// tag headers are scanned for keyframes, payloads are not read.
+// the head is rewritten in place when the new onMetaData fits the old script tag,
+// the difference is filled with a padding property. otherwise the tags after it are
+// moved and filepositions account for the move, padding is reserved for later rewrites
+struct injector{
+  uint32_t reserve = 1024;  // padding bytes added when tags have to be moved
+
+  int32_t inject(file&f, inject_result*r);           // file opened read write, 0: ok, -1: error
+  int32_t inject(char const*path, inject_result*r);
+};
+}
@@ -0,0 +1,126 @@
+#include "flv_inject.hpp"
+#include <map>
+#include <string>
+#include <vector>
+#include "amf.hpp"
+#include "flv_reader.hpp"
+#include "flv_synth.hpp"
+#include "flv_writer.hpp"
+#include "test.hpp"
+
+namespace{
+// synthetic file without an index, its onMetaData carries properties flv_meta does not model
+int32_t sample_file(std::string const&path, uint32_t*keyframes){
+  auto raw = flv::test::temp_path("inject_raw.flv");
+  flv::synth_options o;
+  o.duration_ms = 3000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  o.meta = false;
+  flv::synth_result r;
+  if (flv::synthesize(raw.c_str(), o, &r) != 0)
+    return -1;
+  *keyframes = r.keyframes;
+
+  flv::file in;
+  uint64_t size = 0;
+  std::vector<uint8_t> v;
+  if (in.open(raw.c_str()) == 0 && in.size(&size) == 0){
+    v.resize(static_cast<size_t>(size));
+    if (in.read(0, v.data(), static_cast<uint32_t>(size)) != int64_t(size))
+      v.clear();
+  }
+  in.close();
+  flv::test::remove_file(raw);
+  size_t body = flv::flv_file_header_length + flv::flv_previous_tag_size_field_length;
+  if (v.size() < body)
+    return -1;
+
+  auto writer = flv::amf_writer();
+  writer.string("onMetaData");
+  writer.begin_ecma_array(4);
+  writer.property("duration");
+  writer.number(1);
+  writer.property("encoder");
+  writer.string("flv inject test");
+  writer.property("creator");
+  writer.begin_object();
+  writer.property("version");
+  writer.number(7);
+  writer.end_object();
+  writer.property("width");
+  writer.number(320);
+  writer.end_object();
+
+  flv::file out;
+  if (out.create(path.c_str()) != 0)
+    return -1;
+  flv::muxer mux(&out);
+  mux.header(true, true);
+  mux.tag(flv::tag_type::script_data, 0, writer.data.data(), static_cast<uint32_t>(writer.data.size()));
+  if (mux.flush() != 0)
+    return -1;
+  auto n = static_cast<uint32_t>(v.size() - body);
+  return out.write(mux.position(), v.data() + body, n) == n ? 0 : -1;
+}
+
+// names of the onMetaData entries with their encoded values
+std::multimap<std::string, std::vector<uint8_t>> entries(char const*path){
+  std::multimap<std::string, std::vector<uint8_t>> v;
+  flv::file f;
+  if (f.open(path) != 0)
+    return v;
+  auto rd = flv::reader(&f);
+  ::packet data;
+  if (rd.open() != 0 || rd.script_tag.type != flv::tag_type::script_data || rd.read_data(rd.script_tag, &data) != 0)
+    return v;
+  auto reader = flv::amf_reader(data._, data.length);
+  reader.skip_script_data_value();  // "onMetaData"
+  reader.byte();
+  reader.ui32();
+  for (;;){
+    auto name = reader.script_data_string();
+    if (name.empty())
+      break;
+    auto begin = reader.pointer;
+    if (reader.skip_script_data_value() != 0 || reader.pointer > reader.length)
+      break;
+    v.insert(std::make_pair(name, std::vector<uint8_t>(data._ + begin, data._ + reader.pointer)));
+  }
+  return v;
+}
+}
+
+FLV_TEST(inject_keeps_unmodeled_meta_properties){
+  auto path = flv::test::temp_path("inject.flv");
+  uint32_t keyframes = 0;
+  FLV_CHECK(sample_file(path, &keyframes) == 0);
+  auto before = entries(path.c_str());
+  FLV_CHECK(before.count("encoder") == 1 && before.count("creator") == 1);
+
+  flv::inject_result r;
+  FLV_CHECK(flv::injector().inject(path.c_str(), &r) == 0);
+  FLV_CHECK(r.keyframes == keyframes);
+  FLV_CHECK(r.shift > 0);
+
+  auto after = entries(path.c_str());
+  FLV_CHECK(after.count("encoder") == 1 && after.find("encoder")->second == before.find("encoder")->second);
+  FLV_CHECK(after.count("creator") == 1 && after.find("creator")->second == before.find("creator")->second);
+  FLV_CHECK(after.count("width") == 1 && after.find("width")->second == before.find("width")->second);
+  FLV_CHECK(after.count("duration") == 1 && after.find("duration")->second != before.find("duration")->second);
+  FLV_CHECK(after.count("keyframes") == 1 && after.count("filesize") == 1 && after.count("padding") == 1);
+
+  // in place the second time, the padding is replaced and not repeated
+  FLV_CHECK(flv::injector().inject(path.c_str(), &r) == 0);
+  FLV_CHECK(r.shift == 0);
+  auto again = entries(path.c_str());
+  FLV_CHECK(again == after);
+
+  flv::file f;
+  FLV_CHECK(f.open(path.c_str()) == 0);
+  auto rd = flv::reader(&f);
+  FLV_CHECK(rd.open() == 0 && rd.meta.keyframes.positions.size() == keyframes);
+  f.close();
+  flv::test::remove_file(path);
+}
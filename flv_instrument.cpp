@@ -0,0 +1,154 @@
+#include "flv_instrument.hpp"
+#include <cstdio>
+#include "compat.hpp"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace{
+uint32_t most_significant_bit(uint64_t v){  // v > 0
+#if defined(_MSC_VER) && defined(_M_X64)
+  unsigned long i = 0;
+  _BitScanReverse64(&i, v);
+  return i;
+#elif defined(_MSC_VER)
+  unsigned long i = 0;
+  if (_BitScanReverse(&i, static_cast<unsigned long>(v >> 32)))
+    return i + 32;
+  _BitScanReverse(&i, static_cast<unsigned long>(v));
+  return i;
+#else
+  return 63 - static_cast<uint32_t>(__builtin_clzll(v));
+#endif
+}
+
+// values below 2 * sub_buckets have a bucket each, above that every power of two is split into sub_buckets
+uint32_t bucket_of(uint64_t ns){
+  if (ns < flv::histogram_sub_buckets * 2)
+    return static_cast<uint32_t>(ns);
+  auto shift = most_significant_bit(ns) - 4;
+  return flv::histogram_sub_buckets * shift + static_cast<uint32_t>(ns >> shift);
+}
+
+uint64_t bucket_floor(uint32_t i){
+  if (i < flv::histogram_sub_buckets * 2)
+    return i;
+  auto shift = i / flv::histogram_sub_buckets - 1;
+  return uint64_t(i % flv::histogram_sub_buckets + flv::histogram_sub_buckets) << shift;
+}
+}
+
+void flv::latency_histogram::record(uint64_t ns){
+  counts[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+  total_ns.fetch_add(ns, std::memory_order_relaxed);
+  auto m = max_ns.load(std::memory_order_relaxed);
+  while (ns > m && !max_ns.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+    ;
+}
+
+void flv::latency_histogram::clear(){
+  for (auto&c : counts)
+    c.store(0, std::memory_order_relaxed);
+  count.store(0, std::memory_order_relaxed);
+  total_ns.store(0, std::memory_order_relaxed);
+  max_ns.store(0, std::memory_order_relaxed);
+}
+
+uint64_t flv::latency_histogram::value_at(double quantile)const{
+  uint64_t n = 0;
+  for (auto&c : counts)
+    n += c.load(std::memory_order_relaxed);
+  if (n == 0)
+    return 0;
+  auto rank = static_cast<uint64_t>(quantile * (n - 1));
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < histogram_buckets; ++i){
+    seen += counts[i].load(std::memory_order_relaxed);
+    if (seen > rank)
+      return bucket_floor(i);
+  }
+  return bucket_floor(histogram_buckets - 1);
+}
+
+flv::instrument_snapshot::instrument_snapshot(){
+  for (auto&c : counters)
+    c = 0;
+}
+
+flv::instrument_snapshot flv::instruments::snapshot()const{
+  instrument_snapshot v;
+  for (uint32_t i = 0; i < stage_count; ++i){
+    auto&h = stages[i];
+    auto&s = v.stages[i];
+    s.count = h.count.load(std::memory_order_relaxed);
+    s.total_ns = h.total_ns.load(std::memory_order_relaxed);
+    s.max_ns = h.max_ns.load(std::memory_order_relaxed);
+    s.p50_ns = h.value_at(0.5);
+    s.p90_ns = h.value_at(0.9);
+    s.p99_ns = h.value_at(0.99);
+    s.p999_ns = h.value_at(0.999);
+  }
+  for (uint32_t i = 0; i < counter_count; ++i)
+    v.counters[i] = counters[i].load(std::memory_order_relaxed);
+  return v;
+}
+
+void flv::instruments::reset(){
+  for (auto&h : stages)
+    h.clear();
+  for (auto&c : counters)
+    c.store(0, std::memory_order_relaxed);
+}
+
+namespace{
+// namespace scope, v120 does not make the initialization of function statics thread safe
+flv::instruments demux;
+}
+
+flv::instruments&flv::demux_instruments(){
+  return demux;
+}
+
+char const*flv::stage_name(stage s){
+  switch (s){
+  case stage::read_wait:    return "read_wait";
+  case stage::header_parse: return "header_parse";
+  case stage::payload_read: return "payload_read";
+  case stage::annexb:       return "annexb";
+  case stage::queue_wait:   return "queue_wait";
+  default:                  return "unknown";
+  }
+}
+
+char const*flv::counter_name(counter c){
+  switch (c){
+  case counter::tags:          return "tags";
+  case counter::bytes:         return "bytes";
+  case counter::seeks:         return "seeks";
+  case counter::resyncs:       return "resyncs";
+  case counter::dropped_seeks: return "dropped_seeks";
+  default:                     return "unknown";
+  }
+}
+
+std::string flv::instrument_dump(instrument_snapshot const&v){
+  if (!v.enabled)
+    return "instrumentation not compiled in, define FLV_INSTRUMENT\n";
+  std::string s;
+  char line[256];
+  FLV_SNPRINTF(line, sizeof(line), "%-13s %10s %10s %10s %10s %10s %10s %10s\n", "stage", "count", "mean_us", "p50_us", "p90_us", "p99_us", "p99.9_us", "max_us");
+  s += line;
+  for (uint32_t i = 0; i < stage_count; ++i){
+    auto&t = v.stages[i];
+    FLV_SNPRINTF(line, sizeof(line), "%-13s %10llu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", stage_name(static_cast<stage>(i)),
+                 static_cast<unsigned long long>(t.count), t.mean_ns() / 1e3, t.p50_ns / 1e3, t.p90_ns / 1e3,
+                 t.p99_ns / 1e3, t.p999_ns / 1e3, t.max_ns / 1e3);
+    s += line;
+  }
+  for (uint32_t i = 0; i < counter_count; ++i){
+    FLV_SNPRINTF(line, sizeof(line), "%-13s %10llu\n", counter_name(static_cast<counter>(i)), static_cast<unsigned long long>(v.counters[i]));
+    s += line;
+  }
+  return s;
+}
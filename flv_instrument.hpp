@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace flv{
+// demux hot path instrumentation. it is compiled in when FLV_INSTRUMENT is defined, for the whole project:
+// the hooks below are inline and change with it. without it they are empty, nothing is timed or counted
+#ifdef FLV_INSTRUMENT
+const static bool instrumented = true;
+#else
+const static bool instrumented = false;
+#endif
+
+enum class stage : uint32_t{
+  read_wait,     // byte source or byte stream read of tag and codec headers
+  header_parse,  // decoding tag and codec headers
+  payload_read,  // reading tag data
+  annexb,        // length prefixed nalus to start code buffers
+  queue_wait,    // sample queued by the demuxer until the consumer pulls it
+  count,
+};
+
+enum class counter : uint32_t{
+  tags,
+  bytes,          // read by the demuxer
+  seeks,          // repositioning for a start or a seek
+  resyncs,        // repositioning without one, e.g. back to the last complete tag of a growing file
+  dropped_seeks,  // seek requests replaced by a later one before the demuxer took them
+  count,
+};
+
+const static uint32_t stage_count            = static_cast<uint32_t>(stage::count);
+const static uint32_t counter_count          = static_cast<uint32_t>(counter::count);
+const static uint32_t histogram_sub_buckets  = 16;                              // per power of two, values are within 1/16
+const static uint32_t histogram_buckets      = histogram_sub_buckets * 61;      // exact below 32, up to 2^64 ns
+
+// log linear buckets of nanoseconds, like hdr histograms.
+// recording is a relaxed atomic increment from any thread, a snapshot taken meanwhile may miss a few values
+struct latency_histogram{
+  latency_histogram(){ clear(); }
+  void     record(uint64_t ns);
+  void     clear();
+  uint64_t value_at(double quantile)const;  // lower bound of the bucket holding it, 0 if empty
+
+  std::atomic<uint64_t> counts[histogram_buckets];  // zeroed by clear, v120 has no array member initializers
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> total_ns;
+  std::atomic<uint64_t> max_ns;
+};
+
+struct stage_summary{
+  uint64_t count    = 0;
+  uint64_t total_ns = 0;
+  uint64_t max_ns   = 0;
+  uint64_t p50_ns   = 0;
+  uint64_t p90_ns   = 0;
+  uint64_t p99_ns   = 0;
+  uint64_t p999_ns  = 0;
+  uint64_t mean_ns()const{ return count ? total_ns / count : 0; }
+};
+
+struct instrument_snapshot{
+  instrument_snapshot();
+  bool          enabled = instrumented;
+  stage_summary stages[stage_count];
+  uint64_t      counters[counter_count];
+  stage_summary const&operator[](stage s)const{ return stages[static_cast<uint32_t>(s)]; }
+  uint64_t            operator[](counter c)const{ return counters[static_cast<uint32_t>(c)]; }
+};
+
+struct instruments{
+  instruments(){ reset(); }
+  instrument_snapshot snapshot()const;
+  void                reset();
+
+  latency_histogram     stages[stage_count];
+  std::atomic<uint64_t> counters[counter_count];
+};
+
+// process wide, every demuxer records into it
+instruments&demux_instruments();
+char const *stage_name(stage s);
+char const *counter_name(counter c);
+// one line per stage and counter, times in microseconds
+std::string instrument_dump(instrument_snapshot const&v);
+
+inline uint64_t instrument_now(){
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+#ifdef FLV_INSTRUMENT
+inline void instrument_record(stage s, uint64_t ns){ demux_instruments().stages[static_cast<uint32_t>(s)].record(ns); }
+inline void instrument_count(counter c, uint64_t n = 1){ demux_instruments().counters[static_cast<uint32_t>(c)].fetch_add(n, std::memory_order_relaxed); }
+
+// start of a stage, stopped later, possibly in a completion callback
+struct stage_mark{
+  uint64_t at = 0;
+  void start(){ at = instrument_now(); }
+  void stop(stage s)const{ if (at) instrument_record(s, instrument_now() - at); }
+};
+#else
+inline void instrument_record(stage, uint64_t){}
+inline void instrument_count(counter, uint64_t = 1){}
+
+struct stage_mark{
+  void start(){}
+  void stop(stage)const{}
+};
+#endif
+
+// times the enclosing scope
+struct stage_scope{
+  explicit stage_scope(stage s) : s(s){ mark.start(); }
+  stage_scope(stage_scope const&) = delete;
+  ~stage_scope(){ mark.stop(s); }
+  stage_mark mark;
+  stage      s;
+};
+}
@@ -3,17 +3,17 @@
 #include "flv.hpp"
 #include <vector>
 struct flv_meta {
-  flv::audio_codec     audiocodecid;  // only aac and mp3 are supported
-  flv::video_codec     videocodecid;  // only avc is supported, avc mapped to media_subtype_h264
+  flv::audio_codec     audiocodecid = flv::audio_codec::lpcm;  // only aac and mp3 are supported
+  flv::video_codec     videocodecid = flv::video_codec(0);  // only avc is supported, avc mapped to media_subtype_h264
   uint32_t              audiodatarate           = 0; //bits per second
   uint32_t              audiodelay              = 0; // seconds
   uint16_t              audiosamplesize         = 0; // 8bits /16bits
   uint64_t              audiosize               = 0; // bytes
-  uint64_t              duration;                    // seconds
-  uint64_t              filesize;                    // total file size bytes
-  uint64_t              datasize;                    // bytes
-  uint32_t              height ;                     // pixels
-  uint32_t              width;                       // pixels
+  uint64_t              duration                = 0; // seconds
+  uint64_t              filesize                = 0; // total file size bytes
+  uint64_t              datasize                = 0; // bytes
+  uint32_t              height                  = 0; // pixels
+  uint32_t              width                   = 0; // pixels
   uint32_t              videodatarate           = 0; // bits per second
   uint32_t              audiosamplerate         = 0; //bits per second
   uint32_t              framerate               = 0; // frames per second
@@ -0,0 +1,180 @@
+#include "flv_push_parser.hpp"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include "bigendian.hpp"
+#include "flv_instrument.hpp"
+
+void flv::push_parser::reset(){
+  st = state::file_header;
+  offset = 0;
+  remain = 0;
+  header_length = 0;
+  have = 0;
+}
+void flv::push_parser::reset_at_tag(uint64_t pos){
+  instrument_count(counter::seeks);
+  reset();
+  st = state::previous_tag_size;
+  offset = pos;
+}
+bool flv::push_parser::tag_boundary()const{
+  return have == 0 && (st == state::previous_tag_size || st == state::tag_header
+                       || (st == state::file_header && offset == 0));
+}
+
+// returns true and points *out to need bytes when they're complete
+// bytes are copied into scratch only if they are split across chunks
+bool flv::push_parser::gather(uint32_t need, uint8_t const*&data, size_t&length, uint8_t const**out){
+  assert(need <= sizeof(scratch));
+  if (have == 0 && length >= need){
+    *out = data;
+    data += need;
+    length -= need;
+    offset += need;
+    return true;
+  }
+  auto n = static_cast<uint32_t>(std::min<size_t>(need - have, length));
+  memcpy(scratch + have, data, n);
+  have += n;
+  data += n;
+  length -= n;
+  offset += n;
+  if (have < need)
+    return false;
+  have = 0;
+  *out = scratch;
+  return true;
+}
+
+// audio: sound-format byte (+ aac_packet_type)
+// video: frame-type/codec byte (+ avc_packet_type and composition_time)
+uint32_t flv::push_parser::codec_header_length(uint8_t first)const{
+  if (tag.type == flv::tag_type::audio){
+    auto x = reinterpret_cast<raw_audio_tag_header const&>(first);
+    return flv::audio_codec(x.sound_format) == flv::audio_codec::aac
+      ? flv_audio_header_length + flv_aac_packet_type_length : flv_audio_header_length;
+  }
+  auto x = reinterpret_cast<raw_video_tag_header const&>(first);
+  return flv::video_codec(x.codec_id) == flv::video_codec::avc
+    ? flv_video_header_length + flv_avc_packet_type_length : flv_video_header_length;
+}
+
+int32_t flv::push_parser::on_tag_header(uint8_t const*h){
+  {
+    stage_scope parse(stage::header_parse);
+    auto reader = bigendian::binary_reader(h, flv_tag_header_length);
+    auto f = reader.byte();
+    tag = push_tag();
+    tag.type = flv::tag_type(f & flv_tag_header_type_mask);
+    tag.filter = (f & (1 << flv_tag_header_filter_mask)) >> flv_tag_header_filter_mask;
+    tag.data_size = reader.ui24();
+    tag.nano_timestamp = uint64_t(reader.ui24() + (uint32_t(reader.byte()) << 24)) * 10000;  // millis to nano seconds
+    tag.stream_id = reader.ui24();
+    tag.data_offset = offset;
+    tag.tag_offset = offset - flv_tag_header_length;
+    header_length = 0;
+  }
+  instrument_count(counter::tags);
+  if ((tag.type == flv::tag_type::audio || tag.type == flv::tag_type::video) && tag.data_size){
+    st = state::codec_header;
+    return 0;
+  }
+  return begin_payload();
+}
+
+int32_t flv::push_parser::on_codec_header(uint8_t const*h){
+  if (tag.type == flv::tag_type::audio){
+    auto x = *reinterpret_cast<raw_audio_tag_header const*>(h);
+    tag.audio.codec_id = (flv::audio_codec)x.sound_format;
+    tag.audio.sound_rate = (flv::sound_rate)x.sound_rate;
+    tag.audio.sound_size = (flv::sound_size)x.sound_size;
+    tag.audio.sound_type = (flv::sound_type)x.sound_type;
+    if (header_length > flv_audio_header_length)
+      tag.aac_packet_type = flv::aac_packet_type(h[flv_audio_header_length]);
+  }
+  else{
+    auto x = *reinterpret_cast<raw_video_tag_header const*>(h);
+    tag.video.codec_id = (flv::video_codec)x.codec_id;
+    tag.video.frame_type = (flv::frame_type)x.frame_type;
+    if (header_length > flv_video_header_length){
+      auto reader = bigendian::binary_reader(h + flv_video_header_length, flv_avc_packet_type_length);
+      tag.avc.avc_packet_type = (flv::avc_packet_type)reader.byte();
+      tag.avc.composite_time = reader.ui24();
+    }
+  }
+  return begin_payload();
+}
+
+int32_t flv::push_parser::begin_payload(){
+  tag.payload_length = tag.data_size - header_length;
+  remain = tag.payload_length;
+  auto hr = sink->on_tag_begin(tag);
+  if (hr == 0 && remain == 0)
+    hr = sink->on_tag_end(tag);
+  st = remain ? state::payload : state::previous_tag_size;
+  return hr;
+}
+
+int32_t flv::push_parser::feed(uint8_t const*data, size_t length){
+  instrument_count(counter::bytes, length);
+  int32_t hr = 0;
+  uint8_t const*h = nullptr;
+  while (hr == 0 && length){
+    switch (st){
+    case state::file_header:
+      if (!gather(flv_file_header_length, data, length, &h))
+        break;
+      if (h[0] != 'F' || h[1] != 'L' || h[2] != 'V' || bigendian::touint32(h + 5) != flv_file_header_length){
+        hr = -1;
+        break;
+      }
+      {
+        ::flv_header fh;
+        fh.version = h[3];
+        fh.has_video = (h[4] & flv_file_header_video_mask) ? 1 : 0;
+        fh.has_audio = (h[4] & flv_file_header_audio_mask) ? 1 : 0;
+        st = state::previous_tag_size;
+        hr = sink->on_flv_header(fh);
+      }
+      break;
+    case state::previous_tag_size:
+      if (gather(flv_previous_tag_size_field_length, data, length, &h))
+        st = state::tag_header;
+      break;
+    case state::tag_header:
+      if (gather(flv_tag_header_length, data, length, &h))
+        hr = on_tag_header(h);
+      break;
+    case state::codec_header:
+      if (header_length == 0){
+        header_length = codec_header_length(have ? scratch[0] : data[0]);
+        if (header_length > tag.data_size){
+          hr = -1;
+          break;
+        }
+      }
+      if (gather(header_length, data, length, &h))
+        hr = on_codec_header(h);
+      break;
+    case state::payload:{
+      auto n = static_cast<uint32_t>(std::min<size_t>(remain, length));
+      hr = sink->on_tag_data(data, n);
+      data += n;
+      length -= n;
+      offset += n;
+      remain -= n;
+      if (hr == 0 && remain == 0){
+        st = state::previous_tag_size;
+        hr = sink->on_tag_end(tag);
+      }
+    }
+    break;
+    case state::failed:
+      return -1;
+    }
+  }
+  if (hr == -1)
+    st = state::failed;
+  return hr;
+}
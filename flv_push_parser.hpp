@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "flv.hpp"
+#include "flv_tag.hpp"
+
+namespace flv{
+// one tag as seen by the push parser
+// codec headers are decoded, payload bytes are delivered separately
+struct push_tag : public tag_header{
+  uint64_t              tag_offset     = 0;   // fileposition of tag header
+  uint32_t              payload_length = 0;   // bytes passed to on_tag_data, without codec header
+  ::audio_header        audio;                // if type == audio
+  flv::aac_packet_type  aac_packet_type = flv::aac_packet_type::aac_raw;  // if audio codec = 10
+  ::video_header        video;                // if type == video
+  ::avc_header          avc;                  // if video codec = 7
+};
+
+// receives tag events from push_parser::feed
+// non-zero return value aborts feed and is returned to the caller
+struct push_parser_sink{
+  virtual ~push_parser_sink() = default;
+  virtual int32_t on_flv_header(::flv_header const&){ return 0; }
+  virtual int32_t on_tag_begin(push_tag const&) = 0;
+  // data points into the chunk passed to feed, valid only during the call
+  virtual int32_t on_tag_data(uint8_t const*data, uint32_t length) = 0;
+  virtual int32_t on_tag_end(push_tag const&) = 0;
+};
+
+// resumable flv parser for bytes arriving in arbitrary chunks
+// only tag headers and codec headers split across chunks are copied,
+// payload bytes are passed through as slices of the fed chunks
+struct push_parser{
+  explicit push_parser(push_parser_sink*sink) : sink(sink){}
+  push_parser() = delete;
+  push_parser(push_parser const&) = delete;
+  push_parser&operator=(push_parser const&) = delete;
+
+  // 0: ok, -1: invalid format, other: value returned by sink
+  // format errors are sticky until reset
+  int32_t feed(uint8_t const*data, size_t length);
+
+  // expect flv file header at position 0
+  void     reset();
+  // expect previous_tag_size field at fileposition pos, e.g. after a seek
+  void     reset_at_tag(uint64_t pos);
+  uint64_t position()const{ return offset; }   // fileposition of next byte to be fed
+  bool     tag_boundary()const;                // not inside a tag
+
+private:
+  enum class state : uint8_t{
+    file_header,
+    previous_tag_size,
+    tag_header,
+    codec_header,
+    payload,
+    failed,
+  };
+  bool    gather(uint32_t need, uint8_t const*&data, size_t&length, uint8_t const**out);
+  int32_t on_tag_header(uint8_t const*h);
+  int32_t on_codec_header(uint8_t const*h);
+  int32_t begin_payload();
+  uint32_t codec_header_length(uint8_t first)const;
+
+  push_parser_sink *sink     = nullptr;
+  state             st       = state::file_header;
+  uint64_t          offset   = 0;  // fileposition of data passed to feed
+  uint32_t          remain   = 0;  // payload bytes left in current tag
+  uint32_t          header_length = 0;  // codec header bytes of current tag
+  uint32_t          have     = 0;  // bytes gathered into scratch
+  uint8_t           scratch[flv_tag_header_length];
+  push_tag          tag;
+};
+}
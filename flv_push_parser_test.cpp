@@ -0,0 +1,147 @@
+#include "flv_push_parser.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "file_io.hpp"
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+// everything the sink sees, payload bytes as a running hash
+struct recording_sink : public flv::push_parser_sink{
+  std::string    events;
+  uint64_t       hash        = 14695981039346656037ull;  // fnv-1a
+  uint32_t       tags        = 0;
+  uint8_t const *chunk       = nullptr;  // being fed
+  size_t         chunk_length = 0;
+  bool           copied      = false;    // payload passed from outside the fed chunk
+
+  int32_t on_flv_header(::flv_header const&h)override{
+    char b[32];
+    sprintf(b, "H%u%u;", h.has_audio, h.has_video);
+    events += b;
+    return 0;
+  }
+  int32_t on_tag_begin(flv::push_tag const&t)override{
+    char b[160];
+    sprintf(b, "B%u,%u,%llu,%llu,%u,%u,%u;", static_cast<uint32_t>(t.type), t.data_size,
+            static_cast<unsigned long long>(t.nano_timestamp), static_cast<unsigned long long>(t.tag_offset),
+            t.payload_length, static_cast<uint32_t>(t.video.frame_type), static_cast<uint32_t>(t.avc.avc_packet_type));
+    events += b;
+    return 0;
+  }
+  int32_t on_tag_data(uint8_t const*data, uint32_t length)override{
+    if (data < chunk || data + length > chunk + chunk_length)
+      copied = true;
+    for (uint32_t i = 0; i < length; ++i)
+      hash = (hash ^ data[i]) * 1099511628211ull;
+    return 0;
+  }
+  int32_t on_tag_end(flv::push_tag const&)override{
+    char b[32];
+    sprintf(b, "E%llu;", static_cast<unsigned long long>(hash));
+    events += b;
+    ++tags;
+    return 0;
+  }
+};
+
+// a few seconds of synthetic avc and aac with onMetaData
+std::vector<uint8_t> sample_file(flv::synth_result*r){
+  auto path = flv::test::temp_path("push_parser.flv");
+  flv::synth_options o;
+  o.duration_ms = 4000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  std::vector<uint8_t> v;
+  flv::file f;
+  uint64_t size = 0;
+  if (flv::synthesize(path.c_str(), o, r) == 0 && f.open(path.c_str()) == 0 && f.size(&size) == 0){
+    v.resize(static_cast<size_t>(size));
+    if (f.read(0, v.data(), static_cast<uint32_t>(size)) != int64_t(size))
+      v.clear();
+  }
+  f.close();
+  flv::test::remove_file(path);
+  return v;
+}
+
+// chunk sizes: 0 feeds all at once, otherwise fixed, or random up to -chunk if negative
+int32_t feed(std::vector<uint8_t> const&data, int32_t chunk, recording_sink*sink, flv::push_parser*parser){
+  uint64_t state = 7;
+  for (size_t pos = 0; pos < data.size();){
+    size_t n = data.size() - pos;
+    if (chunk > 0)
+      n = std::min<size_t>(n, chunk);
+    else if (chunk < 0){
+      state = state * 6364136223846793005ull + 1442695040888963407ull;
+      n = std::min<size_t>(n, static_cast<size_t>((state >> 33) % static_cast<uint32_t>(-chunk) + 1));
+    }
+    sink->chunk = data.data() + pos;
+    sink->chunk_length = n;
+    auto hr = parser->feed(data.data() + pos, n);
+    if (hr != 0)
+      return hr;
+    pos += n;
+  }
+  return 0;
+}
+}
+
+FLV_TEST(push_parser_same_events_for_any_chunking){
+  flv::synth_result r;
+  auto data = sample_file(&r);
+  FLV_CHECK(!data.empty());
+
+  recording_sink whole;
+  flv::push_parser p(&whole);
+  FLV_CHECK(feed(data, 0, &whole, &p) == 0);
+  FLV_CHECK(whole.tags == r.tags);
+  FLV_CHECK(p.tag_boundary());
+
+  int32_t chunks[] = { 1, 7, 11, -64, -4096, -70000 };
+  for (auto chunk : chunks){
+    recording_sink s;
+    flv::push_parser q(&s);
+    FLV_CHECK(feed(data, chunk, &s, &q) == 0);
+    FLV_CHECK(s.events == whole.events);
+    FLV_CHECK(s.hash == whole.hash);
+    FLV_CHECK(!s.copied);
+    FLV_CHECK(q.tag_boundary());
+    FLV_CHECK(q.position() == data.size());
+  }
+}
+
+FLV_TEST(push_parser_resumes_at_tag_after_seek){
+  flv::synth_result r;
+  auto data = sample_file(&r);
+  recording_sink whole;
+  flv::push_parser p(&whole);
+  FLV_CHECK(feed(data, 0, &whole, &p) == 0);
+
+  // the first tag begun in the second half of the event log
+  auto middle = whole.events.find("B", whole.events.size() / 2);
+  FLV_CHECK(middle != std::string::npos);
+  unsigned type = 0, size = 0;
+  unsigned long long ts = 0, offset = 0;
+  FLV_CHECK(sscanf(whole.events.c_str() + middle, "B%u,%u,%llu,%llu", &type, &size, &ts, &offset) == 4);
+
+  std::vector<uint8_t> tail(data.begin() + static_cast<ptrdiff_t>(offset) - 4, data.end());
+  recording_sink s;
+  flv::push_parser q(&s);
+  q.reset_at_tag(offset - 4);
+  FLV_CHECK(feed(tail, 13, &s, &q) == 0);
+  FLV_CHECK(q.position() == data.size());
+  FLV_CHECK(s.events.compare(0, 1, "B") == 0);
+  FLV_CHECK(whole.events.find(s.events.substr(0, s.events.find(';') + 1)) == middle);
+}
+
+FLV_TEST(push_parser_rejects_damaged_header){
+  recording_sink s;
+  flv::push_parser p(&s);
+  uint8_t bad[] = { 'F', 'L', 'X', 1, 5, 0, 0, 0, 9, 0, 0, 0, 0 };
+  FLV_CHECK(p.feed(bad, sizeof(bad)) == -1);
+  FLV_CHECK(p.feed(bad, 1) == -1);  // sticky until reset
+}
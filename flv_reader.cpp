@@ -0,0 +1,264 @@
+#include "flv_reader.hpp"
+#include <algorithm>
+#include "bigendian.hpp"
+#include "amf.hpp"
+#include "flv_instrument.hpp"
+#include "flv_tag_table.hpp"
+
+const static uint32_t head_scan_tags = 256;    // tags searched for sequence headers
+const static uint32_t tail_scan_tags = 65536;  // tag headers walked forward to a torn tail
+
+namespace{
+bool media(flv::raw_tag const&t){
+  return t.type == flv::tag_type::audio || t.type == flv::tag_type::video;
+}
+
+// the last complete tags from pos on, for a tail without a final PreviousTagSize.
+// stops at the first tag that does not fit before end or does not look like a tag header
+int32_t scan_tail(flv::byte_source*src, uint64_t pos, uint64_t end, uint32_t*last_timestamp, flv::raw_tag*last_keyframe){
+  flv::raw_tag t;
+  bool found = false;
+  for (uint32_t i = 0; i < tail_scan_tags; ++i, pos = t.next()){
+    uint8_t h[flv::raw_tag_peek_length];
+    if (pos + flv::flv_tag_header_length > end)
+      return found ? 0 : 1;
+    auto cb = src->read(pos, h, sizeof(h));
+    if (cb < 0)
+      return -1;
+    if (cb < flv::flv_tag_header_length)
+      return found ? 0 : 1;
+    flv::decode_raw_tag(h, static_cast<uint32_t>(cb), pos, &t);
+    if ((!media(t) && t.type != flv::tag_type::script_data) || (h[0] & 0xc0) || t.data_offset() + t.data_size > end)
+      return found ? 0 : 1;
+    if (media(t)){
+      found = true;
+      *last_timestamp = t.timestamp;
+    }
+    if (last_keyframe && t.keyframe())
+      *last_keyframe = t;
+  }
+  return 1;  // gave up before the end
+}
+}
+
+bool flv::raw_tag::is_avc()const{
+  return type == flv::tag_type::video && data_size && flv::video_codec(codec[0] & 0x0f) == flv::video_codec::avc;
+}
+bool flv::raw_tag::is_aac()const{
+  return type == flv::tag_type::audio && data_size && flv::audio_codec(codec[0] >> 4) == flv::audio_codec::aac;
+}
+bool flv::raw_tag::sequence_header()const{
+  return (is_avc() || is_aac()) && data_size > 1 && codec[1] == 0;  // avc_sequence_header == aac_sequence_header == 0
+}
+bool flv::raw_tag::keyframe()const{
+  if (type != flv::tag_type::video || !data_size || sequence_header())
+    return false;
+  auto ft = flv::frame_type(codec[0] >> 4);
+  return ft == flv::frame_type::key_frame || ft == flv::frame_type::generated_key_frame;
+}
+
+void flv::decode_raw_tag(uint8_t const*h, uint32_t length, uint64_t pos, raw_tag*t){
+  auto reader = bigendian::binary_reader(h, length);
+  t->type = flv::tag_type(reader.byte() & flv_tag_header_type_mask);
+  t->data_size = reader.ui24();
+  t->timestamp = reader.ui24();
+  t->timestamp |= uint32_t(reader.byte()) << 24;
+  reader.skip(3);  // stream_id
+  t->position = pos;
+  t->codec[0] = (t->data_size > 0 && length > flv_tag_header_length) ? h[flv_tag_header_length] : 0;
+  t->codec[1] = (t->data_size > 1 && length > flv_tag_header_length + 1) ? h[flv_tag_header_length + 1] : 0;
+}
+
+void flv::patch_timestamp(uint8_t*h, uint32_t ms){
+  h[4] = uint8_t(ms >> 16);
+  h[5] = uint8_t(ms >> 8);
+  h[6] = uint8_t(ms);
+  h[7] = uint8_t(ms >> 24);  // timestamp_extended
+}
+
+void flv::encode_tag_header(uint8_t*h, flv::tag_type type, uint32_t data_size, uint32_t ms){
+  bigendian::binary_writer writer(h, flv_tag_header_length);
+  writer.byte(uint8_t(type));
+  writer.ui24(data_size);
+  writer.ui24(ms & 0xffffff);
+  writer.byte(uint8_t(ms >> 24));  // timestamp_extended
+  writer.ui24(0);                  // stream_id
+}
+
+int32_t flv::reader::read_tag(uint64_t pos, raw_tag*t, int32_t*cts){
+  uint8_t h[cts_peek_length];
+  stage_mark wait;
+  wait.start();
+  auto cb = source->read(pos, h, cts ? cts_peek_length : raw_tag_peek_length);
+  wait.stop(stage::read_wait);
+  if (cb < 0)
+    return -1;
+  instrument_count(counter::bytes, static_cast<uint64_t>(cb));
+  if (cb < flv_tag_header_length)
+    return 1;
+  {
+    stage_scope parse(stage::header_parse);
+    decode_raw_tag(h, static_cast<uint32_t>(cb), pos, t);
+  }
+  if (cts){
+    *cts = 0;
+    if (t->is_avc() && t->codec[1] == uint8_t(flv::avc_packet_type::avc_nalu) && cb == cts_peek_length && t->data_size >= 5)
+      *cts = int32_t(bigendian::touint24(h + raw_tag_peek_length) << 8) >> 8;  // si24
+  }
+  instrument_count(counter::tags);
+  return t->data_offset() + t->data_size > file_size ? 1 : 0;
+}
+
+int32_t flv::read_previous_tag(byte_source*src, uint64_t begin, uint64_t end, raw_tag*t){
+  if (end < begin + flv_tag_header_length + flv_previous_tag_size_field_length)
+    return 1;
+  uint8_t h[raw_tag_peek_length];
+  auto cb = src->read(end - flv_previous_tag_size_field_length, h, flv_previous_tag_size_field_length);
+  if (cb < 0)
+    return -1;
+  if (cb != flv_previous_tag_size_field_length)
+    return 1;
+  auto size = bigendian::touint32(h);
+  if (size < flv_tag_header_length || size > end - flv_previous_tag_size_field_length - begin)
+    return 1;
+  auto pos = end - flv_previous_tag_size_field_length - size;
+  if ((cb = src->read(pos, h, sizeof(h))) < 0)
+    return -1;
+  if (cb < flv_tag_header_length)
+    return 1;
+  decode_raw_tag(h, static_cast<uint32_t>(cb), pos, t);
+  // a previous tag size pointing at garbage rarely agrees with the data size found there
+  auto valid = t->type == flv::tag_type::audio || t->type == flv::tag_type::video || t->type == flv::tag_type::script_data;
+  return valid && t->data_size + flv_tag_header_length == size && (h[0] & 0xc0) == 0 ? 0 : 1;
+}
+
+int32_t flv::read_tail(byte_source*src, uint64_t begin, uint64_t end, uint32_t*last_timestamp, raw_tag*last_keyframe,
+                       uint32_t max_tags, uint64_t scan_from){
+  raw_tag t;
+  bool found = false;
+  if (last_keyframe)
+    *last_keyframe = raw_tag();
+  for (uint32_t i = 0; i < max_tags; ++i, end = t.position){
+    auto hr = read_previous_tag(src, begin, end, &t);
+    if (hr > 0 && !i && scan_from && scan_from >= begin)
+      return scan_tail(src, scan_from, end, last_timestamp, last_keyframe);
+    if (hr)
+      return hr < 0 || !i ? hr : 0;  // reached the first tag
+    if (!found && media(t)){
+      found = true;
+      *last_timestamp = t.timestamp;
+    }
+    if (last_keyframe && t.keyframe()){
+      *last_keyframe = t;
+      break;
+    }
+    if (found && !last_keyframe)
+      break;
+  }
+  return 0;
+}
+
+int32_t flv::reader::read_data(raw_tag const&t, packet*v){
+  stage_scope read(stage::payload_read);
+  *v = packet(t.data_size);
+  auto cb = source->read(t.data_offset(), v->_, t.data_size);
+  if (cb > 0)
+    instrument_count(counter::bytes, static_cast<uint64_t>(cb));
+  return cb == t.data_size ? 0 : -1;
+}
+
+int32_t flv::reader::open(){
+  uint8_t h[flv_file_header_length + flv_previous_tag_size_field_length];
+  if (source->size(&file_size) != 0 || source->read(0, h, sizeof(h)) != sizeof(h))
+    return -1;
+  auto data_offset = bigendian::touint32(h + 5);
+  if (h[0] != 'F' || h[1] != 'L' || h[2] != 'V' || data_offset < flv_file_header_length)
+    return -1;
+  header.version = h[3];
+  header.has_video = (h[4] & flv_file_header_video_mask) ? 1 : 0;
+  header.has_audio = (h[4] & flv_file_header_audio_mask) ? 1 : 0;
+  first_tag = data_offset + flv_previous_tag_size_field_length;
+
+  // stop when every stream has shown its sequence header or its first frame
+  bool video_done = !header.has_video, audio_done = !header.has_audio;
+  raw_tag t;
+  auto pos = first_tag;
+  for (uint32_t i = 0; i < head_scan_tags && !(video_done && audio_done && i); ++i, pos = t.next()){
+    auto hr = read_tag(pos, &t);
+    if (hr < 0)
+      return -1;
+    if (hr > 0)
+      break;
+    if (t.type == flv::tag_type::script_data && script_tag.type == flv::tag_type::eof){
+      packet d;
+      script_tag = t;
+      if (read_data(t, &d) == 0){
+        auto r = flv::amf_reader(d._, d.length);
+        has_meta = (r.skip_script_data_value() == 0 && flv::on_meta_data_decoder().decode(r, &meta) == 0) ? 1 : 0;
+      }
+      continue;
+    }
+    if ((t.type == flv::tag_type::video || t.type == flv::tag_type::audio) && !first_media_tag)
+      first_media_tag = t.position;
+    if (t.is_avc() && t.sequence_header() && avc_tag.type == flv::tag_type::eof){
+      avc_tag = t;
+      read_data(t, &avc_sequence_header);
+    }
+    else if (t.is_aac() && t.sequence_header() && aac_tag.type == flv::tag_type::eof){
+      aac_tag = t;
+      read_data(t, &aac_sequence_header);
+    }
+    if (t.type == flv::tag_type::video)
+      video_done = video_done || avc_tag.type != flv::tag_type::eof || !t.sequence_header();
+    else if (t.type == flv::tag_type::audio)
+      audio_done = audio_done || aac_tag.type != flv::tag_type::eof || !t.sequence_header();
+  }
+  if (!first_media_tag)
+    first_media_tag = pos;
+  // onMetaData of a recording cut by a crash is often zero or stale,
+  // a torn tail is walked from its last indexed keyframe still in the file
+  auto scan_from = first_media_tag;
+  auto&k = meta.keyframes.positions;
+  for (auto i = k.rbegin(); has_meta && i != k.rend(); ++i){
+    if (*i >= first_media_tag && *i < file_size){
+      scan_from = *i;
+      break;
+    }
+  }
+  if (read_tail(source, first_tag, file_size, &last_timestamp, &last_keyframe, head_scan_tags, scan_from) < 0)
+    return -1;
+  return 0;
+}
+
+int32_t flv::reader::build_index(::keyframes*v, uint32_t*last_timestamp, raw_tag*last_video, tag_table*table){
+  raw_tag t;
+  int32_t cts = 0;
+  *v = ::keyframes();
+  *last_timestamp = 0;
+  if (table){
+    *table = tag_table();
+    table->file_size = file_size;
+  }
+  for (auto pos = first_media_tag;; pos = t.next()){
+    auto hr = read_tag(pos, &t, table ? &cts : nullptr);
+    if (hr)
+      return hr < 0 ? -1 : 0;
+    if (table)
+      table->add(tag_record::make(t, cts));
+    if (t.keyframe())
+      v->push_keyframe(keyframe{ t.position, uint64_t(t.timestamp) * 10000 });  // millis to nano
+    if (t.type == flv::tag_type::audio || t.type == flv::tag_type::video)
+      *last_timestamp = std::max(*last_timestamp, t.timestamp);
+    if (last_video && t.type == flv::tag_type::video && !t.sequence_header())
+      *last_video = t;
+  }
+}
+
+int32_t flv::reader::keyframe_index(::keyframes*v){
+  if (has_meta && !meta.keyframes.empty() && meta.keyframes.positions.size() == meta.keyframes.times.size()){
+    *v = meta.keyframes;
+    return 0;
+  }
+  uint32_t last_timestamp;
+  return build_index(v, &last_timestamp);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include "flv.hpp"
+#include "flv_tag.hpp"
+#include "flv_meta.hpp"
+#include "packet.hpp"
+#include "byte_source.hpp"
+
+namespace flv{
+const static uint32_t raw_tag_peek_length = flv_tag_header_length + 2;  // tag header + codec bytes
+const static uint32_t cts_peek_length     = raw_tag_peek_length + 3;    // and the avc composition time
+struct tag_table;
+
+// tag header as stored in the file and the first two bytes of its data
+struct raw_tag{
+  raw_tag(){ codec[0] = codec[1] = 0; }  // v120 has no array member initializers
+  flv::tag_type type      = flv::tag_type::eof;
+  uint32_t      data_size = 0;
+  uint32_t      timestamp = 0;       // milliseconds, including timestamp_extended
+  uint64_t      position  = 0;       // fileposition of tag header
+  uint8_t       codec[2];            // sound format or frame type/codec id, aac or avc packet type
+
+  uint64_t data_offset()const{ return position + flv_tag_header_length; }
+  uint64_t next()const{ return data_offset() + data_size + flv_previous_tag_size_field_length; }
+  bool     is_avc()const;
+  bool     is_aac()const;
+  bool     sequence_header()const;   // avc or aac sequence header
+  bool     keyframe()const;          // video key frame, not a sequence header
+};
+
+// h holds at least flv_tag_header_length bytes, codec bytes are decoded if length allows
+void decode_raw_tag(uint8_t const*h, uint32_t length, uint64_t pos, raw_tag*t);
+// rewrites timestamp and timestamp_extended of the tag header at h
+void patch_timestamp(uint8_t*h, uint32_t ms);
+// writes an 11 bytes tag header
+void encode_tag_header(uint8_t*h, flv::tag_type type, uint32_t data_size, uint32_t ms);
+
+// tag whose PreviousTagSize field ends at end, not before begin, the first tag header
+// 0: ok, 1: no valid tag there (start of file, truncated or damaged tail), -1: error
+int32_t read_previous_tag(byte_source*src, uint64_t begin, uint64_t end, raw_tag*t);
+// walks backwards from end to the last audio or video tag for its timestamp,
+// then on to the last video keyframe if last_keyframe is given, at most max_tags tags.
+// a tail torn inside a tag has no PreviousTagSize to start from, the tags are then walked
+// forward from scan_from up to the last complete one if scan_from is a tag header, not 0.
+// last_keyframe is left type eof if none is found. 0: ok, 1: damaged tail, -1: error
+int32_t read_tail(byte_source*src, uint64_t begin, uint64_t end, uint32_t*last_timestamp, raw_tag*last_keyframe,
+                  uint32_t max_tags = 4096, uint64_t scan_from = 0);
+
+// reads the head of a flv file: file header, onMetaData and codec sequence headers
+// and walks tag headers without touching payloads
+struct reader{
+  explicit reader(byte_source*src) : source(src){}
+  reader() = delete;
+
+  int32_t open();                                    // 0: ok, -1: not a flv file
+  // 0: ok, 1: no complete tag at pos, -1: error. cts is the composition time of an avc nalu tag, 0 for others
+  int32_t read_tag(uint64_t pos, raw_tag*t, int32_t*cts = nullptr);
+  int32_t read_data(raw_tag const&t, packet*v);      // whole data of the tag, codec bytes included
+  // scans every tag header, last_video is the last complete video tag if asked for.
+  // table gets a record of every media tag in the same scan
+  int32_t build_index(::keyframes*v, uint32_t*last_timestamp, raw_tag*last_video = nullptr, tag_table*table = nullptr);
+  // keyframes of onMetaData when they are consistent, build_index otherwise
+  int32_t keyframe_index(::keyframes*v);
+
+  byte_source *source;
+  uint64_t     file_size       = 0;
+  ::flv_header header;
+  flv_meta     meta;
+  uint8_t      has_meta        = 0;
+  uint64_t     first_tag       = 0;  // fileposition of first tag header
+  uint64_t     first_media_tag = 0;  // fileposition of first audio or video tag header
+  uint32_t     last_timestamp  = 0;  // of the final audio or video tag, from the end of file, 0 if the tail is damaged
+  raw_tag      last_keyframe;        // final video keyframe near the end of file, type eof if not found
+  raw_tag      script_tag;           // onMetaData, type eof if there is none
+  raw_tag      avc_tag;              // avc sequence header, type eof if there is none
+  raw_tag      aac_tag;              // aac sequence header
+  packet       avc_sequence_header;  // data of avc_tag
+  packet       aac_sequence_header;  // data of aac_tag
+};
+}
@@ -0,0 +1,107 @@
+#include "flv_reader.hpp"
+#include <string>
+#include <vector>
+#include "file_io.hpp"
+#include "flv_sim_source.hpp"
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+// ten seconds, a keyframe every second, as bytes
+std::vector<uint8_t> sample_file(bool meta_keyframes){
+  auto path = flv::test::temp_path("reader.flv");
+  flv::synth_options o;
+  o.duration_ms = 10000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  o.meta_keyframes = meta_keyframes;
+  flv::synth_result r;
+  std::vector<uint8_t> v;
+  flv::file f;
+  uint64_t size = 0;
+  if (flv::synthesize(path.c_str(), o, &r) == 0 && f.open(path.c_str()) == 0 && f.size(&size) == 0){
+    v.resize(static_cast<size_t>(size));
+    if (f.read(0, v.data(), static_cast<uint32_t>(size)) != int64_t(size))
+      v.clear();
+  }
+  f.close();
+  flv::test::remove_file(path);
+  return v;
+}
+
+// every tag of the file, walked forward
+std::vector<flv::raw_tag> tags_of(std::vector<uint8_t> const&data){
+  std::vector<flv::raw_tag> v;
+  flv::memory_source memory(data);
+  flv::reader rd(&memory);
+  flv::raw_tag t;
+  if (rd.open() != 0)
+    return v;
+  for (auto pos = rd.first_tag; rd.read_tag(pos, &t) == 0; pos = t.next())
+    v.push_back(t);
+  return v;
+}
+
+// the last media tag and the last keyframe that end before length
+void expected_tail(std::vector<flv::raw_tag> const&tags, uint64_t length, uint32_t*last_timestamp, flv::raw_tag*last_keyframe){
+  for (auto&t : tags){
+    if (t.data_offset() + t.data_size > length)
+      break;
+    if (t.type == flv::tag_type::audio || t.type == flv::tag_type::video)
+      *last_timestamp = t.timestamp;
+    if (t.keyframe())
+      *last_keyframe = t;
+  }
+}
+}
+
+FLV_TEST(reader_tail_of_a_complete_file){
+  auto data = sample_file(true);
+  auto tags = tags_of(data);
+  FLV_CHECK(tags.size() > 100);
+  uint32_t last = 0;
+  flv::raw_tag key;
+  expected_tail(tags, data.size(), &last, &key);
+  flv::memory_source memory(data);
+  flv::reader rd(&memory);
+  FLV_CHECK(rd.open() == 0);
+  FLV_CHECK(last > 9000 && rd.last_timestamp == last);
+  FLV_CHECK(rd.last_keyframe.keyframe() && rd.last_keyframe.position == key.position && rd.last_keyframe.timestamp == 9000);
+}
+
+// a recording cut inside a tag has no final PreviousTagSize, the tail is walked forward
+// from the last indexed keyframe, or from the first media tag without an index
+FLV_TEST(reader_tail_of_a_file_truncated_mid_tag){
+  for (int indexed = 0; indexed < 2; ++indexed){
+    auto data = sample_file(indexed != 0);
+    auto tags = tags_of(data);
+    FLV_CHECK(tags.size() > 100);
+    if (tags.size() <= 100)
+      return;
+    // cut through the data of a video tag about three quarters in
+    auto i = tags.size() * 3 / 4;
+    while (i < tags.size() && tags[i].type != flv::tag_type::video)
+      ++i;
+    FLV_CHECK(i < tags.size() && tags[i].data_size > 2);
+    if (i >= tags.size())
+      return;
+    auto cut = tags[i].data_offset() + tags[i].data_size / 2;
+    uint32_t last = 0;
+    flv::raw_tag key;
+    expected_tail(tags, cut, &last, &key);
+    FLV_CHECK(last && last < tags.back().timestamp && key.keyframe());
+
+    flv::memory_source torn(data.data(), cut);
+    flv::reader rd(&torn);
+    FLV_CHECK(rd.open() == 0);
+    FLV_CHECK(rd.last_timestamp == last);
+    FLV_CHECK(rd.last_keyframe.keyframe() && rd.last_keyframe.position == key.position);
+
+    // without a start for the forward walk the torn tail stays unknown
+    uint32_t unknown = 0;
+    flv::raw_tag none;
+    FLV_CHECK(flv::read_tail(&torn, rd.first_tag, cut, &unknown, &none, 16) == 1);
+    FLV_CHECK(unknown == 0 && none.type == flv::tag_type::eof);
+  }
+}
@@ -0,0 +1,92 @@
+#include "flv_reverse.hpp"
+#include <algorithm>
+#include "bigendian.hpp"
+
+const static uint64_t nano_per_ms = 10000;  // keyframes times are 100ns units
+
+int32_t flv::gop_iterator::open(){
+  if (rd.open() != 0 || rd.keyframe_index(&index) != 0 || index.empty())
+    return -1;
+  cursor = gop_count();
+  return 0;
+}
+
+size_t flv::gop_iterator::find(uint32_t ms)const{
+  auto&t = index.times;
+  auto i = std::upper_bound(t.begin(), t.end(), uint64_t(ms) * nano_per_ms);
+  return i == t.begin() ? 0 : static_cast<size_t>(i - t.begin() - 1);
+}
+
+int32_t flv::gop_iterator::previous(gop const**v){
+  if (cursor == 0)
+    return 1;
+  return at(cursor - 1, v);
+}
+
+int32_t flv::gop_iterator::next(gop const**v){
+  if (cursor + 1 >= gop_count())
+    return 1;
+  return at(cursor + 1, v);
+}
+
+int32_t flv::gop_iterator::at(size_t i, gop const**v){
+  if (i >= gop_count())
+    return 1;
+  auto hit = std::find_if(cache.begin(), cache.end(), [i](gop const&g){ return g.index == i; });
+  if (hit != cache.end())
+    cache.splice(cache.begin(), cache, hit);
+  else{
+    if (!cache.empty() && cache.size() >= std::max<size_t>(cache_gops, 1))
+      cache.splice(cache.begin(), cache, std::prev(cache.end()));  // reuses its arena
+    else
+      cache.emplace_front();
+    if (load(cache.front(), i) != 0){
+      cache.pop_front();
+      return -1;
+    }
+  }
+  cursor = i;
+  *v = &cache.front();
+  return 0;
+}
+
+int32_t flv::gop_iterator::load(gop&g, size_t i){
+  g.index = i;
+  g.begin = index.positions[i];
+  g.end = i + 1 < gop_count() ? index.positions[i + 1] : rd.file_size;
+  if (g.end <= g.begin || g.end > rd.file_size)
+    return -1;
+  auto length = static_cast<uint32_t>(g.end - g.begin);
+  if (g.arena.size() < length)
+    g.arena.resize(length);
+  auto cb = rd.source->read(g.begin, g.arena.data(), length);
+  if (cb < 0)
+    return -1;
+  bytes += static_cast<uint64_t>(cb);
+  ++reads;
+  length = static_cast<uint32_t>(cb);
+  g.end = g.begin + length;  // short at a truncated end of file
+
+  g.frames.clear();
+  g.first_ms = UINT32_MAX;
+  g.last_ms = 0;
+  raw_tag t;
+  for (uint32_t p = 0; p + flv_tag_header_length <= length; p = static_cast<uint32_t>(t.next() - g.begin)){
+    decode_raw_tag(g.arena.data() + p, length - p, g.begin + p, &t);
+    if (p + flv_tag_header_length + uint64_t(t.data_size) > length)
+      break;
+    if (t.type != flv::tag_type::video || !t.data_size || t.sequence_header())
+      continue;
+    auto data = p + flv_tag_header_length;
+    int32_t cts = 0;
+    if (t.is_avc() && t.data_size >= flv_video_header_length + flv_avc_packet_type_length)
+      cts = int32_t(bigendian::touint24(g.arena.data() + data + 2) << 8) >> 8;  // si24
+    g.frames.push_back(gop_frame{ data, t.data_size, t.timestamp, cts, t.keyframe() });
+    auto pts = static_cast<uint32_t>(std::max<int64_t>(0, int64_t(t.timestamp) + cts));
+    g.first_ms = std::min(g.first_ms, pts);
+    g.last_ms = std::max(g.last_ms, pts);
+  }
+  if (g.frames.empty())
+    g.first_ms = g.last_ms = static_cast<uint32_t>(index.times[i] / nano_per_ms);
+  return 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <vector>
+#include "flv_reader.hpp"
+#include "keyframes.hpp"
+
+namespace flv{
+struct gop_frame{
+  uint32_t offset;  // tag data in the gop arena, codec bytes included
+  uint32_t size;
+  uint32_t dts;     // milliseconds
+  int32_t  cts;     // composition time offset of avc, 0 otherwise
+  bool     key;
+};
+
+// video tags from one keyframe up to the next, sequence headers left out
+struct gop{
+  size_t                 index    = 0;  // into the keyframes index
+  uint64_t               begin    = 0;  // fileposition of the keyframe tag
+  uint64_t               end      = 0;  // fileposition of the next keyframe tag or end of file, [begin, end) is in the arena
+  uint32_t               first_ms = 0;  // presentation span, earliest and latest pts
+  uint32_t               last_ms  = 0;
+  std::vector<uint8_t>   arena;         // [begin, end) as read
+  std::vector<gop_frame> frames;        // decode order
+};
+
+// gop by gop iteration over the keyframes index, backwards for reverse playback.
+// a gop is read with one sequential range read into its arena. the last cache_gops gops are kept,
+// turning around re-reads nothing, an evicted gop hands its arena to the next one read
+struct gop_iterator{
+  explicit gop_iterator(byte_source*src) : rd(src){}
+  gop_iterator(gop_iterator const&) = delete;
+
+  size_t cache_gops = 4;
+
+  int32_t open();                          // 0: ok, -1: not flv or no keyframes. the cursor is after the last gop
+  size_t  gop_count()const{ return index.positions.size(); }
+  size_t  find(uint32_t ms)const;          // gop holding the keyframe at or before ms
+  // 0: ok, 1: no gop in that direction, -1: error.
+  // the gop stays valid until cache_gops other gops have been read
+  int32_t at(size_t i, gop const**v);      // makes gop i current
+  int32_t previous(gop const**v);
+  int32_t next(gop const**v);
+
+  flv::reader     rd;
+  ::keyframes     index;
+  size_t          cursor = 0;  // current gop, gop_count() before the first one is asked for
+  std::list<gop>  cache;       // most recently used first
+  uint64_t        bytes  = 0;  // read from the source
+  uint32_t        reads  = 0;
+
+private:
+  int32_t load(gop&g, size_t i);
+};
+}
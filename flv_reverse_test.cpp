@@ -0,0 +1,64 @@
+#include "flv_reverse.hpp"
+#include <string>
+#include "file_io.hpp"
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+// eight seconds, a keyframe every second
+struct sample{
+  std::string path = flv::test::temp_path("reverse.flv");
+  flv::file   f;
+  sample(){
+    flv::synth_options o;
+    o.duration_ms = 8000;
+    o.width = 320;
+    o.height = 240;
+    o.gop_frames = 25;
+    flv::synth_result r;
+    if (flv::synthesize(path.c_str(), o, &r) != 0 || f.open(path.c_str()) != 0)
+      flv::test::fail(__FILE__, __LINE__, "sample file");
+  }
+  ~sample(){
+    f.close();
+    flv::test::remove_file(path);
+  }
+};
+}
+
+FLV_TEST(gop_iterator_walks_backwards){
+  sample s;
+  flv::gop_iterator it(&s.f);
+  FLV_CHECK(it.open() == 0);
+  FLV_CHECK(it.gop_count() == 8);
+  FLV_CHECK(it.find(5500) == 5 && it.find(0) == 0 && it.find(60000) == 7);
+
+  flv::gop const*g = nullptr;
+  for (size_t i = it.gop_count(); i-- > 0;){
+    FLV_CHECK(it.previous(&g) == 0);
+    FLV_CHECK(g->index == i);
+    FLV_CHECK(g->frames.size() == 25);
+    FLV_CHECK(g->frames.front().key);
+    FLV_CHECK(g->first_ms == i * 1000 && g->last_ms == i * 1000 + 24 * 40);
+    for (size_t k = 1; k < g->frames.size(); ++k)
+      FLV_CHECK(!g->frames[k].key && g->frames[k].dts > g->frames[k - 1].dts);
+  }
+  FLV_CHECK(it.previous(&g) == 1);
+  FLV_CHECK(it.reads == 8);
+}
+
+FLV_TEST(gop_iterator_turning_around_reads_nothing_again){
+  sample s;
+  flv::gop_iterator it(&s.f);
+  it.cache_gops = 3;
+  FLV_CHECK(it.open() == 0);
+  flv::gop const*g = nullptr;
+  FLV_CHECK(it.at(4, &g) == 0 && it.previous(&g) == 0 && it.previous(&g) == 0);
+  FLV_CHECK(g->index == 2 && it.reads == 3);
+  FLV_CHECK(it.next(&g) == 0 && it.next(&g) == 0);  // 3 and 4 are cached
+  FLV_CHECK(g->index == 4 && it.reads == 3);
+  FLV_CHECK(it.next(&g) == 0);                       // 5 evicts 2
+  FLV_CHECK(g->index == 5 && it.reads == 4 && it.cache.size() == 3);
+  FLV_CHECK(it.at(2, &g) == 0 && it.reads == 5);
+  FLV_CHECK(it.at(it.gop_count(), &g) == 1);
+}
@@ -0,0 +1,73 @@
+#include "flv_seek_plan.hpp"
+#include <algorithm>
+
+namespace{
+uint32_t pts_of(flv::tag_record const&r){
+  return static_cast<uint32_t>(std::max<int64_t>(0, int64_t(r.timestamp) + r.cts()));
+}
+}
+
+int32_t flv::plan_seek(tag_table const&t, uint32_t ms, seek_plan*v){
+  *v = seek_plan();
+  auto audio_count = t.frame_count(flv::tag_type::audio);
+  auto video_count = t.frame_count(flv::tag_type::video);
+  if (!video_count){
+    if (!audio_count)
+      return -1;
+    auto a = t.frame_at_time(ms, flv::tag_type::audio);
+    auto r = t.frame_at(a == audio_count ? 0 : a, flv::tag_type::audio);
+    v->keyframe_position = v->audio_position = r->offset();
+    v->keyframe_ms = v->target_ms = r->timestamp;
+    return 0;
+  }
+
+  // frames decoded after the last one with dts <= ms are presented after ms too.
+  // the frame shown at ms has the latest pts at or before it, it is in the previous gop
+  // if every frame of this one is reordered past ms
+  auto last = t.frame_at_time(ms);
+  if (last == video_count)
+    last = 0;
+  size_t k = 0;
+  uint32_t target = 0, lowest = UINT32_MAX;
+  bool found = false;
+  for (;;){
+    k = t.keyframe_of(last);
+    for (auto i = k; i <= last; ++i){
+      auto pts = pts_of(*t.frame_at(i));
+      lowest = std::min(lowest, pts);
+      if (pts <= ms && (!found || pts > target)){
+        target = pts;
+        found = true;
+      }
+    }
+    if (found || k == 0)
+      break;
+    last = k - 1;
+    lowest = UINT32_MAX;
+  }
+  auto key = t.frame_at(k);
+  v->keyframe = k;
+  v->keyframe_position = key->offset();
+  v->keyframe_ms = key->timestamp;
+  v->target_ms = found ? target : lowest;
+  v->preroll_end = k;
+  for (auto i = k; i <= last; ++i){
+    auto r = t.frame_at(i);
+    if (pts_of(*r) >= v->target_ms)
+      continue;
+    ++v->preroll_frames;
+    v->preroll_bytes += r->size();
+    v->preroll_end = i + 1;
+  }
+
+  // audio tags are in file order, those between the keyframe and the one playing at the target are skipped
+  auto&audio = t.audio;
+  auto first = static_cast<size_t>(std::upper_bound(audio.begin(), audio.end(), t.video[k]) - audio.begin());
+  auto a = t.frame_at_time(v->target_ms, flv::tag_type::audio);
+  if (a == audio_count || a < first)
+    a = first;
+  for (auto i = first; i < a; ++i)
+    v->skipped_bytes += t.frame_at(i, flv::tag_type::audio)->size();
+  v->audio_position = a < audio_count ? t.frame_at(a, flv::tag_type::audio)->offset() : t.file_size;
+  return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include "flv_tag_table.hpp"
+
+namespace flv{
+// what to read and what to present for a frame accurate seek.
+// demuxing restarts at the keyframe, video frames presented before target_ms are decoded only,
+// audio tags from the keyframe up to audio_position end before the target and are not read
+struct seek_plan{
+  uint64_t keyframe_position = 0;  // fileposition of the tag header demuxing restarts at
+  uint32_t keyframe_ms       = 0;  // its timestamp
+  uint32_t target_ms         = 0;  // pts of the first presented frame, the frame shown at the requested time
+  size_t   keyframe          = 0;  // video frame index of the keyframe
+  size_t   preroll_end       = 0;  // video frames [keyframe, preroll_end) in decode order hold every decode only frame
+  uint32_t preroll_frames    = 0;  // frames in that range presented before target_ms
+  uint64_t preroll_bytes     = 0;  // their tag data
+  uint64_t audio_position    = 0;  // fileposition of the first audio tag read, the one playing at target_ms
+  uint64_t skipped_bytes     = 0;  // audio tag data before audio_position that is stepped over
+};
+
+// 0: ok, -1: the table has no frames. without video the plan starts at the audio frame playing at ms
+int32_t plan_seek(tag_table const&t, uint32_t ms, seek_plan*v);
+}
@@ -0,0 +1,94 @@
+#include "flv_seek_plan.hpp"
+#include <string>
+#include "file_io.hpp"
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+// 25 frames per second, a keyframe every second, aac from the start
+int32_t sample_table(flv::tag_table*t){
+  auto path = flv::test::temp_path("seek_plan.flv");
+  flv::synth_options o;
+  o.duration_ms = 5000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  flv::synth_result r;
+  flv::file f;
+  auto hr = flv::synthesize(path.c_str(), o, &r);
+  if (hr == 0)
+    hr = f.open(path.c_str());
+  if (hr == 0){
+    auto rd = flv::reader(&f);
+    hr = rd.open() == 0 ? t->build(rd) : -1;
+  }
+  f.close();
+  flv::test::remove_file(path);
+  return hr;
+}
+}
+
+FLV_TEST(seek_plan_between_keyframes){
+  flv::tag_table t;
+  FLV_CHECK(sample_table(&t) == 0);
+  FLV_CHECK(t.frame_count() == 125);
+
+  flv::seek_plan v;
+  FLV_CHECK(flv::plan_seek(t, 2500, &v) == 0);
+  FLV_CHECK(v.keyframe == 50);
+  FLV_CHECK(v.keyframe_ms == 2000);
+  FLV_CHECK(v.keyframe_position == t.frame_at(50)->offset());
+  FLV_CHECK(v.target_ms == 2480);  // frames are 40 ms apart
+  FLV_CHECK(v.preroll_frames == 12);
+  FLV_CHECK(v.preroll_end == 62);
+  auto a = t.frame_at(t.frame_at_time(2480, flv::tag_type::audio), flv::tag_type::audio);
+  FLV_CHECK(a && v.audio_position == a->offset() && a->timestamp <= 2480);
+  FLV_CHECK(v.audio_position > v.keyframe_position && v.skipped_bytes > 0);
+
+  // on a keyframe nothing is decoded only
+  FLV_CHECK(flv::plan_seek(t, 3000, &v) == 0);
+  FLV_CHECK(v.keyframe_ms == 3000 && v.target_ms == 3000 && v.preroll_frames == 0);
+}
+
+FLV_TEST(seek_plan_table_survives_save_and_load){
+  flv::tag_table t;
+  FLV_CHECK(sample_table(&t) == 0);
+  auto path = flv::test::temp_path("seek_plan.flvt");
+  FLV_CHECK(t.save(path.c_str()) == 0);
+  flv::tag_table u;
+  FLV_CHECK(u.load(path.c_str(), t.file_size + 1) == -1);  // stale
+  FLV_CHECK(u.load(path.c_str(), t.file_size) == 0);
+  FLV_CHECK(u.records.size() == t.records.size() && u.video == t.video && u.audio == t.audio);
+  flv::test::remove_file(path);
+}
+
+// the table comes out of the keyframe index scan, its keyframes are the index
+FLV_TEST(seek_plan_table_built_with_the_keyframe_index){
+  auto path = flv::test::temp_path("seek_plan_index.flv");
+  flv::synth_options o;
+  o.duration_ms = 5000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  flv::synth_result r;
+  flv::file f;
+  FLV_CHECK(flv::synthesize(path.c_str(), o, &r) == 0 && f.open(path.c_str()) == 0);
+  auto rd = flv::reader(&f);
+  FLV_CHECK(rd.open() == 0);
+  ::keyframes index;
+  uint32_t last_timestamp = 0;
+  flv::tag_table t;
+  FLV_CHECK(rd.build_index(&index, &last_timestamp, nullptr, &t) == 0);
+  FLV_CHECK(t.file_size == rd.file_size && t.frame_count() == r.video_frames && t.frame_count(flv::tag_type::audio) == r.audio_frames);
+  FLV_CHECK(index.positions.size() == 5);
+  for (size_t i = 0, k = 0; i < t.frame_count(); ++i){
+    auto v = t.frame_at(i);
+    if (!v->keyframe())
+      continue;
+    FLV_CHECK(k < index.positions.size() && index.positions[k] == v->offset() && index.times[k] == uint64_t(v->timestamp) * 10000);
+    ++k;
+  }
+  FLV_CHECK(t.records.back().timestamp <= last_timestamp);
+  f.close();
+  flv::test::remove_file(path);
+}
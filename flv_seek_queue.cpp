@@ -0,0 +1,25 @@
+#include "flv_seek_queue.hpp"
+
+uint64_t flv::seek_queue::request(uint32_t ms){
+  std::lock_guard<std::mutex> l(lock);
+  auto g = latest.load(std::memory_order_relaxed) + 1;
+  seek_request v;
+  v.generation = g;
+  v.ms = ms;
+  pending.push_back(v);
+  latest.store(g, std::memory_order_release);  // in-flight reads of older generations stop
+  return g;
+}
+
+bool flv::seek_queue::take(seek_request*v, std::vector<seek_request>*dropped){
+  std::lock_guard<std::mutex> l(lock);
+  if (pending.empty())
+    return false;
+  *v = pending.back();
+  dropped_count += pending.size() - 1;
+  if (dropped)
+    dropped->insert(dropped->end(), pending.begin(), pending.end() - 1);
+  pending.clear();
+  ++taken;
+  return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace flv{
+struct seek_request{
+  uint64_t generation = 0;  // 1 for the first request, growing by one
+  uint32_t ms         = 0;
+};
+
+// latest-wins seek requests, e.g. from a dragged seek bar.
+// requests arrive from any thread, the demuxer takes only the newest one and the rest are dropped.
+// reads on behalf of a request check current() when they complete and are dropped once a newer one arrives
+struct seek_queue{
+  uint64_t request(uint32_t ms);             // returns the generation of the new request
+  // false if nothing is pending. requests older than the taken one are appended to dropped
+  bool     take(seek_request*v, std::vector<seek_request>*dropped = nullptr);
+  bool     current(uint64_t generation)const{ return generation == latest.load(std::memory_order_acquire); }
+
+  std::atomic<uint64_t> latest{ 0 };          // generation of the newest request
+  uint64_t              taken         = 0;    // counted by take, read them from the demuxer thread
+  uint64_t              dropped_count = 0;
+
+private:
+  std::mutex                lock;
+  std::vector<seek_request> pending;
+};
+}
@@ -0,0 +1,119 @@
+#include "flv_seek_queue.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "file_io.hpp"
+#include "flv_reader.hpp"
+#include "flv_sim_source.hpp"
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+// ten seconds, a keyframe every second, as bytes
+std::vector<uint8_t> sample_file(){
+  auto path = flv::test::temp_path("seek_queue.flv");
+  flv::synth_options o;
+  o.duration_ms = 10000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  flv::synth_result r;
+  std::vector<uint8_t> v;
+  flv::file f;
+  uint64_t size = 0;
+  if (flv::synthesize(path.c_str(), o, &r) == 0 && f.open(path.c_str()) == 0 && f.size(&size) == 0){
+    v.resize(static_cast<size_t>(size));
+    if (f.read(0, v.data(), static_cast<uint32_t>(size)) != int64_t(size))
+      v.clear();
+  }
+  f.close();
+  flv::test::remove_file(path);
+  return v;
+}
+}
+FLV_TEST(seek_queue_coalesces_to_the_newest){
+  flv::seek_queue q;
+  for (uint32_t i = 0; i < 100; ++i)
+    q.request(i * 40);
+  flv::seek_request v;
+  std::vector<flv::seek_request> dropped;
+  FLV_CHECK(q.take(&v, &dropped));
+  FLV_CHECK(v.generation == 100 && v.ms == 99 * 40);
+  FLV_CHECK(dropped.size() == 99 && q.dropped_count == 99);
+  FLV_CHECK(!q.take(&v));
+  FLV_CHECK(q.current(100) && !q.current(99));
+}
+
+// a seek bar dragged across the file: 100 requests, one every 500us, replayed against a reader on a slow source.
+// time is the simulated time of the throttled reads, a request arrives once that time has passed.
+// a seek reads the tag header and data of its keyframe and checks its generation at each completion
+// like FlvSource::Superseded, a stale one is dropped
+FLV_TEST(seek_queue_100_rapid_seeks){
+  auto data = sample_file();
+  FLV_CHECK(!data.empty());
+  flv::memory_source memory(data);
+  flv::throttled_source slow(&memory);
+  slow.latency_us = 2000;
+  slow.bytes_per_second = 20 << 20;
+  slow.sleep = false;
+  flv::reader rd(&slow);
+  ::keyframes index;
+  FLV_CHECK(rd.open() == 0 && rd.keyframe_index(&index) == 0 && index.times.size() == 10);
+
+  // the most a single seek can cost: its two reads and its largest keyframe tag
+  flv::raw_tag t;
+  uint64_t largest = 0;
+  for (auto pos : index.positions){
+    FLV_CHECK(rd.read_tag(pos, &t) == 0);
+    largest = std::max<uint64_t>(largest, t.next() - t.position);
+  }
+  auto seek_us = 2 * slow.latency_us + largest * 1000000 / slow.bytes_per_second + 1;
+  slow.reset();
+
+  const uint32_t requests = 100, interval_us = 500;
+  flv::seek_queue q;
+  uint32_t arrived = 0;
+  uint64_t idle = 0;  // simulated time without reads, waiting for a request
+  auto now = [&]{ return slow.elapsed_us + idle; };
+  auto arrive = [&]{
+    for (; arrived < requests && uint64_t(arrived) * interval_us <= now(); ++arrived)
+      q.request(arrived * 97);  // ms, dragged forward across the file
+  };
+  uint32_t served = 0;
+  uint64_t final_us = 0;
+  flv::raw_tag final_tag;
+  ::packet p;
+  for (;;){
+    arrive();
+    flv::seek_request r;
+    if (!q.take(&r)){
+      if (arrived == requests)
+        break;
+      idle = uint64_t(arrived) * interval_us - slow.elapsed_us;
+      continue;
+    }
+    auto k = index.seek(uint64_t(r.ms) * 10000);
+    FLV_CHECK(rd.read_tag(k.position, &t) == 0);
+    arrive();
+    if (!q.current(r.generation))
+      continue;
+    FLV_CHECK(rd.read_data(t, &p) == 0);
+    arrive();
+    if (!q.current(r.generation))
+      continue;
+    ++served;
+    if (r.generation == requests){
+      final_us = now() - uint64_t(requests - 1) * interval_us;
+      final_tag = t;
+    }
+  }
+
+  FLV_CHECK(q.taken + q.dropped_count == requests);  // every request is taken or coalesced away
+  FLV_CHECK(served < requests / 4);
+  // only taken seeks read, each at most one keyframe tag with its two reads
+  FLV_CHECK(slow.reads <= 2 * q.taken);
+  FLV_CHECK(slow.bytes <= q.taken * largest);
+  // the last seek waits at most for the read in flight and then its own
+  FLV_CHECK(final_us > 0 && final_us <= 2 * seek_us);
+  FLV_CHECK(final_tag.keyframe() && final_tag.position == index.seek(uint64_t(99 * 97) * 10000).position);
+}
@@ -0,0 +1,50 @@
+#include "flv_sim_source.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+int64_t flv::memory_source::read(uint64_t pos, void*v, uint32_t count){
+  if (pos >= length)
+    return 0;
+  auto n = static_cast<uint32_t>(std::min<uint64_t>(count, length - pos));
+  memcpy(v, data + pos, n);
+  return n;
+}
+
+uint64_t flv::throttled_source::next(){
+  auto z = (state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+void flv::throttled_source::reset(){
+  state = seed;
+  elapsed_us = max_delay_us = bytes = 0;
+  reads = stalls = 0;
+}
+
+int64_t flv::throttled_source::read(uint64_t pos, void*data, uint32_t length){
+  auto cb = source->read(pos, data, length);
+  // the generator advances the same way whatever the source returned
+  uint64_t delay = latency_us;
+  auto r = next();
+  if (jitter_us)
+    delay += r % (uint64_t(jitter_us) + 1);
+  r = next();
+  if (stall_probability > 0 && double(r >> 11) / double(1ull << 53) < stall_probability){
+    delay += stall_us;
+    ++stalls;
+  }
+  if (cb > 0 && bytes_per_second)
+    delay += uint64_t(cb) * 1000000 / bytes_per_second;
+  ++reads;
+  if (cb > 0)
+    bytes += static_cast<uint64_t>(cb);
+  elapsed_us += delay;
+  max_delay_us = std::max(max_delay_us, delay);
+  if (sleep && delay)
+    std::this_thread::sleep_for(std::chrono::microseconds(delay));
+  return cb;
+}
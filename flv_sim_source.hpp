@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "byte_source.hpp"
+
+namespace flv{
+// flv bytes held in memory
+struct memory_source : public byte_source{
+  memory_source(uint8_t const*data, uint64_t length) : data(data), length(length){}
+  explicit memory_source(std::vector<uint8_t> const&v) : data(v.data()), length(v.size()){}
+
+  int64_t read(uint64_t pos, void*v, uint32_t count) override;
+  int32_t size(uint64_t*v) override{ *v = length; return 0; }
+
+  uint8_t const *data;
+  uint64_t       length;
+};
+
+// byte source delaying the reads of another one like a network or slow disk would.
+// every read costs latency, up to jitter more, its bytes at bytes_per_second, and now and then a stall.
+// the delays come from a generator seeded with seed, the same reads see the same delays on every run and platform.
+// with sleep off the delays are only added up in elapsed_us, benchmarks compare them without waiting
+struct throttled_source : public byte_source{
+  explicit throttled_source(byte_source*src, uint64_t seed = 1) : source(src), seed(seed), state(seed){}
+
+  int64_t read(uint64_t pos, void*data, uint32_t length) override;
+  int32_t size(uint64_t*v) override{ return source->size(v); }
+  void    reset();                    // restarts the generator and the counters
+
+  byte_source *source;
+  uint32_t     latency_us        = 0;
+  uint32_t     jitter_us         = 0;
+  uint64_t     bytes_per_second  = 0;  // 0: no cap
+  double       stall_probability = 0;  // per read
+  uint32_t     stall_us          = 0;
+  bool         sleep             = true;
+  uint64_t     seed;
+
+  uint64_t     elapsed_us = 0;         // delays of all reads so far
+  uint64_t     max_delay_us = 0;       // of a single read
+  uint32_t     reads  = 0;
+  uint32_t     stalls = 0;
+  uint64_t     bytes  = 0;
+
+private:
+  uint64_t next();                     // splitmix64
+  uint64_t state;
+};
+}
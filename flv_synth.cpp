@@ -0,0 +1,210 @@
+#include "flv_synth.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "avcc.hpp"
+#include "aac.hpp"
+#include "bigendian.hpp"
+#include "file_io.hpp"
+#include "flv_inject.hpp"
+#include "flv_writer.hpp"
+
+const static uint32_t noise_length       = 1024 * 1024;
+const static uint32_t aac_frame_samples  = 1024;
+const static uint32_t aac_rate           = 44100;
+const static uint32_t payload_slots      = flv::muxer_batch_tags * 2;  // the muxer holds payloads until its batch is written
+const static uint32_t nalu_length_size   = 4;
+
+namespace{
+struct splitmix{
+  uint64_t state;
+  uint64_t next(){
+    auto z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+  double unit(){ return double(next() >> 11) / double(1ull << 53); }  // [0, 1)
+};
+
+// msb first, for the few exp-golomb fields of a parameter set
+struct bit_writer{
+  std::vector<uint8_t> data;
+  uint32_t             bits = 0;
+  void u(uint32_t v, uint32_t n){
+    while (n--){
+      if (bits % 8 == 0)
+        data.push_back(0);
+      data.back() |= uint8_t(((v >> n) & 1) << (7 - bits % 8));
+      ++bits;
+    }
+  }
+  void ue(uint32_t v){
+    uint32_t n = 0;
+    while ((v + 1) >> (n + 1))
+      ++n;
+    u(0, n);
+    u(v + 1, n + 1);
+  }
+  packet rbsp(uint8_t nal_header){
+    u(1, 1);  // rbsp_stop_one_bit
+    data.insert(data.begin(), nal_header);
+    return packet(data.data(), static_cast<uint32_t>(data.size()));
+  }
+};
+
+// baseline profile sps and pps with the picture size, enough for parsers and media types
+flv::avcc make_avcc(uint32_t width, uint32_t height){
+  auto mbs_x = (width + 15) / 16, mbs_y = (height + 15) / 16;
+  bit_writer s;
+  s.u(66, 8);   // profile_idc, baseline
+  s.u(0xc0, 8); // constraint_set0, constraint_set1
+  s.u(31, 8);   // level_idc
+  s.ue(0);      // seq_parameter_set_id
+  s.ue(0);      // log2_max_frame_num_minus4
+  s.ue(2);      // pic_order_cnt_type
+  s.ue(1);      // max_num_ref_frames
+  s.u(0, 1);    // gaps_in_frame_num_value_allowed_flag
+  s.ue(mbs_x - 1);
+  s.ue(mbs_y - 1);
+  s.u(1, 1);    // frame_mbs_only_flag
+  s.u(1, 1);    // direct_8x8_inference_flag
+  auto crop_right = (mbs_x * 16 - width) / 2, crop_bottom = (mbs_y * 16 - height) / 2;
+  s.u(crop_right || crop_bottom ? 1 : 0, 1);
+  if (crop_right || crop_bottom){
+    s.ue(0);
+    s.ue(crop_right);
+    s.ue(0);
+    s.ue(crop_bottom);
+  }
+  s.u(0, 1);    // vui_parameters_present_flag
+  bit_writer p;
+  p.ue(0);      // pic_parameter_set_id
+  p.ue(0);      // seq_parameter_set_id
+  p.u(0, 2);    // entropy_coding_mode_flag, bottom_field_pic_order_in_frame_present_flag
+  p.ue(0);      // num_slice_groups_minus1
+  p.ue(0);      // num_ref_idx_l0_default_active_minus1
+  p.ue(0);      // num_ref_idx_l1_default_active_minus1
+  p.u(0, 3);    // weighted_pred_flag, weighted_bipred_idc
+  p.u(1, 1);    // pic_init_qp_minus26, se 0
+  p.u(1, 1);    // pic_init_qs_minus26
+  p.u(1, 1);    // chroma_qp_index_offset
+  p.u(4, 3);    // deblocking_filter_control_present_flag, constrained_intra_pred_flag, redundant_pic_cnt_present_flag
+  flv::avcc v;
+  v.profile = 66;
+  v.compatibility = 0xc0;
+  v.level = 31;
+  v.nal = nalu_length_size;  // nalu length bytes, the avcC field is written minus one
+  v.sps.push_back(s.rbsp(0x67));
+  v.pps.push_back(p.rbsp(0x68));
+  return v;
+}
+}
+
+int32_t flv::synthesize(char const*path, synth_options const&o, synth_result*r){
+  *r = synth_result();
+  splitmix rng{ o.seed };
+  std::vector<uint8_t> noise(noise_length);
+  for (uint32_t i = 0; i + 8 <= noise_length; i += 8){
+    auto v = rng.next();
+    memcpy(noise.data() + i, &v, 8);
+  }
+
+  auto fps = std::max<uint32_t>(o.frames_per_second, 1);
+  auto gop = std::max<uint32_t>(o.gop_frames, 1);
+  auto kbps = o.video_kbps ? o.video_kbps : static_cast<uint32_t>(uint64_t(o.width) * o.height * fps * 7 / 100 / 1000);
+  auto gop_bytes = double(kbps) * 1000 / 8 * gop / fps;
+  auto inter_bytes = gop_bytes / (gop - 1 + std::max<uint32_t>(o.keyframe_weight, 1));
+  auto audio_bytes = double(o.audio_kbps) * 1000 / 8 * aac_frame_samples / aac_rate;
+  auto video_frames = o.video ? static_cast<uint32_t>((uint64_t(o.duration_ms) * fps + 999) / 1000) : 0;
+  auto audio_frames = o.audio ? static_cast<uint32_t>((uint64_t(o.duration_ms) * aac_rate + uint64_t(aac_frame_samples) * 1000 - 1) / (uint64_t(aac_frame_samples) * 1000)) : 0;
+  auto video_ms = [fps](uint32_t i){ return static_cast<uint32_t>(uint64_t(i) * 1000 / fps); };
+  auto audio_ms = [](uint32_t i){ return static_cast<uint32_t>(uint64_t(i) * aac_frame_samples * 1000 / aac_rate); };
+
+  flv::file f;
+  if (f.create(path) != 0)
+    return -1;
+  {
+    flv::muxer m(&f);
+    m.header(o.audio, o.video);
+    if (o.meta){
+      flv_meta v;
+      v.has_video = o.video;
+      v.has_audio = o.audio;
+      v.duration = o.duration_ms / 1000;
+      if (o.video){
+        v.videocodecid = flv::video_codec::avc;
+        v.width = o.width;
+        v.height = o.height;
+        v.framerate = fps;
+        v.videodatarate = kbps;
+      }
+      if (o.audio){
+        v.audiocodecid = flv::audio_codec::aac;
+        v.audiosamplerate = aac_rate;
+        v.audiosamplesize = 16;
+        v.audiodatarate = o.audio_kbps;
+      }
+      m.meta(v);
+      ++r->tags;
+    }
+    if (o.video){
+      m.avc_sequence_header(make_avcc(o.width, o.height));
+      ++r->tags;
+    }
+    if (o.audio){
+      m.aac_sequence_header(flv::audio_specific_config());
+      ++r->tags;
+    }
+
+    std::vector<std::vector<uint8_t>> slots(payload_slots);
+    uint32_t slot = 0, noise_at = 0;
+    auto fill = [&](uint8_t*d, uint32_t length){
+      for (uint32_t done = 0; done < length;){
+        auto n = std::min(length - done, noise_length - noise_at);
+        memcpy(d + done, noise.data() + noise_at, n);
+        done += n;
+        noise_at = (noise_at + n) % noise_length;
+      }
+    };
+    uint32_t vi = 0, ai = 0, run_end = 0;
+    while ((vi < video_frames || ai < audio_frames) && !m.failed){
+      auto audio_next = ai < audio_frames && (vi == video_frames || audio_ms(ai) <= video_ms(vi) || audio_ms(ai) < run_end);
+      if (audio_next){
+        if (o.interleave_ms && audio_ms(ai) >= run_end)
+          run_end = audio_ms(ai) + o.interleave_ms;
+        auto length = std::max<uint32_t>(8, static_cast<uint32_t>(audio_bytes * (0.9 + 0.2 * rng.unit())));
+        auto&d = slots[slot++ % payload_slots];
+        d.resize(length);
+        fill(d.data(), length);
+        m.aac(audio_ms(ai++), d.data(), length);
+        ++r->audio_frames;
+      }
+      else{
+        auto key = vi % gop == 0;
+        auto length = std::max<uint32_t>(16, static_cast<uint32_t>(inter_bytes * (key ? o.keyframe_weight : 1) * (0.75 + 0.5 * rng.unit())));
+        auto&d = slots[slot++ % payload_slots];
+        d.resize(length);
+        bigendian::binary_writer w(d.data(), length);
+        w.ui32(length - nalu_length_size);
+        w.byte(key ? 0x65 : 0x41);  // idr or non-idr slice
+        fill(d.data() + w.pointer, length - w.pointer);
+        m.avc(video_ms(vi++), 0, key, d.data(), length);
+        ++r->video_frames;
+        r->keyframes += key;
+      }
+      ++r->tags;
+    }
+    if (m.flush() != 0)
+      return -1;
+    r->bytes = m.position();
+  }
+  f.close();
+
+  if (o.meta && o.meta_keyframes && o.video){
+    inject_result ir;
+    if (injector().inject(path, &ir) != 0 || f.open(path) != 0 || f.size(&r->bytes) != 0)
+      return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include "flv.hpp"
+
+namespace flv{
+struct synth_options{
+  uint32_t duration_ms       = 60 * 1000;
+  uint32_t width             = 1280;  // video payload sizes follow the pixel count
+  uint32_t height            = 720;
+  uint32_t frames_per_second = 25;
+  uint32_t gop_frames        = 50;    // keyframe interval
+  uint32_t keyframe_weight   = 6;     // keyframe size in inter frames
+  uint32_t video_kbps        = 0;     // 0: 0.07 bits per pixel and frame
+  bool     video             = true;
+  bool     audio             = true;  // aac lc 44.1 kHz stereo, 1024 samples per frame
+  uint32_t audio_kbps        = 128;
+  uint32_t interleave_ms     = 0;     // audio frames are written in runs this long, 0: each before the video frame after it
+  bool     meta              = true;  // onMetaData
+  bool     meta_keyframes    = true;  // keyframes index in onMetaData
+  uint64_t seed              = 1;     // payload bytes and size variation
+};
+
+struct synth_result{
+  uint64_t bytes        = 0;
+  uint32_t tags         = 0;
+  uint32_t video_frames = 0;
+  uint32_t audio_frames = 0;
+  uint32_t keyframes    = 0;
+};
+
+// writes a synthetic flv with avc and aac tags, payloads are noise wrapped in a valid nalu or aac frame.
+// the same options give the same file. 0: ok, -1: write failed
+int32_t synthesize(char const*path, synth_options const&o, synth_result*r);
+}
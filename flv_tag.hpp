@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include "flv.hpp"
+#include "packet.hpp"
+//struct aac_audio_spec_config;// iso-14496-3
+//struct aac_raw_frame_data;
+
+struct flv_header{
+  uint8_t version   = 0;
+  uint8_t has_video = 0;
+  uint8_t has_audio = 0;
+};
+struct tag_header {
+  flv::tag_type type;
+  int8_t        filter    = 0;    //1 encrypted, 0 : no pre-preocessing
+  uint32_t      data_size = 0;    // message size bytes
+  uint64_t      nano_timestamp = 0;    //milliseconds
+  uint32_t      stream_id = 0;
+  uint64_t      data_offset = 0;  // fileposition of payload
+};
+
+struct audio_header {
+  flv::audio_codec         codec_id;
+  flv::sound_rate          sound_rate = flv::sound_rate::_44k;  // kbits
+  flv::sound_size          sound_size = flv::sound_size::_16bits; // 8 /16 bits
+  flv::sound_type          sound_type = flv::sound_type::stereo;// 1 : stereo, 0 : mono
+};
+
+struct video_header {
+  flv::frame_type  frame_type;
+  flv::video_codec codec_id;
+};
+struct avc_header{
+  flv::avc_packet_type  avc_packet_type;
+  uint32_t              composite_time    = 0;
+};
+
+// be filled after parse audio-tag header
+struct audio_packet_header : public tag_header, public audio_header{
+  int32_t                       stream_id;  // Raw stream_id field.  // must be 0
+  flv::aac_packet_type          aac_packet_type;// if codec = 10
+  packet                        payload;
+
+  audio_packet_header() = default;
+  explicit audio_packet_header(tag_header const&t) : tag_header(t){};
+  explicit audio_packet_header(tag_header const&t, audio_header const&ah)
+      : tag_header(t), stream_id(0), audio_header(ah){
+  }
+
+  //载荷数据长度，不包含tag_header, audio_header, aac_packet_type
+  uint32_t payload_length()const {
+    auto v = data_size - flv::flv_audio_header_length;
+    if (codec_id == flv::audio_codec::aac)
+      v -= flv::flv_aac_packet_type_length;
+    return v;
+  }
+  uint64_t payload_offset()const{
+    return data_offset + data_size - payload_length();
+  }
+  uint8_t channels()const{
+    return uint8_t(sound_type) + 1;
+  }
+  uint32_t sample_per_sec()const{
+    return 44100 * (1 << uint32_t(sound_rate)) / 8;
+  }
+  uint32_t bits_per_sample()const{
+    return 8 * (uint32_t(sound_size) + 1);
+  }
+};
+
+struct video_packet_header : public tag_header, public video_header{
+  int32_t                          stream_id;       // Raw stream_id field. must be 0
+  flv::avc_packet_type             avc_packet_type;// if codec = 7
+  uint32_t                         composition_time;// if codec = 7, milli seconds
+
+  packet                            payload;  // not include avc_packet_type and composite_time
+//  flv::avcc                         avcc;     //avc_decoder_configuration_record;
+  //载荷数据长度，不包含tag_header, audio_header, avc_packet_type
+  uint32_t payload_length()const{
+    auto v = data_size - flv::flv_video_header_length;
+    if (codec_id == flv::video_codec::avc)
+      v -= flv::flv_avc_packet_type_length; // sizeof(composite) + sizeof(avcpackettype)
+    return v;
+  }
+  uint64_t payload_offset()const{
+    return data_offset + data_size - payload_length();
+  }
+  video_packet_header() = default;
+  explicit video_packet_header(tag_header const&t) : tag_header(t){};
+  video_packet_header(tag_header const&t, video_header const&v) :tag_header(t), video_header(v){  }
+};
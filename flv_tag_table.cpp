@@ -0,0 +1,119 @@
+#include "flv_tag_table.hpp"
+#include <algorithm>
+#include <cstring>
+#include "bigendian.hpp"
+#include "file_io.hpp"
+
+const static uint8_t  tag_table_magic[4]   = { 'F', 'L', 'V', 'T' };
+const static uint32_t tag_table_header     = 4 + 4 + 8 + 4;  // magic, version, file size, records
+const static uint32_t tag_record_length    = 16;
+
+flv::tag_record flv::tag_record::make(raw_tag const&t, int32_t cts){
+  tag_record r;
+  r.offset_size = (t.position << 24) | (t.data_size & 0xffffff);
+  r.timestamp = t.timestamp;
+  r.cts_flags = (uint32_t(cts) << 8) | uint8_t(t.type) | (t.keyframe() ? keyframe_flag : 0) | (t.sequence_header() ? sequence_header_flag : 0);
+  return r;
+}
+
+flv::raw_tag flv::tag_record::tag()const{
+  raw_tag t;
+  t.type = type();
+  t.data_size = size();
+  t.timestamp = timestamp;
+  t.position = offset();
+  return t;
+}
+
+void flv::tag_table::add(tag_record const&r){
+  auto i = static_cast<uint32_t>(records.size());
+  records.push_back(r);
+  if (r.sequence_header() || !r.size())
+    return;
+  if (r.type() == flv::tag_type::video)
+    video.push_back(i);
+  else if (r.type() == flv::tag_type::audio)
+    audio.push_back(i);
+}
+
+int32_t flv::tag_table::build(reader&rd){
+  ::keyframes index;
+  uint32_t last_timestamp = 0;
+  return rd.build_index(&index, &last_timestamp, nullptr, this);
+}
+
+int32_t flv::tag_table::save(char const*path)const{
+  if (tag_table_header + uint64_t(records.size()) * tag_record_length > UINT32_MAX)
+    return -1;  // written with one 32 bits write
+  std::vector<uint8_t> data(tag_table_header + records.size() * tag_record_length);
+  bigendian::binary_writer w(data.data(), static_cast<uint32_t>(data.size()));
+  w.bytes(tag_table_magic, sizeof(tag_table_magic));
+  w.ui32(tag_table_version);
+  w.ui64(file_size);
+  w.ui32(static_cast<uint32_t>(records.size()));
+  for (auto&r : records){
+    w.ui64(r.offset_size);
+    w.ui32(r.timestamp);
+    w.ui32(r.cts_flags);
+  }
+  flv::file f;
+  if (w.overflow || f.create(path) != 0)
+    return -1;
+  return f.write(0, data.data(), static_cast<uint32_t>(data.size())) == int64_t(data.size()) ? 0 : -1;
+}
+
+int32_t flv::tag_table::load(char const*path, uint64_t expected_file_size){
+  flv::file f;
+  uint64_t length = 0;
+  uint8_t h[tag_table_header];
+  if (f.open(path) != 0 || f.size(&length) != 0 || f.read(0, h, sizeof(h)) != sizeof(h))
+    return -1;
+  auto r = bigendian::binary_reader(h, sizeof(h));
+  if (memcmp(h, tag_table_magic, sizeof(tag_table_magic)) != 0)
+    return -1;
+  r.skip(sizeof(tag_table_magic));
+  auto version = r.ui32();
+  auto size = r.ui64();
+  auto count = r.ui32();
+  auto bytes = uint64_t(count) * tag_record_length;
+  if (version != tag_table_version || size != expected_file_size || length != tag_table_header + bytes || bytes > UINT32_MAX)
+    return -1;  // read with one 32 bits read
+  std::vector<uint8_t> data(static_cast<size_t>(bytes));
+  if (f.read(tag_table_header, data.data(), static_cast<uint32_t>(data.size())) != int64_t(data.size()))
+    return -1;
+  records.clear();
+  video.clear();
+  audio.clear();
+  records.reserve(count);
+  file_size = size;
+  auto d = bigendian::binary_reader(data.data(), static_cast<uint32_t>(data.size()));
+  for (uint32_t i = 0; i < count; ++i){
+    tag_record v;
+    v.offset_size = d.ui64();
+    v.timestamp = d.ui32();
+    v.cts_flags = d.ui32();
+    add(v);
+  }
+  return 0;
+}
+
+size_t flv::tag_table::frame_count(flv::tag_type stream)const{
+  return frames(stream).size();
+}
+
+flv::tag_record const* flv::tag_table::frame_at(size_t i, flv::tag_type stream)const{
+  auto&v = frames(stream);
+  return i < v.size() ? &records[v[i]] : nullptr;
+}
+
+size_t flv::tag_table::frame_at_time(uint32_t ms, flv::tag_type stream)const{
+  auto&v = frames(stream);
+  auto i = std::upper_bound(v.begin(), v.end(), ms, [this](uint32_t t, uint32_t k){ return t < records[k].timestamp; });
+  return i == v.begin() ? v.size() : static_cast<size_t>(i - v.begin() - 1);
+}
+
+size_t flv::tag_table::keyframe_of(size_t i)const{
+  while (i > 0 && i < video.size() && !records[video[i]].keyframe())
+    --i;
+  return i;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "flv.hpp"
+#include "flv_reader.hpp"
+
+namespace flv{
+const static uint32_t tag_table_version = 1;
+
+// one tag in 16 bytes
+struct tag_record{
+  uint64_t offset_size = 0;  // fileposition of the tag header << 24 | data_size, 40 and 24 bits
+  uint32_t timestamp   = 0;  // milliseconds
+  uint32_t cts_flags   = 0;  // avc composition time offset << 8 | flags, 24 and 8 bits
+
+  const static uint32_t keyframe_flag        = 0x20;
+  const static uint32_t sequence_header_flag = 0x40;
+
+  static tag_record make(raw_tag const&t, int32_t cts);
+  uint64_t       offset()const{ return offset_size >> 24; }
+  uint32_t       size()const{ return uint32_t(offset_size & 0xffffff); }
+  int32_t        cts()const{ return int32_t(cts_flags) >> 8; }
+  flv::tag_type  type()const{ return flv::tag_type(cts_flags & flv_tag_header_type_mask); }
+  bool           keyframe()const{ return (cts_flags & keyframe_flag) != 0; }
+  bool           sequence_header()const{ return (cts_flags & sequence_header_flag) != 0; }
+  raw_tag        tag()const;  // codec bytes are not kept
+};
+static_assert(sizeof(tag_record) == 16, "tag_record is a 16 bytes record");
+
+// every tag of a file for frame accurate access, built by reader::build_index or loaded from a sidecar.
+// frames are video and audio tags without sequence headers, numbered per stream
+struct tag_table{
+  std::vector<tag_record> records;  // file order, from the first media tag
+  std::vector<uint32_t>   video;    // indices into records of video frames
+  std::vector<uint32_t>   audio;
+  uint64_t                file_size = 0;  // of the file the table describes
+
+  int32_t build(reader&rd);                  // build_index for the table only. 0: ok, -1: error
+  int32_t load(char const*path, uint64_t expected_file_size);  // -1: missing, damaged or stale
+  int32_t save(char const*path)const;
+
+  size_t            frame_count(flv::tag_type stream = flv::tag_type::video)const;
+  tag_record const* frame_at(size_t i, flv::tag_type stream = flv::tag_type::video)const;  // nullptr if out of range
+  // last frame of the stream with a timestamp at or before ms, frame_count() if there is none
+  size_t            frame_at_time(uint32_t ms, flv::tag_type stream = flv::tag_type::video)const;
+  // keyframe the frame depends on, i itself for audio and keyframes
+  size_t            keyframe_of(size_t i)const;
+  void              add(tag_record const&r);  // appends a record in file order
+
+private:
+  std::vector<uint32_t> const&frames(flv::tag_type stream)const{ return stream == flv::tag_type::audio ? audio : video; }
+};
+}
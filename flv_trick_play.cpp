@@ -0,0 +1,58 @@
+#include "flv_trick_play.hpp"
+#include <algorithm>
+#include <cmath>
+
+const static uint64_t nano_per_ms = 10000;  // keyframes times are 100ns units
+const static size_t   no_keyframe = SIZE_MAX;
+
+int32_t flv::trick_player::open(){
+  if (rd.open() != 0 || rd.keyframe_index(&index) != 0 || index.empty())
+    return -1;
+  seek(0);
+  return 0;
+}
+
+void flv::trick_player::seek(uint32_t ms){
+  auto&t = index.times;
+  auto i = std::upper_bound(t.begin(), t.end(), uint64_t(ms) * nano_per_ms);
+  cursor = i == t.begin() ? 0 : static_cast<size_t>(i - t.begin() - 1);
+  elapsed = 0;
+}
+
+int32_t flv::trick_player::next(trick_frame*v){
+  auto&t = index.times;
+  if (rate == 0 || cursor >= t.size())
+    return 1;
+  if (rd.read_tag(index.positions[cursor], &v->tag) != 0 || !v->tag.keyframe())
+    return -1;  // the index does not match the file
+  if (rd.read_data(v->tag, &v->data) != 0)
+    return -1;
+  bytes += raw_tag_peek_length + v->tag.data_size;
+  v->source_ms = v->tag.timestamp;
+  v->ms = static_cast<uint32_t>(elapsed + 0.5);
+
+  auto now = t[cursor];
+  auto speed = std::fabs(rate);
+  size_t n = no_keyframe;
+  if (frames_per_second){
+    auto step = std::max<uint64_t>(1, uint64_t(speed * 1000 / frames_per_second * nano_per_ms));
+    if (rate > 0)
+      n = static_cast<size_t>(std::lower_bound(t.begin(), t.end(), now + step) - t.begin());
+    else if (now >= step){
+      auto i = std::upper_bound(t.begin(), t.end(), now - step);
+      if (i != t.begin())
+        n = static_cast<size_t>(i - t.begin() - 1);
+    }
+    elapsed += 1000.0 / frames_per_second;
+  }
+  else{
+    if (rate > 0)
+      n = cursor + 1;
+    else if (cursor > 0)
+      n = cursor - 1;
+    if (n < t.size())
+      elapsed += double(n > cursor ? t[n] - now : now - t[n]) / nano_per_ms / speed;
+  }
+  cursor = n;
+  return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include "flv_reader.hpp"
+#include "keyframes.hpp"
+#include "packet.hpp"
+
+namespace flv{
+struct trick_frame{
+  raw_tag  tag;        // video keyframe tag
+  packet   data;       // tag data, codec bytes included
+  uint32_t source_ms;  // timestamp in the file
+  uint32_t ms;         // timestamp on the trick play timeline, 0 at the first frame
+};
+
+// keyframe only fast-forward and rewind for scrubbing.
+// jumps from keyframe to keyframe with the keyframes index and reads only those video tags, audio is never read.
+// with frames_per_second 0 every keyframe in the direction of rate is shown, spaced by its distance / rate.
+// otherwise frames_per_second frames are shown per second of wall clock,
+// each the keyframe at least rate / frames_per_second seconds of source past the previous one
+struct trick_player{
+  explicit trick_player(byte_source*src) : rd(src){}
+  trick_player(trick_player const&) = delete;
+
+  double   rate              = 8;  // source time per wall clock time, negative rewinds
+  uint32_t frames_per_second = 0;
+
+  int32_t open();               // 0: ok, -1: not flv or no keyframes
+  void    seek(uint32_t ms);    // next frame is the keyframe at or before ms, the timeline restarts
+  int32_t next(trick_frame*v);  // 0: ok, 1: no more keyframes in the direction of rate, -1: error
+
+  flv::reader  rd;
+  ::keyframes  index;
+  size_t       cursor  = 0;    // index of the next keyframe
+  double       elapsed = 0;    // trick play timeline of the next frame, milliseconds
+  uint64_t     bytes   = 0;    // read from the source for frames
+};
+}
@@ -0,0 +1,83 @@
+#include "flv_trick_play.hpp"
+#include <string>
+#include <vector>
+#include "file_io.hpp"
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+// ten seconds, a keyframe every second
+struct sample{
+  std::string path = flv::test::temp_path("trick_play.flv");
+  flv::file   f;
+  sample(){
+    flv::synth_options o;
+    o.duration_ms = 10000;
+    o.width = 320;
+    o.height = 240;
+    o.gop_frames = 25;
+    flv::synth_result r;
+    if (flv::synthesize(path.c_str(), o, &r) != 0 || f.open(path.c_str()) != 0)
+      flv::test::fail(__FILE__, __LINE__, "sample file");
+  }
+  ~sample(){
+    f.close();
+    flv::test::remove_file(path);
+  }
+};
+
+// source and timeline timestamps of every frame until next stops
+int32_t play(flv::trick_player&p, std::vector<uint32_t>*source, std::vector<uint32_t>*timeline){
+  flv::trick_frame v;
+  int32_t hr;
+  while ((hr = p.next(&v)) == 0){
+    if (!v.tag.keyframe() || v.data.length != v.tag.data_size)
+      return -1;
+    source->push_back(v.source_ms);
+    timeline->push_back(v.ms);
+  }
+  return hr;
+}
+}
+
+FLV_TEST(trick_play_every_keyframe_forward_and_back){
+  sample s;
+  flv::trick_player p(&s.f);
+  FLV_CHECK(p.open() == 0);
+  std::vector<uint32_t> source, timeline;
+  FLV_CHECK(play(p, &source, &timeline) == 1);
+  FLV_CHECK(source.size() == 10);
+  for (uint32_t i = 0; i < source.size(); ++i){
+    FLV_CHECK(source[i] == i * 1000);
+    FLV_CHECK(timeline[i] == i * 125);  // a second of source at rate 8
+  }
+
+  p.rate = -4;
+  p.seek(5500);
+  source.clear();
+  timeline.clear();
+  FLV_CHECK(play(p, &source, &timeline) == 1);
+  FLV_CHECK(source.size() == 6 && source.front() == 5000 && source.back() == 0);
+  FLV_CHECK(timeline.size() == 6 && timeline[1] == 250 && timeline.back() == 1250);
+}
+
+FLV_TEST(trick_play_fixed_frame_rate_skips_keyframes){
+  sample s;
+  flv::trick_player p(&s.f);
+  p.rate = 20;
+  p.frames_per_second = 10;  // two seconds of source per frame
+  FLV_CHECK(p.open() == 0);
+  std::vector<uint32_t> source, timeline;
+  FLV_CHECK(play(p, &source, &timeline) == 1);
+  FLV_CHECK(source.size() == 5);
+  for (uint32_t i = 0; i < source.size(); ++i){
+    FLV_CHECK(source[i] == i * 2000);
+    FLV_CHECK(timeline[i] == i * 100);
+  }
+  uint64_t size = 0;
+  FLV_CHECK(s.f.size(&size) == 0 && p.bytes < size / 4);  // only the shown keyframes are read
+
+  p.rate = 0;
+  flv::trick_frame v;
+  FLV_CHECK(p.next(&v) == 1);
+}
@@ -0,0 +1,134 @@
+#include "flv_trim.hpp"
+#include <algorithm>
+#include "amf.hpp"
+#include "flv_reader.hpp"
+#include "flv_writer.hpp"
+#include "block_copy.hpp"
+
+int32_t flv::trimmer::trim(char const*in, char const*out, trim_result*r){
+  flv::file i, o;
+  if (i.open(in) != 0 || o.create(out) != 0)
+    return -1;
+  return trim(i, o, r);
+}
+
+int32_t flv::trimmer::trim(file&in, file&out, trim_result*r){
+  auto rd = flv::reader(&in);
+  if (rd.open() != 0)
+    return -1;
+  ::keyframes index = rd.meta.keyframes;
+  uint32_t last_timestamp = 0;
+  if (index.empty() || index.positions.size() != index.times.size()){
+    if (rd.build_index(&index, &last_timestamp) != 0)
+      return -1;
+  }
+
+  // clip starts at the keyframe at or before begin, a file without keyframes at the first tag from begin
+  uint64_t start = rd.first_media_tag;
+  uint32_t base = 0;
+  size_t first = 0, last = 0;  // keyframes listed in the clip
+  if (!index.empty()){
+    auto it = std::upper_bound(index.times.begin(), index.times.end(), uint64_t(begin) * 10000);
+    first = it == index.times.begin() ? 0 : size_t(it - index.times.begin()) - 1;
+    last = first;
+    while (last < index.times.size() && index.times[last] / 10000 < end)
+      ++last;
+    start = index.positions[first];
+    base = static_cast<uint32_t>(index.times[first] / 10000);
+  }
+  else{
+    raw_tag t;
+    for (; rd.read_tag(start, &t) == 0; start = t.next()){
+      if ((t.type == flv::tag_type::audio || t.type == flv::tag_type::video) && t.timestamp >= begin)
+        break;
+    }
+    base = t.timestamp;
+  }
+  auto last_listed = last > first ? index.positions[last - 1] : start;
+
+  // onMetaData keeps the source entries and gets a rebased keyframes object
+  flv_meta meta = rd.meta;
+  meta.has_video = (rd.header.has_video || rd.avc_tag.type != flv::tag_type::eof) ? 1 : 0;
+  meta.has_audio = (rd.header.has_audio || rd.aac_tag.type != flv::tag_type::eof) ? 1 : 0;
+  meta.can_seek_to_end = 0;
+  meta.keyframes = ::keyframes();
+  for (auto i = first; i < last; ++i)
+    meta.keyframes.push_keyframe(keyframe{ index.positions[i], index.times[i] - uint64_t(base) * 10000 });
+  meta.last_keyframe_timestamp = meta.keyframes.empty() ? 0 : static_cast<uint32_t>(meta.keyframes.times.back() / 10000);
+
+  ::packet original;
+  if (rd.script_tag.type == flv::tag_type::script_data && rd.read_data(rd.script_tag, &original) != 0)
+    return -1;
+  auto writer = flv::amf_writer();
+  if (flv::on_meta_data_encoder().patch(writer, original._, original.length, meta) != 0)
+    return -1;
+  auto meta_length = static_cast<uint32_t>(writer.data.size());
+  uint64_t data_start = flv_file_header_length + flv_previous_tag_size_field_length
+    + flv_tag_header_length + meta_length + flv_previous_tag_size_field_length;
+  if (rd.avc_tag.type != flv::tag_type::eof)
+    data_start += flv_tag_header_length + rd.avc_sequence_header.length + flv_previous_tag_size_field_length;
+  if (rd.aac_tag.type != flv::tag_type::eof)
+    data_start += flv_tag_header_length + rd.aac_sequence_header.length + flv_previous_tag_size_field_length;
+  for (auto&pos : meta.keyframes.positions)
+    pos = pos - start + data_start;
+
+  // file header, onMetaData written again at the end, sequence headers
+  uint64_t out_pos = 0, meta_pos = 0;
+  {
+    flv::muxer mux(&out);
+    mux.header(meta.has_audio != 0, meta.has_video != 0);
+    meta_pos = mux.position();
+    mux.tag(flv::tag_type::script_data, 0, writer.data.data(), meta_length);
+    if (rd.avc_tag.type != flv::tag_type::eof)
+      mux.tag(flv::tag_type::video, 0, rd.avc_sequence_header._, rd.avc_sequence_header.length);
+    if (rd.aac_tag.type != flv::tag_type::eof)
+      mux.tag(flv::tag_type::audio, 0, rd.aac_sequence_header._, rd.aac_sequence_header.length);
+    if (mux.flush() != 0)
+      return -1;
+    out_pos = mux.position();
+  }
+
+  // walks tag headers in the block and patches their timestamps in place,
+  // payloads beyond the block are copied without being read
+  flv::block_copy w(in, out, start, out_pos);
+  if (w.fill(start) != 0)
+    return -1;
+  uint32_t tags = 0, duration = 0;
+  auto pos = start;
+  for (;;){
+    if (!w.holds(pos, raw_tag_peek_length)){
+      if (w.flush(pos) != 0 || w.fill(pos) != 0)
+        return -1;
+      if (w.block_len < flv_tag_header_length)
+        break;
+    }
+    raw_tag t;
+    decode_raw_tag(w.at(pos), w.available(pos), pos, &t);
+    if (t.data_offset() + t.data_size > rd.file_size)
+      break;  // incomplete tag at the end of a recording
+    if (t.timestamp >= end && pos > last_listed)
+      break;
+    auto ts = t.timestamp > base ? t.timestamp - base : 0;
+    patch_timestamp(w.at(pos), ts);
+    if (t.type == flv::tag_type::audio || t.type == flv::tag_type::video)
+      duration = std::max(duration, ts);
+    ++tags;
+    pos = std::min(t.next(), rd.file_size);
+  }
+  if (w.flush(pos) != 0)
+    return -1;
+
+  meta.last_timestamp = duration;
+  meta.filesize = w.out_pos;
+  writer.data.clear();
+  flv::on_meta_data_encoder().patch(writer, original._, original.length, meta);
+  if (writer.data.size() != meta_length || out.write(meta_pos + flv_tag_header_length, writer.data.data(), meta_length) != meta_length)
+    return -1;
+  if (r){
+    r->begin = base;
+    r->duration = duration;
+    r->tags = tags;
+    r->file_size = w.out_pos;
+  }
+  return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include "file_io.hpp"
+
+namespace flv{
+struct trim_result{
+  uint32_t begin     = 0;  // milliseconds, source time of the keyframe the clip starts at
+  uint32_t duration  = 0;  // milliseconds, last timestamp of the clip
+  uint32_t tags      = 0;  // tags copied from the source
+  uint64_t file_size = 0;  // bytes written
+};
+
+// cuts [begin, end) out of a flv file without touching payloads
+// the clip starts at the keyframe at or before begin and keeps every tag up to end,
+// tag bytes are copied as they are and only timestamps are rebased.
+// sequence headers are written again in front of the clip, onMetaData is replaced
+struct trimmer{
+  uint32_t begin = 0;           // milliseconds
+  uint32_t end   = UINT32_MAX;  // milliseconds, exclusive
+
+  int32_t trim(file&in, file&out, trim_result*r);        // 0: ok, -1: error
+  int32_t trim(char const*in, char const*out, trim_result*r);
+};
+}
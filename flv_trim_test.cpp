@@ -0,0 +1,86 @@
+#include "flv_trim.hpp"
+#include <cstring>
+#include <string>
+#include <vector>
+#include "flv_reader.hpp"
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+// ten seconds, a keyframe every second
+std::string sample_file(){
+  auto path = flv::test::temp_path("trim.flv");
+  flv::synth_options o;
+  o.duration_ms = 10000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  flv::synth_result r;
+  if (flv::synthesize(path.c_str(), o, &r) != 0)
+    flv::test::fail(__FILE__, __LINE__, "sample file");
+  return path;
+}
+
+bool same_data(flv::reader&a, flv::raw_tag const&x, flv::reader&b, flv::raw_tag const&y){
+  packet u, v;
+  return a.read_data(x, &u) == 0 && b.read_data(y, &v) == 0 && u.length == v.length && memcmp(u._, v._, u.length) == 0;
+}
+}
+
+FLV_TEST(trim_starts_at_the_keyframe_before_the_in_point){
+  auto path = sample_file();
+  auto clip = flv::test::temp_path("trim_clip.flv");
+  flv::trimmer trim;
+  trim.begin = 2500;
+  trim.end = 6000;
+  flv::trim_result r;
+  FLV_CHECK(trim.trim(path.c_str(), clip.c_str(), &r) == 0);
+  FLV_CHECK(r.begin == 2000);
+
+  flv::file src_file, out_file;
+  FLV_CHECK(src_file.open(path.c_str()) == 0 && out_file.open(clip.c_str()) == 0);
+  auto src = flv::reader(&src_file);
+  auto out = flv::reader(&out_file);
+  FLV_CHECK(src.open() == 0 && out.open() == 0);
+  FLV_CHECK(out.file_size == r.file_size && out.has_meta);
+
+  // sequence headers in front of the clip
+  FLV_CHECK(out.avc_tag.type == flv::tag_type::video && out.avc_tag.timestamp == 0);
+  FLV_CHECK(out.aac_tag.type == flv::tag_type::audio && out.aac_tag.timestamp == 0);
+  FLV_CHECK(out.avc_sequence_header.length == src.avc_sequence_header.length);
+  FLV_CHECK(memcmp(out.avc_sequence_header._, src.avc_sequence_header._, src.avc_sequence_header.length) == 0);
+
+  // the tags of the source from the keyframe at 2000 on, 2000 earlier and with the same bytes
+  auto k = src.meta.keyframes.seek(2500 * 10000ull);
+  FLV_CHECK(k.time == 2000 * 10000ull);
+  flv::raw_tag s, t;
+  auto s_pos = k.position;
+  auto t_pos = out.first_media_tag;
+  uint32_t tags = 0, last = 0;
+  for (; out.read_tag(t_pos, &t) == 0; t_pos = t.next()){
+    if (t.sequence_header())
+      continue;
+    FLV_CHECK(src.read_tag(s_pos, &s) == 0);
+    if (!tags)
+      FLV_CHECK(t.keyframe() && t.timestamp == 0);
+    FLV_CHECK(t.type == s.type && t.data_size == s.data_size && t.timestamp + 2000 == s.timestamp);
+    FLV_CHECK(same_data(src, s, out, t));
+    last = t.timestamp;
+    ++tags;
+    s_pos = s.next();
+  }
+  FLV_CHECK(tags == r.tags && last == r.duration && last < 4000 && last >= 3900);
+  FLV_CHECK(out.meta.last_timestamp == r.duration);
+
+  // keyframes of the clip point at its keyframe tags
+  auto&index = out.meta.keyframes;
+  FLV_CHECK(index.positions.size() == 4 && index.times.size() == 4);
+  for (size_t i = 0; i < index.positions.size(); ++i){
+    FLV_CHECK(out.read_tag(index.positions[i], &t) == 0);
+    FLV_CHECK(t.keyframe() && uint64_t(t.timestamp) * 10000 == index.times[i] && t.timestamp == i * 1000);
+  }
+  src_file.close();
+  out_file.close();
+  flv::test::remove_file(clip);
+  flv::test::remove_file(path);
+}
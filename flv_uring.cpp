@@ -0,0 +1,243 @@
+#include "flv_uring.hpp"
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+// the rings as mapped from the kernel, no liburing
+struct flv::uring_source::ring{
+  int           fd       = -1;
+  void         *sq_map   = MAP_FAILED;
+  size_t        sq_size  = 0;
+  void         *cq_map   = MAP_FAILED;  // sq_map if the kernel maps both rings at once
+  size_t        cq_size  = 0;
+  io_uring_sqe *sqes     = nullptr;
+  size_t        sqes_size = 0;
+  unsigned     *sq_head  = nullptr;
+  unsigned     *sq_tail  = nullptr;
+  unsigned     *sq_mask  = nullptr;
+  unsigned     *sq_array = nullptr;
+  unsigned      sq_entries = 0;
+  unsigned     *cq_head  = nullptr;
+  unsigned     *cq_tail  = nullptr;
+  unsigned     *cq_mask  = nullptr;
+  io_uring_cqe *cqes     = nullptr;
+  unsigned      cq_entries = 0;
+
+  ~ring(){
+    if (sqes)
+      munmap(sqes, sqes_size);
+    if (cq_map != MAP_FAILED && cq_map != sq_map)
+      munmap(cq_map, cq_size);
+    if (sq_map != MAP_FAILED)
+      munmap(sq_map, sq_size);
+    if (fd >= 0)
+      ::close(fd);
+  }
+  int32_t setup(uint32_t entries){
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+    if (fd < 0)
+      return -1;
+    sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    auto single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single)
+      sq_size = cq_size = std::max(sq_size, cq_size);
+    sq_map = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_map == MAP_FAILED)
+      return -1;
+    cq_map = single ? sq_map : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (cq_map == MAP_FAILED)
+      return -1;
+    sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    auto e = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (e == MAP_FAILED)
+      return -1;
+    sqes = static_cast<io_uring_sqe*>(e);
+    auto sq = static_cast<uint8_t*>(sq_map);
+    auto cq = static_cast<uint8_t*>(cq_map);
+    sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    sq_entries = p.sq_entries;
+    cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    cq_entries = p.cq_entries;
+    return 0;
+  }
+};
+
+flv::uring_source::~uring_source(){
+  close();
+}
+
+int32_t flv::uring_source::open(char const*path, uint32_t depth){
+  close();
+  fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  rg = new ring;
+  if (rg->setup(std::max<uint32_t>(depth, 1)) != 0){
+    close();
+    return -1;
+  }
+  queue_depth = rg->sq_entries;
+  return 0;
+}
+
+void flv::uring_source::close(){
+  delete rg;  // unregisters the pool with the ring
+  rg = nullptr;
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+  queued = in_flight = 0;
+  pool.clear();
+  pool_length = 0;
+}
+
+int32_t flv::uring_source::register_pool(uint32_t count, uint32_t length){
+  if (!rg || in_flight)
+    return -1;
+  if (pool_length)
+    syscall(__NR_io_uring_register, rg->fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+  pool.assign(size_t(count) * length, 0);
+  pool_length = length;
+  std::vector<iovec> v(count);
+  for (uint32_t i = 0; i < count; ++i)
+    v[i] = iovec{ pool_buffer(i), length };
+  if (syscall(__NR_io_uring_register, rg->fd, IORING_REGISTER_BUFFERS, v.data(), count) < 0){
+    pool.clear();
+    pool_length = 0;
+    return -1;
+  }
+  return 0;
+}
+
+void flv::uring_source::prepare(uring_read*r, uint8_t flags){
+  auto tail = *rg->sq_tail;
+  auto index = tail & *rg->sq_mask;
+  auto&e = rg->sqes[index];
+  memset(&e, 0, sizeof(e));
+  e.opcode = r->buffer >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+  e.flags = flags;
+  e.fd = fd;
+  e.off = r->pos;
+  e.addr = reinterpret_cast<uint64_t>(r->data);
+  e.len = r->length;
+  e.buf_index = static_cast<uint16_t>(r->buffer >= 0 ? r->buffer : 0);
+  e.user_data = reinterpret_cast<uint64_t>(r);
+  rg->sq_array[index] = index;
+  __atomic_store_n(rg->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  r->finished = false;
+  r->result = 0;
+  ++queued;
+  ++in_flight;
+}
+
+int32_t flv::uring_source::submit(uring_read*r){
+  if (!rg)
+    return -1;
+  auto used = *rg->sq_tail - __atomic_load_n(rg->sq_head, __ATOMIC_ACQUIRE);
+  if (used + 1 > rg->sq_entries || in_flight + 1 > rg->cq_entries)
+    return -1;
+  prepare(r, 0);
+  return 0;
+}
+
+int32_t flv::uring_source::submit_linked(uring_read*header, uring_read*payload){
+  if (!rg)
+    return -1;
+  auto used = *rg->sq_tail - __atomic_load_n(rg->sq_head, __ATOMIC_ACQUIRE);
+  if (used + 2 > rg->sq_entries || in_flight + 2 > rg->cq_entries)
+    return -1;
+  prepare(header, IOSQE_IO_LINK);
+  prepare(payload, 0);
+  return 0;
+}
+
+int32_t flv::uring_source::complete(uint32_t wait_for){
+  if (!rg)
+    return -1;
+  wait_for = std::min(wait_for, in_flight);
+  uint32_t n = 0;
+  for (;;){
+    if (queued || n < wait_for){
+      auto min_complete = n < wait_for ? 1u : 0u;
+      auto rc = syscall(__NR_io_uring_enter, rg->fd, queued, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+      if (rc < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        return -1;
+      ++enters;
+      if (rc > 0)
+        queued -= std::min(queued, static_cast<uint32_t>(rc));
+    }
+    auto head = *rg->cq_head;
+    while (head != __atomic_load_n(rg->cq_tail, __ATOMIC_ACQUIRE)){
+      auto&c = rg->cqes[head & *rg->cq_mask];
+      auto r = reinterpret_cast<uring_read*>(c.user_data);
+      r->result = c.res < 0 ? -1 : int64_t(c.res);
+      __atomic_store_n(rg->cq_head, ++head, __ATOMIC_RELEASE);
+      r->finished = true;
+      --in_flight;
+      ++n;
+      if (r->done)
+        r->done(r);  // may submit more reads
+      head = *rg->cq_head;
+    }
+    if (n >= wait_for && !queued)
+      return static_cast<int32_t>(n);
+  }
+}
+
+int64_t flv::uring_source::read(uint64_t pos, void*data, uint32_t length){
+  uring_read r;
+  r.pos = pos;
+  r.data = data;
+  r.length = length;
+  while (submit(&r) != 0){
+    if (!rg || complete(1) < 0)
+      return -1;
+  }
+  while (!r.finished){
+    if (complete(1) < 0)
+      return -1;
+  }
+  return r.result;
+}
+
+int32_t flv::uring_source::size(uint64_t*v){
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0)
+    return -1;
+  *v = static_cast<uint64_t>(st.st_size);
+  return 0;
+}
+
+#else
+
+struct flv::uring_source::ring{};
+
+flv::uring_source::~uring_source(){}
+int32_t  flv::uring_source::open(char const*, uint32_t){ return -1; }
+void     flv::uring_source::close(){}
+int32_t  flv::uring_source::register_pool(uint32_t, uint32_t){ return -1; }
+void     flv::uring_source::prepare(uring_read*, uint8_t){}
+int32_t  flv::uring_source::submit(uring_read*){ return -1; }
+int32_t  flv::uring_source::submit_linked(uring_read*, uring_read*){ return -1; }
+int32_t  flv::uring_source::complete(uint32_t){ return -1; }
+int64_t  flv::uring_source::read(uint64_t, void*, uint32_t){ return -1; }
+int32_t  flv::uring_source::size(uint64_t*){ return -1; }
+
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "byte_source.hpp"
+
+namespace flv{
+// one read submitted to a uring_source
+struct uring_read{
+  uint64_t pos      = 0;
+  void    *data     = nullptr;
+  uint32_t length   = 0;
+  int32_t  buffer   = -1;       // index of the registered pool buffer data lies in, -1 for any memory
+  int64_t  result   = 0;        // bytes read or -1, valid once finished
+  bool     finished = false;
+  void   (*done)(uring_read*) = nullptr;  // called by complete() on the thread calling it
+  void    *user     = nullptr;
+};
+
+// file reads through io_uring on linux, open fails elsewhere and on kernels without it.
+// submissions are batched until complete() enters the kernel once for all of them and reaps what finished,
+// so one thread drives many demuxers without a thread per read. reads into the registered pool
+// use fixed buffers, the kernel does not map their pages per read
+struct uring_source : public byte_source{
+  uring_source() = default;
+  uring_source(uring_source const&) = delete;
+  uring_source&operator=(uring_source const&) = delete;
+  ~uring_source();
+
+  int32_t  open(char const*path, uint32_t queue_depth = 64);  // 0: ok, -1: error
+  void     close();
+  // allocates count buffers of length bytes and registers them, pool_buffer(i) is buffer i
+  int32_t  register_pool(uint32_t count, uint32_t length);
+  uint8_t *pool_buffer(uint32_t i){ return pool.data() + size_t(i) * pool_length; }
+
+  // 0: queued, -1: the queue is full, call complete first. r must stay alive until it finished
+  int32_t  submit(uring_read*r);
+  // the payload read starts once the header read finished with all its bytes, otherwise it fails with -1
+  int32_t  submit_linked(uring_read*header, uring_read*payload);
+  // submits what is queued and waits for at least wait_for reads to finish.
+  // returns the number of reads finished, -1 on error
+  int32_t  complete(uint32_t wait_for = 0);
+
+  int64_t  read(uint64_t pos, void*data, uint32_t length) override;  // submits and waits for this read
+  int32_t  size(uint64_t*v) override;
+
+  uint32_t queue_depth = 0;
+  uint32_t in_flight   = 0;   // submitted or queued, not finished
+  uint64_t enters      = 0;   // io_uring_enter calls
+
+private:
+  struct ring;
+  void    prepare(uring_read*r, uint8_t flags);
+
+  ring                *rg      = nullptr;
+  int                  fd      = -1;
+  uint32_t             queued  = 0;   // entries filled since the last enter
+  std::vector<uint8_t> pool;
+  uint32_t             pool_length = 0;
+};
+}
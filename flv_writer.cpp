@@ -0,0 +1,102 @@
+#include "flv_writer.hpp"
+#include <cstring>
+#include "bigendian.hpp"
+#include "amf.hpp"
+#include "flv_reader.hpp"
+
+const static uint32_t head_slot_length = flv::muxer_head_length + flv::flv_previous_tag_size_field_length;
+const static uint8_t  aac_sound_header = uint8_t(uint8_t(flv::audio_codec::aac) << 4 | 0x0f);  // 44k, 16 bits, stereo as the spec asks for aac
+
+flv::muxer::muxer(file*o, uint64_t p) : out(o), written(p), pos(p), heads(muxer_batch_tags * head_slot_length){
+  slices.reserve(muxer_batch_tags * 3);
+  owned.reserve(muxer_batch_tags);  // queued slices point into owned packets, it must not reallocate
+}
+
+flv::muxer::~muxer(){
+  flush();
+}
+
+int32_t flv::muxer::header(bool has_audio, bool has_video){
+  if (failed)
+    return -1;
+  auto slot = heads.data() + queued * head_slot_length;
+  bigendian::binary_writer writer(slot, head_slot_length);
+  writer.byte('F');
+  writer.byte('L');
+  writer.byte('V');
+  writer.byte(1);  // version
+  writer.byte(uint8_t((has_audio ? flv_file_header_audio_mask : 0) | (has_video ? flv_file_header_video_mask : 0)));
+  writer.ui32(flv_file_header_length);  // data offset
+  writer.ui32(0);                       // PreviousTagSize0
+  slices.push_back(io_slice{ slot, writer.pointer });
+  pos += writer.pointer;
+  return ++queued == muxer_batch_tags ? flush() : 0;
+}
+
+int32_t flv::muxer::tag(flv::tag_type type, uint32_t ms, uint8_t const*head, uint32_t head_length, uint8_t const*data, uint32_t length){
+  if (failed || head_length > muxer_head_length - flv_tag_header_length)
+    return -1;
+  auto slot = heads.data() + queued * head_slot_length;
+  auto data_size = head_length + length;
+  encode_tag_header(slot, type, data_size, ms);
+  if (head_length)
+    memcpy(slot + flv_tag_header_length, head, head_length);
+  auto previous_tag_size = slot + muxer_head_length;
+  bigendian::binary_writer(previous_tag_size, flv_previous_tag_size_field_length).ui32(flv_tag_header_length + data_size);
+  slices.push_back(io_slice{ slot, flv_tag_header_length + head_length });
+  if (length)
+    slices.push_back(io_slice{ data, length });
+  slices.push_back(io_slice{ previous_tag_size, flv_previous_tag_size_field_length });
+  pos += flv_tag_header_length + data_size + flv_previous_tag_size_field_length;
+  return ++queued == muxer_batch_tags ? flush() : 0;
+}
+
+int32_t flv::muxer::tag(flv::tag_type type, uint32_t ms, uint8_t const*data, uint32_t length){
+  return tag(type, ms, nullptr, 0, data, length);
+}
+
+int32_t flv::muxer::meta(flv_meta const&v){
+  auto writer = flv::amf_writer();
+  flv::on_meta_data_encoder().encode(writer, v);
+  owned.emplace_back(writer.data.data(), static_cast<uint32_t>(writer.data.size()));
+  return tag(flv::tag_type::script_data, 0, owned.back()._, owned.back().length);
+}
+
+int32_t flv::muxer::avc(uint32_t dts, int32_t composition_time, bool keyframe, uint8_t const*nalus, uint32_t length){
+  uint8_t head[flv_video_header_length + flv_avc_packet_type_length];
+  bigendian::binary_writer writer(head, sizeof(head));
+  writer.byte(uint8_t(uint8_t(keyframe ? flv::frame_type::key_frame : flv::frame_type::inter_frame) << 4 | uint8_t(flv::video_codec::avc)));
+  writer.byte(uint8_t(flv::avc_packet_type::avc_nalu));
+  writer.ui24(static_cast<uint32_t>(composition_time) & 0xffffff);  // si24
+  return tag(flv::tag_type::video, dts, head, sizeof(head), nalus, length);
+}
+
+int32_t flv::muxer::aac(uint32_t ms, uint8_t const*frame, uint32_t length){
+  uint8_t head[flv_audio_header_length + flv_aac_packet_type_length] = { aac_sound_header, uint8_t(flv::aac_packet_type::aac_raw) };
+  return tag(flv::tag_type::audio, ms, head, sizeof(head), frame, length);
+}
+
+int32_t flv::muxer::avc_sequence_header(flv::avcc const&v, uint32_t ms){
+  uint8_t head[flv_video_header_length + flv_avc_packet_type_length] = {
+    uint8_t(uint8_t(flv::frame_type::key_frame) << 4 | uint8_t(flv::video_codec::avc)), uint8_t(flv::avc_packet_type::avc_sequence_header), 0, 0, 0 };
+  owned.push_back(v.decoder_configuration_record());
+  return tag(flv::tag_type::video, ms, head, sizeof(head), owned.back()._, owned.back().length);
+}
+
+int32_t flv::muxer::aac_sequence_header(flv::audio_specific_config const&v, uint32_t ms){
+  uint8_t head[flv_audio_header_length + flv_aac_packet_type_length] = { aac_sound_header, uint8_t(flv::aac_packet_type::aac_sequence_header) };
+  owned.push_back(v.encode());
+  return tag(flv::tag_type::audio, ms, head, sizeof(head), owned.back()._, owned.back().length);
+}
+
+int32_t flv::muxer::flush(){
+  if (failed || !queued)
+    return failed;
+  auto cb = out->write(written, slices.data(), static_cast<uint32_t>(slices.size()));
+  failed = cb == static_cast<int64_t>(pos - written) ? 0 : -1;
+  written = pos;
+  queued = 0;
+  slices.clear();
+  owned.clear();
+  return failed;
+}
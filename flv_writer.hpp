@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "flv.hpp"
+#include "flv_meta.hpp"
+#include "packet.hpp"
+#include "avcc.hpp"
+#include "aac.hpp"
+#include "file_io.hpp"
+
+namespace flv{
+const static uint32_t muxer_batch_tags   = 64;  // tags queued before a vectored write
+const static uint32_t muxer_head_length  = flv_tag_header_length + flv_audio_header_length + flv_avc_packet_type_length;  // tag header and codec bytes
+
+// writes a flv file tag by tag, PreviousTagSize follows every tag.
+// tags are queued and written with one vectored write per batch,
+// data passed in is not copied and must stay valid until flush or the batch is written
+struct muxer{
+  explicit muxer(file*out, uint64_t pos = 0);
+  muxer(muxer const&) = delete;
+  muxer&operator=(muxer const&) = delete;
+  ~muxer();  // flushes, errors are lost, call flush to see them
+
+  int32_t  header(bool has_audio, bool has_video);  // 9 bytes file header and PreviousTagSize0
+  int32_t  meta(flv_meta const&v);                  // onMetaData script data tag, timestamp 0
+  // data is the whole tag data, codec bytes included
+  int32_t  tag(flv::tag_type type, uint32_t ms, uint8_t const*data, uint32_t length);
+  // avc nalu packet, nalus are length prefixed as the avcC of the stream says
+  int32_t  avc(uint32_t dts, int32_t composition_time, bool keyframe, uint8_t const*nalus, uint32_t length);
+  // raw aac frame
+  int32_t  aac(uint32_t ms, uint8_t const*frame, uint32_t length);
+  int32_t  avc_sequence_header(flv::avcc const&v, uint32_t ms = 0);
+  int32_t  aac_sequence_header(flv::audio_specific_config const&v, uint32_t ms = 0);
+  int32_t  flush();                                 // 0: ok, -1: write failed
+  uint64_t position()const{ return pos; }          // file position after the queued tags
+
+  // tag header and codec bytes, head is copied, data is queued as it is
+  int32_t  tag(flv::tag_type type, uint32_t ms, uint8_t const*head, uint32_t head_length, uint8_t const*data, uint32_t length);
+
+  file                 *out;
+  uint64_t              written;  // file position of the first queued byte
+  uint64_t              pos;
+  uint32_t              queued  = 0;
+  int32_t               failed  = 0;
+  std::vector<uint8_t>  heads;    // per queued tag: tag header, codec bytes and PreviousTagSize
+  std::vector<io_slice> slices;
+  std::vector<packet>   owned;    // encoded metadata and sequence headers of queued tags
+};
+}
@@ -0,0 +1,101 @@
+#include "flv_writer.hpp"
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bigendian.hpp"
+#include "flv_reader.hpp"
+#include "test.hpp"
+
+namespace{
+const static uint32_t frames = 150;  // more tags than one batch
+
+std::vector<uint8_t> payload(uint32_t i, uint32_t length){
+  std::vector<uint8_t> v(length);
+  for (uint32_t k = 0; k < length; ++k)
+    v[k] = uint8_t(i * 31 + k);
+  return v;
+}
+}
+
+// everything the muxer writes is read back by flv::reader, PreviousTagSize included
+FLV_TEST(muxer_output_reads_back){
+  auto path = flv::test::temp_path("muxer.flv");
+  flv::avcc config;
+  config.profile = 0x42;
+  config.level = 0x1e;
+  config.nal = 3;
+  uint8_t const sps[] = { 0x67, 0x42, 0x00, 0x1e, 0x95, 0xa0, 0x50, 0x7e };
+  uint8_t const pps[] = { 0x68, 0xce, 0x3c, 0x80 };
+  config.sps.push_back(packet(sps, sizeof(sps)));
+  config.pps.push_back(packet(pps, sizeof(pps)));
+  flv::audio_specific_config asc;
+
+  flv_meta meta;
+  meta.has_video = meta.has_audio = 1;
+  meta.width = 320;
+  meta.height = 240;
+  meta.framerate = 25;
+
+  // payloads stay valid until the muxer is flushed
+  std::vector<std::vector<uint8_t>> audio, video;
+  for (uint32_t i = 0; i < frames; ++i){
+    audio.push_back(payload(i, 200 + i % 7));
+    video.push_back(payload(i + 1000, i % 25 ? 500 + i : 4000));
+  }
+  uint64_t end = 0;
+  {
+    flv::file f;
+    FLV_CHECK(f.create(path.c_str()) == 0);
+    flv::muxer mux(&f);
+    FLV_CHECK(mux.header(true, true) == 0 && mux.meta(meta) == 0);
+    FLV_CHECK(mux.avc_sequence_header(config) == 0 && mux.aac_sequence_header(asc) == 0);
+    for (uint32_t i = 0; i < frames; ++i){
+      FLV_CHECK(mux.aac(i * 40, audio[i].data(), static_cast<uint32_t>(audio[i].size())) == 0);
+      FLV_CHECK(mux.avc(i * 40, i % 25 ? 80 : 0, i % 25 == 0, video[i].data(), static_cast<uint32_t>(video[i].size())) == 0);
+    }
+    FLV_CHECK(mux.flush() == 0);
+    end = mux.position();
+  }
+
+  flv::file f;
+  FLV_CHECK(f.open(path.c_str()) == 0);
+  auto rd = flv::reader(&f);
+  FLV_CHECK(rd.open() == 0);
+  FLV_CHECK(rd.file_size == end && rd.header.has_audio && rd.header.has_video);
+  FLV_CHECK(rd.has_meta && rd.meta.width == 320 && rd.meta.height == 240 && rd.meta.framerate == 25);
+  auto record = config.decoder_configuration_record();
+  FLV_CHECK(rd.avc_tag.type == flv::tag_type::video && rd.avc_sequence_header.length == 5 + record.length);
+  FLV_CHECK(memcmp(rd.avc_sequence_header._ + 5, record._, record.length) == 0);
+  auto encoded = asc.encode();
+  FLV_CHECK(rd.aac_tag.type == flv::tag_type::audio && rd.aac_sequence_header.length == 2 + encoded.length);
+  FLV_CHECK(memcmp(rd.aac_sequence_header._ + 2, encoded._, encoded.length) == 0);
+  FLV_CHECK(rd.last_timestamp == (frames - 1) * 40);
+
+  uint32_t a = 0, v = 0;
+  bool previous_sizes = true, payloads = true;
+  flv::raw_tag t;
+  int32_t cts = 0;
+  auto pos = rd.first_tag;
+  for (; rd.read_tag(pos, &t, &cts) == 0; pos = t.next()){
+    uint8_t size[4];
+    previous_sizes = previous_sizes && f.read(t.next() - 4, size, 4) == 4 && bigendian::touint32(size) == t.data_size + 11;
+    if (t.sequence_header() || t.type == flv::tag_type::script_data)
+      continue;
+    packet data;
+    FLV_CHECK(rd.read_data(t, &data) == 0);
+    if (t.type == flv::tag_type::audio && a < frames){
+      FLV_CHECK(t.is_aac() && t.timestamp == a * 40);
+      payloads = payloads && data.length == 2 + audio[a].size() && memcmp(data._ + 2, audio[a].data(), audio[a].size()) == 0;
+      ++a;
+    }
+    else if (t.type == flv::tag_type::video && v < frames){
+      FLV_CHECK(t.is_avc() && t.timestamp == v * 40 && t.keyframe() == (v % 25 == 0) && cts == (v % 25 ? 80 : 0));
+      payloads = payloads && data.length == 5 + video[v].size() && memcmp(data._ + 5, video[v].data(), video[v].size()) == 0;
+      ++v;
+    }
+  }
+  FLV_CHECK(pos == end && a == frames && v == frames);
+  FLV_CHECK(previous_sizes && payloads);
+  f.close();
+  flv::test::remove_file(path);
+}
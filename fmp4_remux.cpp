@@ -0,0 +1,398 @@
+#include "fmp4_remux.hpp"
+#include <algorithm>
+
+const static uint32_t movie_timescale = 1000;  // flv timestamps are milliseconds
+const static uint32_t aac_frame_samples = 1024;
+const static uint32_t trun_data_offset = 0x000001;
+const static uint32_t trun_duration = 0x000100;
+const static uint32_t trun_size = 0x000200;
+const static uint32_t trun_flags = 0x000400;
+const static uint32_t trun_composition_offset = 0x000800;
+const static uint32_t tfhd_default_base_is_moof = 0x020000;
+const static uint32_t sample_sync = 0x02000000;        // sample_depends_on 2
+const static uint32_t sample_non_sync = 0x01010000;    // sample_depends_on 1, sample_is_non_sync_sample
+
+namespace{
+void matrix(flv::box_writer&w){
+  const uint32_t unity[9] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+  for (auto x : unity)
+    w.ui32(x);
+}
+
+void mvhd(flv::box_writer&w, uint32_t next_track){
+  auto at = w.begin_full("mvhd", 0, 0);
+  w.ui32(0);  // creation_time
+  w.ui32(0);  // modification_time
+  w.ui32(movie_timescale);
+  w.ui32(0);  // duration, fragments carry the samples
+  w.ui32(0x00010000);  // rate
+  w.ui16(0x0100);      // volume
+  w.zeros(10);
+  matrix(w);
+  w.zeros(24);  // pre_defined
+  w.ui32(next_track);
+  w.end(at);
+}
+
+void tkhd(flv::box_writer&w, uint32_t track, bool audio, uint32_t width, uint32_t height){
+  auto at = w.begin_full("tkhd", 0, 3);  // enabled, in movie
+  w.ui32(0);
+  w.ui32(0);
+  w.ui32(track);
+  w.ui32(0);  // reserved
+  w.ui32(0);  // duration
+  w.zeros(8);
+  w.ui16(0);  // layer
+  w.ui16(0);  // alternate_group
+  w.ui16(audio ? 0x0100 : 0);
+  w.ui16(0);
+  matrix(w);
+  w.ui32(width << 16);
+  w.ui32(height << 16);
+  w.end(at);
+}
+
+void mdhd_hdlr(flv::box_writer&w, uint32_t timescale, bool audio){
+  auto at = w.begin_full("mdhd", 0, 0);
+  w.ui32(0);
+  w.ui32(0);
+  w.ui32(timescale);
+  w.ui32(0);
+  w.ui16(0x55c4);  // und
+  w.ui16(0);
+  w.end(at);
+  at = w.begin_full("hdlr", 0, 0);
+  w.ui32(0);
+  w.fourcc(audio ? "soun" : "vide");
+  w.zeros(12);
+  char const*name = audio ? "SoundHandler" : "VideoHandler";
+  w.bytes(reinterpret_cast<uint8_t const*>(name), 13);  // null terminated
+  w.end(at);
+}
+
+void dinf(flv::box_writer&w){
+  auto at = w.begin("dinf");
+  auto dref = w.begin_full("dref", 0, 0);
+  w.ui32(1);
+  w.end(w.begin_full("url ", 0, 1));  // media in the same file
+  w.end(dref);
+  w.end(at);
+}
+
+// empty sample tables, samples are in fragments
+void sample_tables(flv::box_writer&w){
+  for (auto type : { "stts", "stsc", "stco" }){
+    auto at = w.begin_full(type, 0, 0);
+    w.ui32(0);
+    w.end(at);
+  }
+  auto at = w.begin_full("stsz", 0, 0);
+  w.ui32(0);
+  w.ui32(0);
+  w.end(at);
+}
+
+void avc1(flv::box_writer&w, flv::avcc const&v, uint32_t width, uint32_t height){
+  auto at = w.begin("avc1");
+  w.zeros(6);
+  w.ui16(1);  // data_reference_index
+  w.zeros(16);
+  w.ui16(static_cast<uint16_t>(width));
+  w.ui16(static_cast<uint16_t>(height));
+  w.ui32(0x00480000);  // 72 dpi
+  w.ui32(0x00480000);
+  w.ui32(0);
+  w.ui16(1);  // frame_count
+  w.zeros(32);  // compressorname
+  w.ui16(0x0018);
+  w.ui16(0xffff);
+  auto c = w.begin("avcC");
+  auto record = v.decoder_configuration_record();
+  w.bytes(record._, record.length);
+  w.end(c);
+  w.end(at);
+}
+
+void descriptor(flv::box_writer&w, uint8_t tag, uint32_t length){
+  w.ui8(tag);
+  w.ui8(uint8_t(length));  // every descriptor here is shorter than 128 bytes
+}
+
+void mp4a(flv::box_writer&w, flv::audio_specific_config const&v, packet const&config){
+  auto at = w.begin("mp4a");
+  w.zeros(6);
+  w.ui16(1);
+  w.zeros(8);
+  w.ui16(v.channels);
+  w.ui16(16);  // samplesize
+  w.ui32(0);
+  w.ui32((v.sampling_rate & 0xffff) << 16);
+  auto e = w.begin_full("esds", 0, 0);
+  auto specific = 2 + config.length;
+  auto decoder = 2 + 13 + specific;
+  descriptor(w, 3, 3 + decoder + 3);  // ES_Descriptor
+  w.ui16(0);  // ES_ID
+  w.ui8(0);
+  descriptor(w, 4, 13 + specific);    // DecoderConfigDescriptor
+  w.ui8(0x40);  // objectTypeIndication, iso 14496-3 audio
+  w.ui8(0x15);  // streamType audio, upstream 0, reserved 1
+  w.ui24(0);    // bufferSizeDB
+  w.ui32(0);    // maxBitrate
+  w.ui32(0);    // avgBitrate
+  descriptor(w, 5, config.length);    // DecSpecificInfo
+  w.bytes(config._, config.length);
+  descriptor(w, 6, 1);                // SLConfigDescriptor
+  w.ui8(2);
+  w.end(e);
+  w.end(at);
+}
+
+// the same for audio and video but the media header and the sample entry
+void trak(flv::box_writer&w, flv::fmp4_remuxer const&m, uint32_t track, bool audio, uint32_t timescale, packet const&config){
+  auto at = w.begin("trak");
+  tkhd(w, track, audio, audio ? 0 : m.width, audio ? 0 : m.height);
+  auto mdia = w.begin("mdia");
+  mdhd_hdlr(w, timescale, audio);
+  auto minf = w.begin("minf");
+  if (audio){
+    auto s = w.begin_full("smhd", 0, 0);
+    w.ui32(0);
+    w.end(s);
+  }
+  else{
+    auto v = w.begin_full("vmhd", 0, 1);
+    w.zeros(8);
+    w.end(v);
+  }
+  dinf(w);
+  auto stbl = w.begin("stbl");
+  auto stsd = w.begin_full("stsd", 0, 0);
+  w.ui32(1);
+  if (audio)
+    mp4a(w, m.asc, config);
+  else
+    avc1(w, m.avcc, m.width, m.height);
+  w.end(stsd);
+  sample_tables(w);
+  w.end(stbl);
+  w.end(minf);
+  w.end(mdia);
+  w.end(at);
+}
+
+void trex(flv::box_writer&w, uint32_t track){
+  auto at = w.begin_full("trex", 0, 0);
+  w.ui32(track);
+  w.ui32(1);  // default_sample_description_index
+  w.ui32(0);
+  w.ui32(0);
+  w.ui32(0);
+  w.end(at);
+}
+
+// traf with one trun, returns the offset of its data_offset field
+// video durations come from the next dts, the last one from the first dts of the next fragment
+size_t traf(flv::box_writer&w, uint32_t track, uint64_t base, std::vector<flv::fmp4_sample> const&v, bool audio, uint32_t last_duration){
+  auto at = w.begin("traf");
+  auto tfhd = w.begin_full("tfhd", 0, tfhd_default_base_is_moof);
+  w.ui32(track);
+  w.end(tfhd);
+  auto tfdt = w.begin_full("tfdt", 1, 0);
+  w.ui64(base);
+  w.end(tfdt);
+  auto flags = trun_data_offset | trun_duration | trun_size | (audio ? 0 : trun_flags | trun_composition_offset);
+  auto trun = w.begin_full("trun", audio ? 0 : 1, flags);  // version 1, signed composition offsets
+  w.ui32(static_cast<uint32_t>(v.size()));
+  auto data_offset = w.data.size();
+  w.ui32(0);
+  for (size_t i = 0; i < v.size(); ++i){
+    if (audio)
+      w.ui32(aac_frame_samples);
+    else
+      w.ui32(i + 1 < v.size() ? v[i + 1].dts - v[i].dts : last_duration);
+    w.ui32(v[i].size);
+    if (!audio){
+      w.ui32(v[i].key ? sample_sync : sample_non_sync);
+      w.ui32(static_cast<uint32_t>(v[i].cts));
+    }
+  }
+  w.end(trun);
+  w.end(at);
+  return data_offset;
+}
+}
+
+int32_t flv::fmp4_remuxer::open(){
+  if (rd.open() != 0)
+    return -1;
+  auto&avc = rd.avc_sequence_header;
+  auto&aac = rd.aac_sequence_header;
+  const uint32_t avc_head = flv_video_header_length + flv_avc_packet_type_length;
+  const uint32_t aac_head = flv_audio_header_length + flv_aac_packet_type_length;
+  if (rd.avc_tag.type != flv::tag_type::eof && avc.length > avc_head + 6){
+    avcc = flv::avcc_reader(avc._ + avc_head, avc.length - avc_head).avcc();
+    if (!avcc.sps.empty() && !avcc.pps.empty())
+      video_track = 1;
+    if (video_track && sps_dimensions(avcc.sps[0], &width, &height) != 0){
+      width = rd.meta.width;
+      height = rd.meta.height;
+    }
+  }
+  if (rd.aac_tag.type != flv::tag_type::eof && aac.length >= aac_head + 2
+    && flv::audio_specific_config_reader(aac._ + aac_head, aac.length - aac_head).audio_specific_config(&asc) == 0 && asc.sampling_rate)
+    audio_track = video_track + 1;
+  if (!video_track && !audio_track)
+    return -1;
+
+  // a fragment per gop, or per fragment_ms of audio
+  bounds.push_back(rd.first_media_tag);
+  raw_tag t;
+  if (video_track){
+    ::keyframes index = rd.meta.keyframes;
+    uint32_t last_timestamp;
+    if ((index.empty() || index.positions.size() != index.times.size()) && rd.build_index(&index, &last_timestamp) != 0)
+      return -1;
+    // sequence headers in front of the first keyframe do not make a fragment of their own
+    while (!index.empty() && bounds[0] < index.positions[0] && rd.read_tag(bounds[0], &t) == 0
+      && (t.sequence_header() || t.type == flv::tag_type::script_data))
+      bounds[0] = t.next();
+    // nor does audio written ahead of the first keyframe, it joins the first gop
+    times.push_back(rd.read_tag(bounds[0], &t) == 0 ? t.timestamp : 0);
+    for (size_t i = 1; i < index.positions.size(); ++i){
+      if (index.positions[i] > bounds.back() && index.positions[i] < rd.file_size){
+        bounds.push_back(index.positions[i]);
+        times.push_back(static_cast<uint32_t>(index.times[i] / 10000));
+      }
+    }
+  }
+  else{
+    uint32_t start = UINT32_MAX;
+    for (auto pos = rd.first_media_tag; rd.read_tag(pos, &t) == 0; pos = t.next()){
+      if (t.type != flv::tag_type::audio || t.sequence_header())
+        continue;
+      if (start == UINT32_MAX)
+        times.push_back(start = t.timestamp);
+      else if (t.timestamp >= start + fragment_ms){
+        bounds.push_back(pos);
+        times.push_back(start = t.timestamp);
+      }
+    }
+    if (times.empty())
+      times.push_back(0);
+  }
+  bounds.push_back(rd.file_size);
+
+  auto ftyp = init.begin("ftyp");
+  init.fourcc("iso5");
+  init.ui32(512);
+  for (auto brand : { "iso5", "iso6", "mp41" })
+    init.fourcc(brand);
+  init.end(ftyp);
+  auto moov = init.begin("moov");
+  mvhd(init, std::max(video_track, audio_track) + 1);
+  if (video_track)
+    trak(init, *this, video_track, false, movie_timescale, packet());
+  if (audio_track)
+    trak(init, *this, audio_track, true, asc.sampling_rate, asc.encode());
+  auto mvex = init.begin("mvex");
+  if (video_track)
+    trex(init, video_track);
+  if (audio_track)
+    trex(init, audio_track);
+  init.end(mvex);
+  init.end(moov);
+  return 0;
+}
+
+int32_t flv::fmp4_remuxer::fragment(size_t i, std::vector<io_slice>*v){
+  if (i + 1 >= bounds.size())
+    return -1;
+  auto from = bounds[i];
+  auto length = static_cast<uint32_t>(bounds[i + 1] - from);
+  if (gop.size() < length)
+    gop.resize(length);
+  auto cb = rd.source->read(from, gop.data(), length);
+  if (cb < 0)
+    return -1;
+  length = static_cast<uint32_t>(cb);
+
+  // samples are the tag data after the codec bytes
+  const uint32_t avc_head = flv_video_header_length + flv_avc_packet_type_length;
+  const uint32_t aac_head = flv_audio_header_length + flv_aac_packet_type_length;
+  video.clear();
+  audio.clear();
+  raw_tag t;
+  for (uint32_t p = 0; p + flv_tag_header_length <= length; p = static_cast<uint32_t>(t.next() - from)){
+    decode_raw_tag(gop.data() + p, length - p, from + p, &t);
+    if (p + flv_tag_header_length + uint64_t(t.data_size) > length)
+      break;
+    auto data = p + flv_tag_header_length;
+    if (video_track && t.is_avc() && t.codec[1] == uint8_t(flv::avc_packet_type::avc_nalu) && t.data_size > avc_head){
+      auto cts = int32_t(bigendian::touint24(gop.data() + data + 2) << 8) >> 8;  // si24
+      video.push_back(fmp4_sample{ data + avc_head, t.data_size - avc_head, t.timestamp, cts, t.keyframe() });
+    }
+    else if (audio_track && t.is_aac() && t.codec[1] == uint8_t(flv::aac_packet_type::aac_raw) && t.data_size > aac_head)
+      audio.push_back(fmp4_sample{ data + aac_head, t.data_size - aac_head, t.timestamp, 0, true });
+  }
+
+  // last video duration reaches the keyframe starting the next fragment, nothing past the fragment is read
+  uint32_t last_duration = video.size() > 1 ? video[video.size() - 1].dts - video[video.size() - 2].dts : 0;
+  if (!video.empty() && i + 2 < bounds.size() && times[i + 1] > video.back().dts)
+    last_duration = times[i + 1] - video.back().dts;
+
+  moof.data.clear();
+  auto at = moof.begin("moof");
+  auto mfhd = moof.begin_full("mfhd", 0, 0);
+  moof.ui32(static_cast<uint32_t>(i + 1));  // stable when fragments are asked for out of order
+  moof.end(mfhd);
+  size_t video_offset = 0, audio_offset = 0;
+  if (!video.empty())
+    video_offset = traf(moof, video_track, video.front().dts, video, false, last_duration);
+  if (!audio.empty())
+    audio_offset = traf(moof, audio_track, uint64_t(audio.front().dts) * asc.sampling_rate / 1000, audio, true, 0);
+  moof.end(at);
+  uint32_t mdat = 8;
+  for (auto&s : video)
+    mdat += s.size;
+  auto audio_start = mdat;
+  for (auto&s : audio)
+    mdat += s.size;
+  auto moof_size = static_cast<uint32_t>(moof.data.size());
+  if (!video.empty())
+    moof.patch_ui32(video_offset, moof_size + 8);
+  if (!audio.empty())
+    moof.patch_ui32(audio_offset, moof_size + audio_start);
+  moof.ui32(mdat);
+  moof.fourcc("mdat");
+
+  v->clear();
+  v->push_back(io_slice{ moof.data.data(), static_cast<uint32_t>(moof.data.size()) });
+  for (auto&s : video)
+    v->push_back(io_slice{ gop.data() + s.offset, s.size });
+  for (auto&s : audio)
+    v->push_back(io_slice{ gop.data() + s.offset, s.size });
+  return 0;
+}
+
+int32_t flv::fmp4_remuxer::remux(file&out, fmp4_result*r){
+  if (out.write(0, init.data.data(), static_cast<uint32_t>(init.data.size())) < 0)
+    return -1;
+  uint64_t pos = init.data.size();
+  uint32_t samples = 0;
+  std::vector<io_slice> slices;
+  for (size_t i = 0; i < fragment_count(); ++i){
+    if (fragment(i, &slices) != 0)
+      return -1;
+    auto cb = out.write(pos, slices.data(), static_cast<uint32_t>(slices.size()));
+    if (cb < 0)
+      return -1;
+    pos += static_cast<uint64_t>(cb);
+    samples += static_cast<uint32_t>(video.size() + audio.size());
+  }
+  if (r){
+    r->fragments = static_cast<uint32_t>(fragment_count());
+    r->samples = samples;
+    r->file_size = pos;
+  }
+  return 0;
+}
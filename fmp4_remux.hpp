@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "avcc.hpp"
+#include "aac.hpp"
+#include "mp4_box.hpp"
+#include "flv_reader.hpp"
+#include "file_io.hpp"
+
+namespace flv{
+struct fmp4_result{
+  uint32_t fragments = 0;
+  uint32_t samples   = 0;
+  uint64_t file_size = 0;  // bytes written
+};
+
+struct fmp4_sample{
+  uint32_t offset;  // in the gop buffer
+  uint32_t size;
+  uint32_t dts;     // milliseconds
+  int32_t  cts;     // composition time offset, milliseconds
+  bool     key;
+};
+
+// remuxes avc and aac of a flv file into fragmented mp4, ftyp/moov then one moof/mdat per gop.
+// a gop is read from the source in one piece and samples are handed out as slices into it,
+// avc nal units are length prefixed in both formats so nothing is rewritten
+struct fmp4_remuxer{
+  explicit fmp4_remuxer(byte_source*src) : rd(src){}
+  fmp4_remuxer(fmp4_remuxer const&) = delete;
+
+  uint32_t fragment_ms = 2000;  // fragment length of files without video
+
+  int32_t open();            // 0: ok, -1: not flv or neither avc nor aac
+  size_t  fragment_count()const{ return bounds.empty() ? 0 : bounds.size() - 1; }
+  // moof, mdat header and sample slices of fragment i, valid until the next call
+  int32_t fragment(size_t i, std::vector<io_slice>*v);
+  int32_t remux(file&out, fmp4_result*r);  // init segment and every fragment
+
+  flv::reader                rd;
+  flv::avcc                  avcc;
+  flv::audio_specific_config asc;
+  uint32_t                   video_track = 0;  // track id, 0 if video is not remuxed
+  uint32_t                   audio_track = 0;
+  uint32_t                   width       = 0;
+  uint32_t                   height      = 0;
+  std::vector<uint64_t>      bounds;           // fileposition each fragment starts at, end of data last
+  std::vector<uint32_t>      times;            // milliseconds, of the tag at each bound but the last
+  box_writer                 init;             // ftyp and moov
+
+  // reused from fragment to fragment
+  std::vector<uint8_t>       gop;
+  box_writer                 moof;             // moof and mdat header
+  std::vector<fmp4_sample>   video;
+  std::vector<fmp4_sample>   audio;
+};
+}
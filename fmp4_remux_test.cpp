@@ -0,0 +1,181 @@
+#include "fmp4_remux.hpp"
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bigendian.hpp"
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+struct box{
+  size_t      pos;   // of the size field
+  uint32_t    size;
+  std::string type;
+  size_t      body()const{ return pos + 8; }
+  size_t      end()const{ return pos + size; }
+};
+
+// boxes in [begin, end), empty if one of them does not fit
+std::vector<box> children(std::vector<uint8_t> const&d, size_t begin, size_t end){
+  std::vector<box> v;
+  for (auto p = begin; p < end;){
+    if (end - p < 8)
+      return std::vector<box>();
+    box b{ p, bigendian::touint32(d.data() + p), std::string(reinterpret_cast<char const*>(d.data()) + p + 4, 4) };
+    if (b.size < 8 || b.size > end - p)
+      return std::vector<box>();
+    v.push_back(b);
+    p += b.size;
+  }
+  return v;
+}
+
+box const* find(std::vector<box> const&v, char const*type, size_t n = 0){
+  for (auto&b : v){
+    if (b.type == type && !n--)
+      return &b;
+  }
+  return nullptr;
+}
+
+std::vector<uint8_t> read_file(std::string const&path){
+  std::vector<uint8_t> v;
+  flv::file f;
+  uint64_t size = 0;
+  if (f.open(path.c_str()) == 0 && f.size(&size) == 0){
+    v.resize(static_cast<size_t>(size));
+    if (f.read(0, v.data(), static_cast<uint32_t>(size)) != int64_t(size))
+      v.clear();
+  }
+  return v;
+}
+
+// a sample of the source: tag data after the codec bytes
+struct source_sample{
+  uint32_t             dts;
+  int32_t              cts;
+  bool                 key;
+  std::vector<uint8_t> data;
+};
+}
+
+FLV_TEST(fmp4_fragments_point_at_their_samples){
+  auto path = flv::test::temp_path("fmp4.flv");
+  auto mp4 = flv::test::temp_path("fmp4.mp4");
+  flv::synth_options o;
+  o.duration_ms = 5000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  flv::synth_result sr;
+  FLV_CHECK(flv::synthesize(path.c_str(), o, &sr) == 0);
+
+  // samples as the flv holds them
+  std::vector<source_sample> video, audio;
+  flv::file in;
+  FLV_CHECK(in.open(path.c_str()) == 0);
+  {
+    auto rd = flv::reader(&in);
+    FLV_CHECK(rd.open() == 0);
+    flv::raw_tag t;
+    int32_t cts = 0;
+    for (auto pos = rd.first_media_tag; rd.read_tag(pos, &t, &cts) == 0; pos = t.next()){
+      if (t.sequence_header() || (!t.is_avc() && !t.is_aac()))
+        continue;
+      packet data;
+      FLV_CHECK(rd.read_data(t, &data) == 0);
+      auto head = t.is_avc() ? 5u : 2u;
+      (t.is_avc() ? video : audio).push_back(source_sample{ t.timestamp, cts, t.keyframe(), std::vector<uint8_t>(data._ + head, data._ + data.length) });
+    }
+  }
+  FLV_CHECK(video.size() == sr.video_frames && audio.size() == sr.audio_frames);
+
+  flv::fmp4_remuxer m(&in);
+  FLV_CHECK(m.open() == 0);
+  FLV_CHECK(m.video_track == 1 && m.audio_track == 2 && m.fragment_count() == 5);
+  flv::fmp4_result r;
+  {
+    flv::file out;
+    FLV_CHECK(out.create(mp4.c_str()) == 0);
+    FLV_CHECK(m.remux(out, &r) == 0);
+  }
+  FLV_CHECK(r.fragments == 5 && r.samples == video.size() + audio.size());
+  auto d = read_file(mp4);
+  FLV_CHECK(d.size() == r.file_size);
+
+  // ftyp, moov, then a moof and an mdat per fragment, the sizes add up to the file
+  auto top = children(d, 0, d.size());
+  FLV_CHECK(top.size() == 2 + 2 * 5);
+  if (top.size() != 2 + 2 * 5)
+    return;
+  FLV_CHECK(top[0].type == "ftyp" && top[1].type == "moov");
+  auto moov = children(d, top[1].body(), top[1].end());
+  FLV_CHECK(find(moov, "mvhd") && find(moov, "trak", 0) && find(moov, "trak", 1) && find(moov, "mvex"));
+
+  size_t v = 0, a = 0;
+  for (size_t f = 0; f < 5; ++f){
+    auto&moof = top[2 + 2 * f];
+    auto&mdat = top[3 + 2 * f];
+    FLV_CHECK(moof.type == "moof" && mdat.type == "mdat" && mdat.pos == moof.end());
+    auto parts = children(d, moof.body(), moof.end());
+    FLV_CHECK(find(parts, "mfhd") && bigendian::touint32(d.data() + find(parts, "mfhd")->body() + 4) == f + 1);
+    for (size_t k = 0; k < 2; ++k){
+      auto traf = find(parts, "traf", k);
+      FLV_CHECK(traf != nullptr);
+      if (!traf)
+        return;
+      auto boxes = children(d, traf->body(), traf->end());
+      auto tfhd = find(boxes, "tfhd");
+      auto tfdt = find(boxes, "tfdt");
+      auto trun = find(boxes, "trun");
+      FLV_CHECK(tfhd && tfdt && trun);
+      if (!tfhd || !tfdt || !trun)
+        return;
+      auto track = bigendian::touint32(d.data() + tfhd->body() + 4);
+      auto base = uint64_t(bigendian::touint32(d.data() + tfdt->body() + 4)) << 32 | bigendian::touint32(d.data() + tfdt->body() + 8);
+      auto flags = bigendian::touint32(d.data() + trun->body()) & 0xffffff;
+      auto count = bigendian::touint32(d.data() + trun->body() + 4);
+      auto data_offset = bigendian::touint32(d.data() + trun->body() + 8);
+      bool is_video = track == 1;
+      auto&samples = is_video ? video : audio;
+      auto&next = is_video ? v : a;
+      FLV_CHECK(flags & 0x000001);  // data_offset present
+      FLV_CHECK(next + count <= samples.size());
+      if (next + count > samples.size())
+        return;
+      FLV_CHECK(base == (is_video ? samples[next].dts : uint64_t(samples[next].dts) * 44100 / 1000));
+      if (is_video)
+        FLV_CHECK(samples[next].key);
+
+      // each entry: duration, size and for video flags and composition offset
+      auto entry = trun->body() + 12;
+      auto at = moof.pos + data_offset;  // relative to the moof, tfhd default_base_is_moof
+      FLV_CHECK(at >= mdat.body() && at < mdat.end());
+      for (uint32_t i = 0; i < count; ++i, ++next){
+        auto&s = samples[next];
+        auto duration = bigendian::touint32(d.data() + entry);
+        auto size = bigendian::touint32(d.data() + entry + 4);
+        entry += 8;
+        if (is_video){
+          auto sync = (bigendian::touint32(d.data() + entry) & 0x00010000) == 0;
+          auto cts = static_cast<int32_t>(bigendian::touint32(d.data() + entry + 4));
+          entry += 8;
+          FLV_CHECK(sync == s.key && cts == s.cts);
+          FLV_CHECK(next + 1 >= samples.size() || duration == samples[next + 1].dts - s.dts);
+        }
+        else
+          FLV_CHECK(duration == 1024);
+        FLV_CHECK(size == s.data.size() && at + size <= mdat.end());
+        if (at + size > mdat.end())
+          return;
+        FLV_CHECK(memcmp(d.data() + at, s.data.data(), size) == 0);
+        at += size;
+      }
+      FLV_CHECK(entry == trun->end());
+    }
+  }
+  FLV_CHECK(v == video.size() && a == audio.size());
+  in.close();
+  flv::test::remove_file(mp4);
+  flv::test::remove_file(path);
+}
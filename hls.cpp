@@ -0,0 +1,85 @@
+#include "hls.hpp"
+#include <algorithm>
+#include <cstdio>
+#include "compat.hpp"
+
+int32_t flv::hls_segmenter::open(){
+  if (mp4.open() != 0)
+    return -1;
+  if (format == hls_format::ts && ts.open() != 0)
+    return -1;
+
+  // start of every gop
+  auto&rd = mp4.rd;
+  auto&bounds = mp4.bounds;
+  auto&times = mp4.times;
+  auto n = static_cast<uint32_t>(mp4.fragment_count());
+  uint32_t last = rd.last_timestamp ? rd.last_timestamp : rd.meta.last_timestamp;
+  if (n && last < times.back()){
+    ::keyframes index;
+    if (rd.build_index(&index, &last) != 0)
+      return -1;
+  }
+
+  segments.clear();
+  target_duration = 1;
+  for (uint32_t k = 0; k < n;){
+    auto first = k;
+    do
+      ++k;
+    while (k < n && times[k] < times[first] + target_ms);
+    auto end = k < n ? times[k] : std::max(last, times[first]);
+    auto duration = end > times[first] ? end - times[first] : 0;
+    segments.push_back(hls_segment{ bounds[first], bounds[k], times[first], duration, first, k - first });
+    target_duration = std::max(target_duration, (duration + 500) / 1000);  // extinf rounded must not exceed it
+  }
+  return 0;
+}
+
+std::string flv::hls_segmenter::playlist(std::string const&prefix)const{
+  auto fmp4 = format == hls_format::fmp4;
+  char line[64];
+  std::string s = "#EXTM3U\n";
+  FLV_SNPRINTF(line, sizeof(line), "#EXT-X-VERSION:%d\n#EXT-X-TARGETDURATION:%u\n", fmp4 ? 7 : 3, target_duration);
+  s += line;
+  s += "#EXT-X-MEDIA-SEQUENCE:0\n#EXT-X-PLAYLIST-TYPE:VOD\n#EXT-X-INDEPENDENT-SEGMENTS\n";
+  if (fmp4)
+    s += "#EXT-X-MAP:URI=\"" + prefix + "init.mp4\"\n";
+  for (size_t i = 0; i < segments.size(); ++i){
+    FLV_SNPRINTF(line, sizeof(line), "#EXTINF:%u.%03u,\n", segments[i].duration / 1000, segments[i].duration % 1000);
+    s += line;
+    s += prefix + std::to_string(i) + (fmp4 ? ".m4s\n" : ".ts\n");
+  }
+  s += "#EXT-X-ENDLIST\n";
+  return s;
+}
+
+int32_t flv::hls_segmenter::init_segment(ts_sink*out){
+  if (format != hls_format::fmp4)
+    return -1;
+  return out->write(mp4.init.data.data(), static_cast<uint32_t>(mp4.init.data.size())) ? -1 : 0;
+}
+
+int32_t flv::hls_segmenter::segment(size_t i, ts_sink*out){
+  if (i >= segments.size())
+    return -1;
+  auto&s = segments[i];
+  if (format == hls_format::ts){
+    // every segment starts with PAT and PMT, they are repeated within it by the remuxer
+    ts.sink = out;
+    ts.tables_sent = false;
+    auto hr = ts.remux_range(s.begin, s.end, out) == 0 && ts.flush() == 0 ? 0 : -1;
+    ts.sink = nullptr;
+    ts.ring_used = 0;  // left by a failure, not for the next segment
+    return hr;
+  }
+  for (auto f = s.fragment; f < s.fragment + s.fragments; ++f){
+    if (mp4.fragment(f, &slices) != 0)
+      return -1;
+    for (auto&v : slices){
+      if (out->write(static_cast<uint8_t const*>(v.data), v.length) != 0)
+        return -1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "fmp4_remux.hpp"
+#include "ts_remux.hpp"
+
+namespace flv{
+enum class hls_format{
+  ts,
+  fmp4,
+};
+
+struct hls_segment{
+  uint64_t begin;      // fileposition of the first tag
+  uint64_t end;        // fileposition after the last tag
+  uint32_t time;       // milliseconds
+  uint32_t duration;   // milliseconds
+  uint32_t fragment;   // first fmp4 fragment, a fragment is a gop
+  uint32_t fragments;
+};
+
+// hls vod of a flv file without pre-segmentation.
+// open() plans keyframe aligned segments of at least target_ms from the keyframes index
+// without reading the gops. segment(i) reads only the byte range of segment i
+// and remuxes it to ts or fmp4
+struct hls_segmenter{
+  explicit hls_segmenter(byte_source*src, hls_format f = hls_format::ts) : format(f), mp4(src), ts(src){}
+  hls_segmenter(hls_segmenter const&) = delete;
+
+  uint32_t   target_ms = 6000;
+  hls_format format;
+
+  int32_t     open();  // 0: ok, -1: not flv or neither avc nor aac
+  // media playlist, segment uris are prefix + index + ".ts" or ".m4s", the fmp4 init segment prefix + "init.mp4"
+  std::string playlist(std::string const&prefix)const;
+  int32_t     init_segment(ts_sink*out);  // fmp4 only
+  int32_t     segment(size_t i, ts_sink*out);
+
+  std::vector<hls_segment> segments;
+  uint32_t                 target_duration = 0;  // seconds, EXT-X-TARGETDURATION
+  fmp4_remuxer             mp4;                  // gop boundaries of the plan, fmp4 segments
+  ts_remuxer               ts;
+  std::vector<io_slice>    slices;
+};
+}
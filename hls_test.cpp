@@ -0,0 +1,116 @@
+#include "hls.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+// records the range of the reads that pass through it
+struct counting_source : public flv::byte_source{
+  explicit counting_source(flv::byte_source*src) : source(src){}
+  int64_t read(uint64_t pos, void*data, uint32_t length) override{
+    auto cb = source->read(pos, data, length);
+    lowest = std::min(lowest, pos);
+    highest = std::max(highest, pos + length);
+    ++reads;
+    return cb;
+  }
+  int32_t size(uint64_t*v) override{ return source->size(v); }
+  void    reset(){ lowest = UINT64_MAX; highest = 0; reads = 0; }
+
+  flv::byte_source *source;
+  uint64_t          lowest  = UINT64_MAX;
+  uint64_t          highest = 0;
+  uint32_t          reads   = 0;
+};
+
+struct memory_sink : public flv::ts_sink{
+  int32_t write(uint8_t const*packets, uint32_t length) override{
+    data.insert(data.end(), packets, packets + length);
+    return 0;
+  }
+  std::vector<uint8_t> data;
+};
+
+// twenty seconds, a keyframe every second
+std::string sample_file(){
+  auto path = flv::test::temp_path("hls.flv");
+  flv::synth_options o;
+  o.duration_ms = 20000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  flv::synth_result r;
+  if (flv::synthesize(path.c_str(), o, &r) != 0)
+    flv::test::fail(__FILE__, __LINE__, "sample file");
+  return path;
+}
+
+// milliseconds of every #EXTINF of the playlist
+std::vector<uint32_t> extinf(std::string const&playlist){
+  std::vector<uint32_t> v;
+  for (size_t at = playlist.find("#EXTINF:"); at != std::string::npos; at = playlist.find("#EXTINF:", at + 1)){
+    auto s = playlist.c_str() + at + 8;
+    char*end = nullptr;
+    auto seconds = strtoul(s, &end, 10);
+    auto ms = *end == '.' ? strtoul(end + 1, nullptr, 10) : 0;
+    v.push_back(static_cast<uint32_t>(seconds * 1000 + ms));
+  }
+  return v;
+}
+}
+
+FLV_TEST(hls_segments_are_keyframe_aligned_and_read_their_range_only){
+  auto path = sample_file();
+  for (int k = 0; k < 2; ++k){
+    auto format = k ? flv::hls_format::fmp4 : flv::hls_format::ts;
+    flv::file f;
+    FLV_CHECK(f.open(path.c_str()) == 0);
+    counting_source source(&f);
+    flv::hls_segmenter hls(&source, format);
+    FLV_CHECK(hls.open() == 0);
+    auto&rd = hls.mp4.rd;
+    auto&s = hls.segments;
+    FLV_CHECK(s.size() == 4 && hls.target_duration == 6);
+    if (s.size() != 4)
+      return;
+
+    // extinf adds up to the media duration
+    auto durations = extinf(hls.playlist("seg"));
+    FLV_CHECK(durations.size() == s.size());
+    uint32_t sum = 0;
+    for (size_t i = 0; i < durations.size(); ++i){
+      FLV_CHECK(durations[i] == s[i].duration && (durations[i] + 500) / 1000 <= hls.target_duration);
+      sum += durations[i];
+    }
+    FLV_CHECK(sum == rd.last_timestamp - s[0].time);
+
+    // segments follow each other and start with a gop, the first video tag is a keyframe at the segment time
+    FLV_CHECK(s[0].begin >= rd.first_media_tag && s[0].time == 0 && s.back().end == rd.file_size);
+    for (size_t i = 0; i < s.size(); ++i){
+      FLV_CHECK(i + 1 == s.size() || s[i].end == s[i + 1].begin);
+      flv::raw_tag t;
+      auto pos = s[i].begin;
+      while (rd.read_tag(pos, &t) == 0 && t.type != flv::tag_type::video)
+        pos = t.next();
+      FLV_CHECK(t.keyframe() && t.timestamp == i * 6000 && pos < s[i].end);
+    }
+
+    // a segment reads its own bytes and nothing else
+    for (size_t i = 0; i < s.size(); ++i){
+      memory_sink out;
+      source.reset();
+      FLV_CHECK(hls.segment(i, &out) == 0);
+      FLV_CHECK(source.reads && source.lowest >= s[i].begin && source.highest <= s[i].end);
+      FLV_CHECK(!out.data.empty());
+      if (format == flv::hls_format::ts)
+        FLV_CHECK(out.data.size() % flv::ts_packet_length == 0 && out.data[0] == 0x47 && out.data[1] == 0x40 && out.data[2] == 0);  // PAT
+      else
+        FLV_CHECK(out.data.size() > 8 && std::string(reinterpret_cast<char const*>(out.data.data()) + 4, 4) == "moof");
+    }
+    FLV_CHECK(hls.ts.sink == nullptr);
+  }
+  flv::test::remove_file(path);
+}
@@ -19,24 +19,26 @@ struct keyframes {  // todo: implement rvalue copy ctr
     positions.push_back(pos);  // ignore return value
   }
   void push_time(double sec){
-    auto nano = uint64_t(sec * 10000ull * 1000ull);
+    auto nano = uint64_t(sec * 10000ull * 1000ull + 0.5);  // rounded, seconds are stored as doubles
     times.push_back(nano); // milli to nano
 //    time_index.insert(nano);
   }
-  keyframe seek(uint64_t nano){
-    assert(positions.size() == times.size());
-    return binary_search(nano, 0, int32_t(times.size()) - 1);
-  }
-  keyframe binary_search(uint64_t v, int32_t start, int32_t tail) {
-    if (start >= tail) {
-      return keyframe{ positions[start], times[start] };
+  // append a keyframe found while demuxing, times must grow
+  void push_keyframe(keyframe const&k){
+    if (times.empty() || k.time > times.back()){
+      positions.push_back(k.position);
+      times.push_back(k.time);
     }
-    auto m = (start + tail) / 2;
-    if (times[m] == v)
-      return keyframe{ positions[m], times[m] };
-    if (times[m] < v)
-      return binary_search(v, m +1, tail);
-    else
-      return binary_search(v, start, m-1);
+  }
+  bool empty()const{
+    return times.empty();
+  }
+  // the last keyframe at or before nano, the first one if nano precedes every keyframe
+  keyframe seek(uint64_t nano)const{
+    assert(positions.size() == times.size() && !times.empty());
+    auto i = std::upper_bound(times.begin(), times.end(), nano) - times.begin();
+    if (i)
+      --i;
+    return keyframe{ positions[i], times[i] };
   }
 };
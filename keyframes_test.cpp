@@ -0,0 +1,39 @@
+#include "keyframes.hpp"
+#include "test.hpp"
+
+namespace{
+// keyframes every second at 100, 200, ... bytes
+::keyframes every_second(uint32_t count){
+  ::keyframes v;
+  for (uint32_t i = 0; i < count; ++i)
+    v.push_keyframe(keyframe{ 100 * (i + 1), uint64_t(i) * 1000 * 10000 });  // millis to nano
+  return v;
+}
+}
+
+FLV_TEST(keyframes_seek_between_keyframes_takes_the_earlier_one){
+  auto v = every_second(10);
+  for (uint32_t i = 0; i + 1 < 10; ++i){
+    auto k = v.seek((uint64_t(i) * 1000 + 999) * 10000);
+    FLV_CHECK(k.time == uint64_t(i) * 1000 * 10000);
+    FLV_CHECK(k.position == 100 * (i + 1));
+    k = v.seek((uint64_t(i) * 1000 + 1) * 10000);
+    FLV_CHECK(k.position == 100 * (i + 1));
+  }
+}
+
+FLV_TEST(keyframes_seek_exact_and_out_of_range){
+  auto v = every_second(7);
+  for (uint32_t i = 0; i < 7; ++i)
+    FLV_CHECK(v.seek(uint64_t(i) * 1000 * 10000).position == 100 * (i + 1));
+  FLV_CHECK(v.seek(uint64_t(3600) * 1000 * 10000).position == 700);  // past the end, the last one
+
+  ::keyframes late;
+  late.push_keyframe(keyframe{ 13, 5000 * 10000 });
+  late.push_keyframe(keyframe{ 99, 6000 * 10000 });
+  FLV_CHECK(late.seek(0).position == 13);  // before the first, the first
+  FLV_CHECK(late.seek(uint64_t(5999) * 10000).position == 13);
+
+  auto one = every_second(1);
+  FLV_CHECK(one.seek(0).position == 100 && one.seek(uint64_t(-1)).position == 100);
+}
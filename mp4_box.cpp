@@ -0,0 +1,50 @@
+#include "mp4_box.hpp"
+
+size_t flv::box_writer::begin(char const*type){
+  auto at = data.size();
+  ui32(0);  // size
+  fourcc(type);
+  return at;
+}
+size_t flv::box_writer::begin_full(char const*type, uint8_t version, uint32_t flags){
+  auto at = begin(type);
+  ui8(version);
+  ui24(flags);
+  return at;
+}
+void flv::box_writer::end(size_t at){
+  patch_ui32(at, static_cast<uint32_t>(data.size() - at));
+}
+void flv::box_writer::fourcc(char const*v){
+  data.insert(data.end(), v, v + 4);
+}
+void flv::box_writer::ui8(uint8_t v){
+  data.push_back(v);
+}
+void flv::box_writer::ui16(uint16_t v){
+  data.push_back(uint8_t(v >> 8));
+  data.push_back(uint8_t(v));
+}
+void flv::box_writer::ui24(uint32_t v){
+  data.push_back(uint8_t(v >> 16));
+  data.push_back(uint8_t(v >> 8));
+  data.push_back(uint8_t(v));
+}
+void flv::box_writer::ui32(uint32_t v){
+  for (int i = 3; i >= 0; --i)
+    data.push_back(uint8_t(v >> (i * 8)));
+}
+void flv::box_writer::ui64(uint64_t v){
+  ui32(uint32_t(v >> 32));
+  ui32(uint32_t(v));
+}
+void flv::box_writer::zeros(uint32_t count){
+  data.insert(data.end(), count, 0);
+}
+void flv::box_writer::bytes(uint8_t const*v, uint32_t length){
+  data.insert(data.end(), v, v + length);
+}
+void flv::box_writer::patch_ui32(size_t at, uint32_t v){
+  for (int i = 0; i < 4; ++i)
+    data[at + i] = uint8_t(v >> ((3 - i) * 8));
+}
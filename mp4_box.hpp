@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace flv{
+// iso bmff boxes, sizes are patched when a box ends
+struct box_writer{
+  std::vector<uint8_t> data;
+
+  size_t begin(char const*type);                                  // returns offset of the box
+  size_t begin_full(char const*type, uint8_t version, uint32_t flags);
+  void   end(size_t at);                                          // patches size of the box at
+  void   fourcc(char const*v);
+  void   ui8(uint8_t v);
+  void   ui16(uint16_t v);
+  void   ui24(uint32_t v);
+  void   ui32(uint32_t v);
+  void   ui64(uint64_t v);
+  void   zeros(uint32_t count);
+  void   bytes(uint8_t const*v, uint32_t length);
+  void   patch_ui32(size_t at, uint32_t v);
+};
+}
@@ -1,50 +1,78 @@
 #pragma once
 #include <cstdint>
-#include <cstring>  //memcpy_s
+#include <cstring>  //memcpy
 #include <utility>
+#include "compat.hpp"
+
+// payloads up to this many bytes are stored in the packet itself, larger ones on the heap
+#ifndef PACKET_INLINE_LENGTH
+#define PACKET_INLINE_LENGTH 512
+#endif
+const static uint32_t packet_inline_length = PACKET_INLINE_LENGTH;
+
 struct packet{
-  uint8_t *_      = nullptr;
+  uint8_t *_      = nullptr;  // inline storage or heap, nullptr if empty
   uint32_t length = 0;
   packet()        = default;
 
-  packet(packet const&rhs) :packet(){
-    if (rhs.length){
-      length = rhs.length;
-      _ = new uint8_t[length];
-      memcpy_s(_, length, rhs._, rhs.length);
-    }
-  }
+  packet(packet const&rhs) :packet(rhs._, rhs.length){}
 
-  packet(packet &&rhs) :packet(){
-    std::swap(length, rhs.length);
-    std::swap(_, rhs._);
+  packet(packet &&rhs) FLV_NOEXCEPT :packet(){
+    take(rhs);
   }
 
-  packet&operator=(packet&&rhs){
-    std::swap(length, rhs.length);
-    std::swap(_, rhs._);
+  packet&operator=(packet&&rhs) FLV_NOEXCEPT{
+    if (this != &rhs){
+      release();
+      take(rhs);
+    }
     return *this;
   }
 
   packet&operator=(packet const&rhs){
-    if (rhs.length){
-      length = rhs.length;
-      _ = new uint8_t[length];
+    if (this != &rhs){
+      release();
+      allocate(rhs.length);
+      if (rhs._)
+        memcpy(_, rhs._, rhs.length);
     }
-    if(rhs._)  memcpy_s(_, length, rhs._, rhs.length);
     return *this;
   }
 
-  packet(const uint8_t*d, uint32_t len) : length(len){
-    if (length){
-      _ = new uint8_t[length];
-    }
-    if(d)
-      memcpy_s(_, length, d, len);
+  packet(const uint8_t*d, uint32_t len){
+    allocate(len);
+    if(d && len)
+      memcpy(_, d, len);
   }
 
   explicit packet(uint32_t len) : packet(nullptr, len){  }
   ~packet(){
-    delete[] _;
+    release();
+  }
+  bool is_inline()const{ return _ == store; }
+
+private:
+  void allocate(uint32_t len){
+    length = len;
+    _ = !len ? nullptr : len <= packet_inline_length ? store : new uint8_t[len];
+  }
+  void release(){
+    if (_ != store)
+      delete[] _;
+    _ = nullptr;
+    length = 0;
+  }
+  // rhs is left empty
+  void take(packet&rhs){
+    if (rhs.is_inline()){
+      memcpy(store, rhs.store, rhs.length);
+      _ = store;
+    }
+    else
+      _ = rhs._;
+    length = rhs.length;
+    rhs._ = nullptr;
+    rhs.length = 0;
   }
+  uint8_t  store[packet_inline_length];
 };
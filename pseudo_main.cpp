@@ -0,0 +1,22 @@
+#include <cstdio>
+#include <cstdlib>
+#include "pseudo_stream.hpp"
+
+// FlvPseudoStream root [port [address]]: serves the flv files under root until it's killed
+int main(int argc, char**argv){
+  if (argc < 2){
+    fprintf(stderr, "usage: %s root [port [address]]\n", argv[0]);
+    return 2;
+  }
+  flv::pseudo_server server;
+  server.root = argv[1];
+  auto port = argc > 2 ? static_cast<uint16_t>(atoi(argv[2])) : static_cast<uint16_t>(8080);
+  auto address = argc > 3 ? argv[3] : "0.0.0.0";
+  if (server.listen(address, port) != 0){
+    fprintf(stderr, "can't listen on %s:%u\n", address, port);
+    return 1;
+  }
+  printf("serving %s on %s:%u\n", argv[1], address, server.bound_port);
+  fflush(stdout);
+  return server.run() == 0 ? 0 : 1;
+}
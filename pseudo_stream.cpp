@@ -0,0 +1,354 @@
+#include "pseudo_stream.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "amf.hpp"
+#include "bigendian.hpp"
+#include "compat.hpp"
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+#include <csignal>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define close_socket ::close
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+const static uint32_t request_limit    = 8192;       // request line and headers
+const static uint32_t send_block_size  = 1 << 20;    // without sendfile
+const static uint32_t sendfile_chunk   = 1 << 30;
+
+namespace{
+int32_t send_all(socket_t s, void const*data, size_t length){
+  auto p = static_cast<char const*>(data);
+  while (length){
+#ifdef _WIN32
+    auto cb = ::send(s, p, static_cast<int>(std::min<size_t>(length, INT32_MAX)), 0);
+#else
+    auto cb = ::send(s, p, length, MSG_NOSIGNAL);
+    if (cb < 0 && errno == EINTR)
+      continue;
+#endif
+    if (cb <= 0)
+      return -1;
+    p += cb;
+    length -= static_cast<size_t>(cb);
+  }
+  return 0;
+}
+
+// file bytes to the socket, in the kernel on linux
+int32_t send_file(socket_t s, flv::file&f, uint64_t pos, uint64_t length){
+#ifdef __linux__
+  while (length){
+    auto offset = static_cast<off_t>(pos);
+    auto cb = ::sendfile(s, f.fd, &offset, static_cast<size_t>(std::min<uint64_t>(length, sendfile_chunk)));
+    if (cb < 0 && errno == EINTR)
+      continue;
+    if (cb < 0 && (errno == EINVAL || errno == ENOSYS))
+      break;
+    if (cb <= 0)
+      return -1;
+    pos += static_cast<uint64_t>(cb);
+    length -= static_cast<uint64_t>(cb);
+  }
+#endif
+  std::vector<uint8_t> block(static_cast<size_t>(std::min<uint64_t>(length, send_block_size)));
+  while (length){
+    auto n = static_cast<uint32_t>(std::min<uint64_t>(length, block.size()));
+    if (f.read(pos, block.data(), n) != n || send_all(s, block.data(), n) != 0)
+      return -1;
+    pos += n;
+    length -= n;
+  }
+  return 0;
+}
+
+int32_t reply(socket_t s, char const*status){
+  char text[128];
+  auto n = FLV_SNPRINTF(text, sizeof(text), "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status);
+  return send_all(s, text, static_cast<size_t>(n));
+}
+
+// start=<seconds> from the query, 0 if there is none
+uint32_t start_ms(std::string const&query){
+  for (size_t p = 0; p < query.size();){
+    auto amp = query.find('&', p);
+    auto item = query.substr(p, amp == std::string::npos ? std::string::npos : amp - p);
+    if (item.compare(0, 6, "start=") == 0){
+      auto v = strtod(item.c_str() + 6, nullptr);
+      return v > 0 && v < UINT32_MAX / 1000.0 ? static_cast<uint32_t>(v * 1000 + 0.5) : 0;
+    }
+    if (amp == std::string::npos)
+      break;
+    p = amp + 1;
+  }
+  return 0;
+}
+}
+
+int32_t flv::pseudo_stream::open(char const*path){
+  if (source.open(path) != 0 || rd.open() != 0)
+    return -1;
+  index = rd.meta.keyframes;
+  last_timestamp = rd.last_timestamp;
+  if ((index.empty() || index.positions.size() != index.times.size()) && rd.build_index(&index, &last_timestamp) != 0)
+    return -1;
+  meta = rd.meta;
+  meta.has_video = (rd.header.has_video || rd.avc_tag.type != flv::tag_type::eof) ? 1 : 0;
+  meta.has_audio = (rd.header.has_audio || rd.aac_tag.type != flv::tag_type::eof) ? 1 : 0;
+  meta.can_seek_to_end = 0;
+
+  head.resize(flv_file_header_length + flv_previous_tag_size_field_length);
+  if (source.read(0, head.data(), flv_file_header_length) != flv_file_header_length)
+    return -1;
+  bigendian::binary_writer w(head.data() + 5, static_cast<uint32_t>(head.size() - 5));
+  w.ui32(flv_file_header_length);
+  w.ui32(0);
+  if (rd.script_tag.type == flv::tag_type::script_data && rd.read_data(rd.script_tag, &script) != 0)
+    return -1;
+  for (auto t : { &rd.avc_tag, &rd.aac_tag }){
+    if (t->type == flv::tag_type::eof)
+      continue;
+    auto at = static_cast<uint32_t>(sequence.size());
+    auto length = static_cast<uint32_t>(t->next() - t->position);
+    sequence.resize(at + length);
+    if (source.read(t->position, sequence.data() + at, length) != length)
+      return -1;
+    sequence_tags.push_back(at);
+  }
+  return 0;
+}
+
+int32_t flv::pseudo_stream::seek(uint32_t ms, std::vector<uint8_t>*prefix, uint64_t*offset)const{
+  prefix->clear();
+  *offset = 0;
+  if (!ms || index.empty())
+    return 0;
+  auto k = index.seek(uint64_t(ms) * 10000);  // millis to nano
+  if (k.position <= index.positions.front() || k.position >= rd.file_size)
+    return 0;
+  auto start = static_cast<uint32_t>(k.time / 10000);
+
+  // keyframes from k on, encoded once to learn the length the filepositions depend on
+  flv_meta v = meta;
+  v.keyframes = ::keyframes();
+  for (size_t i = 0; i < index.times.size(); ++i){
+    if (index.positions[i] >= k.position)
+      v.keyframes.push_keyframe(keyframe{ index.positions[i], index.times[i] - k.time });
+  }
+  v.last_timestamp = last_timestamp > start ? last_timestamp - start : 0;
+  v.last_keyframe_timestamp = v.keyframes.empty() ? 0 : static_cast<uint32_t>(v.keyframes.times.back() / 10000);
+  auto writer = flv::amf_writer();
+  if (flv::on_meta_data_encoder().patch(writer, script._, script.length, v) != 0)
+    return -1;
+  auto meta_length = static_cast<uint32_t>(writer.data.size());
+  auto data_start = head.size() + flv_tag_header_length + meta_length + flv_previous_tag_size_field_length + sequence.size();
+  for (auto&pos : v.keyframes.positions)
+    pos = pos - k.position + data_start;
+  v.filesize = data_start + rd.file_size - k.position;
+  writer.data.clear();
+  flv::on_meta_data_encoder().patch(writer, script._, script.length, v);
+  if (writer.data.size() != meta_length)
+    return -1;
+
+  prefix->resize(data_start);
+  auto p = prefix->data();
+  memcpy(p, head.data(), head.size());
+  p += head.size();
+  encode_tag_header(p, flv::tag_type::script_data, meta_length, 0);
+  p += flv_tag_header_length;
+  memcpy(p, writer.data.data(), meta_length);
+  p += meta_length;
+  bigendian::binary_writer(p, flv_previous_tag_size_field_length).ui32(flv_tag_header_length + meta_length);
+  p += flv_previous_tag_size_field_length;
+  if (!sequence.empty())
+    memcpy(p, sequence.data(), sequence.size());
+  for (auto at : sequence_tags)
+    patch_timestamp(p + at, start);
+  *offset = k.position;
+  return 0;
+}
+
+flv::pseudo_server::~pseudo_server(){
+  stop();
+  while (serving)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+int32_t flv::pseudo_server::listen(char const*address, uint16_t port){
+#ifdef _WIN32
+  WSADATA wsa;
+  if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+    return -1;
+#else
+  signal(SIGPIPE, SIG_IGN);  // sendfile to a closed peer
+#endif
+  sockaddr_in sa = {};
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  if (inet_pton(AF_INET, address, &sa.sin_addr) != 1)
+    return -1;
+  auto s = ::socket(AF_INET, SOCK_STREAM, 0);
+#ifdef _WIN32
+  if (s == INVALID_SOCKET)
+    return -1;
+#else
+  if (s < 0)
+    return -1;
+#endif
+  int on = 1;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char const*>(&on), sizeof(on));
+  socklen_t length = sizeof(sa);
+  if (::bind(s, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0 || ::listen(s, SOMAXCONN) != 0
+    || getsockname(s, reinterpret_cast<sockaddr*>(&sa), &length) != 0){
+    close_socket(s);
+    return -1;
+  }
+  listener = static_cast<intptr_t>(s);
+  bound_port = ntohs(sa.sin_port);
+  running = true;
+  return 0;
+}
+
+int32_t flv::pseudo_server::run(){
+  serving = true;
+  std::vector<std::thread> pool;
+  for (uint32_t i = 0; i < std::max<uint32_t>(workers, 1); ++i)
+    pool.push_back(std::thread([this]{ work(); }));
+  int32_t hr = 0;
+  while (running){
+    auto c = ::accept(static_cast<socket_t>(listener), nullptr, nullptr);
+#ifdef _WIN32
+    if (c == INVALID_SOCKET){
+#else
+    if (c < 0 && errno == EINTR)
+      continue;
+    if (c < 0){
+#endif
+      hr = running ? -1 : 0;
+      break;
+    }
+    std::unique_lock<std::mutex> guard(queue_lock);
+    if (pending.size() >= queue_limit){
+      guard.unlock();
+      reply(c, "503 Service Unavailable");
+      close_socket(c);
+      continue;
+    }
+    pending.push_back(static_cast<intptr_t>(c));
+    queued.notify_one();
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(queue_lock);
+    running = false;
+    queued.notify_all();
+  }
+  for (auto&t : pool)
+    t.join();
+  for (auto c : pending)
+    close_socket(static_cast<socket_t>(c));
+  pending.clear();
+  serving = false;
+  return hr;
+}
+
+// serves queued connections until the server stops
+void flv::pseudo_server::work(){
+  for (;;){
+    intptr_t c;
+    {
+      std::unique_lock<std::mutex> guard(queue_lock);
+      queued.wait(guard, [this]{ return !running || !pending.empty(); });
+      if (!running)
+        return;
+      c = pending.front();
+      pending.pop_front();
+    }
+    serve(c);
+    close_socket(static_cast<socket_t>(c));
+  }
+}
+
+void flv::pseudo_server::stop(){
+  if (!running.exchange(false))
+    return;
+  {
+    std::lock_guard<std::mutex> guard(queue_lock);
+    queued.notify_all();
+  }
+  // wakes accept
+#ifdef _WIN32
+  closesocket(static_cast<socket_t>(listener));
+#else
+  ::shutdown(static_cast<socket_t>(listener), SHUT_RDWR);
+  ::close(static_cast<socket_t>(listener));
+#endif
+  listener = -1;
+}
+
+std::shared_ptr<flv::pseudo_stream> flv::pseudo_server::stream(std::string const&path){
+  std::lock_guard<std::mutex> guard(lock);
+  auto i = streams.find(path);
+  if (i != streams.end())
+    return i->second;
+  auto v = std::make_shared<pseudo_stream>();
+  if (v->open((root + path).c_str()) != 0)
+    return nullptr;
+  streams[path] = v;
+  return v;
+}
+
+void flv::pseudo_server::serve(intptr_t handle){
+  auto s = static_cast<socket_t>(handle);
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos){
+    if (request.size() > request_limit)
+      return (void)reply(s, "431 Request Header Fields Too Large");
+    auto cb = ::recv(s, buffer, sizeof(buffer), 0);
+    if (cb <= 0)
+      return;
+    request.append(buffer, static_cast<size_t>(cb));
+  }
+  // GET /path?query HTTP/1.x
+  auto sp = request.find(' ');
+  auto sp2 = request.find(' ', sp + 1);
+  if (sp == std::string::npos || sp2 == std::string::npos)
+    return (void)reply(s, "400 Bad Request");
+  if (request.compare(0, sp, "GET") != 0)
+    return (void)reply(s, "405 Method Not Allowed");
+  auto target = request.substr(sp + 1, sp2 - sp - 1);
+  auto q = target.find('?');
+  auto path = target.substr(0, q);
+  if (path.empty() || path[0] != '/' || path.find("..") != std::string::npos)
+    return (void)reply(s, "400 Bad Request");
+  auto v = stream(path);
+  if (!v)
+    return (void)reply(s, "404 Not Found");
+
+  std::vector<uint8_t> prefix;
+  uint64_t offset = 0;
+  v->seek(q == std::string::npos ? 0 : start_ms(target.substr(q + 1)), &prefix, &offset);
+  char text[256];
+  auto n = FLV_SNPRINTF(text, sizeof(text), "HTTP/1.1 200 OK\r\nContent-Type: video/x-flv\r\nContent-Length: %llu\r\nConnection: close\r\n\r\n",
+    static_cast<unsigned long long>(prefix.size() + v->rd.file_size - offset));
+  prefix.insert(prefix.begin(), text, text + n);
+  if (send_all(s, prefix.data(), prefix.size()) == 0)
+    send_file(s, v->source, offset, v->rd.file_size - offset);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "file_io.hpp"
+#include "flv_reader.hpp"
+#include "keyframes.hpp"
+
+namespace flv{
+// "?start=" pseudo-streaming of one flv file.
+// the head of the file and the keyframes index are read once, a request is a keyframe lookup
+// and a prefix of file header, onMetaData and sequence headers, then the original file from the keyframe on
+struct pseudo_stream{
+  pseudo_stream() : rd(&source){}
+  pseudo_stream(pseudo_stream const&) = delete;
+
+  int32_t open(char const*path);  // 0: ok, -1: not a flv file
+  // prefix and the fileposition the original file continues at, for a start time in milliseconds.
+  // the whole file without prefix if ms is before the second keyframe or the prefix can't be built (-1).
+  // onMetaData of the prefix describes the served range: duration and keyframe times count from the keyframe,
+  // filepositions and filesize from the start of the response. tags keep their source timestamps
+  int32_t seek(uint32_t ms, std::vector<uint8_t>*prefix, uint64_t*offset)const;
+
+  file                  source;
+  flv::reader           rd;
+  ::keyframes           index;
+  flv_meta              meta;            // of the whole file, index properties are replaced per request
+  uint32_t              last_timestamp = 0;
+  std::vector<uint8_t>  head;            // file header as stored but data_offset, and PreviousTagSize0
+  packet                script;          // onMetaData tag data, empty if the file has none
+  std::vector<uint8_t>  sequence;        // sequence header tags as stored
+  std::vector<uint32_t> sequence_tags;   // offsets in sequence, timestamps are moved to the keyframe
+};
+
+// http/1.1 GET of flv files under root, "?start=" seconds seeks to the keyframe at or near it.
+// accepted connections wait in a queue for one of a fixed number of worker threads, a full queue is answered
+// with 503. the body after the prefix is sent with sendfile where available
+struct pseudo_server{
+  pseudo_server() = default;
+  pseudo_server(pseudo_server const&) = delete;
+  ~pseudo_server();
+
+  std::string root        = ".";
+  uint32_t    workers     = 8;   // connections served at once
+  uint32_t    queue_limit = 64;  // accepted connections waiting for a worker
+
+  int32_t listen(char const*address, uint16_t port);  // port 0 binds any free port, see bound_port
+  int32_t run();                                      // accepts until stop(), returns when the workers are done
+  void    stop();
+  // opened on first request and shared by every later one
+  std::shared_ptr<pseudo_stream> stream(std::string const&path);
+
+  uint16_t                                              bound_port = 0;
+  intptr_t                                              listener   = -1;
+  std::atomic<bool>                                     running{ false };
+  std::atomic<bool>                                     serving{ false };  // run hasn't joined its workers, waited for on destruction
+  std::mutex                                            lock;
+  std::map<std::string, std::shared_ptr<pseudo_stream>> streams;
+  std::mutex                                            queue_lock;
+  std::condition_variable                               queued;
+  std::deque<intptr_t>                                  pending;  // accepted sockets
+
+  void work();
+  void serve(intptr_t s);
+};
+}
@@ -0,0 +1,154 @@
+#include "pseudo_stream.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "file_io.hpp"
+#include "flv_synth.hpp"
+#include "test.hpp"
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define close_socket ::close
+#endif
+
+namespace{
+// ten seconds, a keyframe every second
+std::string sample_file(){
+  auto path = flv::test::temp_path("pseudo_stream.flv");
+  flv::synth_options o;
+  o.duration_ms = 10000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  flv::synth_result r;
+  if (flv::synthesize(path.c_str(), o, &r) != 0)
+    flv::test::fail(__FILE__, __LINE__, "sample file");
+  return path;
+}
+
+// prefix and file range for a start time in milliseconds
+int32_t expected_body(flv::pseudo_stream const&v, uint32_t ms, std::vector<uint8_t>*body){
+  uint64_t offset = 0;
+  if (v.seek(ms, body, &offset) != 0)
+    return -1;
+  auto at = body->size();
+  auto n = static_cast<uint32_t>(v.rd.file_size - offset);
+  body->resize(at + n);
+  return const_cast<flv::file&>(v.source).read(offset, body->data() + at, n) == n ? 0 : -1;
+}
+
+// what a client of "?start=" receives, written to path
+int32_t served(flv::pseudo_stream const&v, uint32_t ms, std::string const&path){
+  std::vector<uint8_t> body;
+  if (expected_body(v, ms, &body) != 0)
+    return -1;
+  flv::file out;
+  auto length = static_cast<uint32_t>(body.size());
+  return out.create(path.c_str()) == 0 && out.write(0, body.data(), length) == length ? 0 : -1;
+}
+
+// the whole response to a GET of target from 127.0.0.1:port, empty if the connection fails
+std::string http_get(uint16_t port, std::string const&target){
+  std::string response;
+  auto s = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in sa = {};
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+  if (::connect(s, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0){
+    auto request = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if (::send(s, request.c_str(), static_cast<int>(request.size()), 0) == static_cast<int>(request.size())){
+      char buffer[16384];
+      for (;;){
+        auto cb = ::recv(s, buffer, sizeof(buffer), 0);
+        if (cb <= 0)
+          break;
+        response.append(buffer, static_cast<size_t>(cb));
+      }
+    }
+  }
+  close_socket(s);
+  return response;
+}
+}
+
+FLV_TEST(pseudo_stream_whole_file_before_second_keyframe){
+  auto path = sample_file();
+  flv::pseudo_stream v;
+  FLV_CHECK(v.open(path.c_str()) == 0);
+  std::vector<uint8_t> prefix;
+  uint64_t offset = 1;
+  FLV_CHECK(v.seek(0, &prefix, &offset) == 0 && prefix.empty() && offset == 0);
+  FLV_CHECK(v.seek(999, &prefix, &offset) == 0 && prefix.empty() && offset == 0);
+  v.source.close();
+  flv::test::remove_file(path);
+}
+
+FLV_TEST(pseudo_stream_meta_describes_served_range){
+  auto path = sample_file();
+  auto clip = flv::test::temp_path("pseudo_stream_served.flv");
+  flv::pseudo_stream v;
+  FLV_CHECK(v.open(path.c_str()) == 0);
+  FLV_CHECK(served(v, 4500, clip) == 0);
+
+  flv::file f;
+  FLV_CHECK(f.open(clip.c_str()) == 0);
+  auto rd = flv::reader(&f);
+  FLV_CHECK(rd.open() == 0);
+  FLV_CHECK(rd.meta.filesize == rd.file_size);
+  FLV_CHECK(rd.meta.last_timestamp + 4000 + 1 >= v.last_timestamp && rd.meta.last_timestamp + 4000 <= v.last_timestamp);
+  auto&k = rd.meta.keyframes;
+  FLV_CHECK(k.positions.size() == 6 && k.times.size() == 6);
+  for (size_t i = 0; i < k.positions.size(); ++i){
+    FLV_CHECK(k.times[i] == i * 1000 * 10000);
+    flv::raw_tag t;
+    FLV_CHECK(rd.read_tag(k.positions[i], &t) == 0);
+    FLV_CHECK(t.type == flv::tag_type::video && t.keyframe() && !t.sequence_header());
+    FLV_CHECK(t.timestamp == 4000 + i * 1000);  // tags keep their source timestamps
+  }
+  FLV_CHECK(rd.avc_tag.type == flv::tag_type::video && rd.avc_tag.timestamp == 4000);
+  f.close();
+  v.source.close();
+  flv::test::remove_file(clip);
+  flv::test::remove_file(path);
+}
+
+// the server over loopback sends what pseudo_stream::seek describes
+FLV_TEST(pseudo_server_serves_prefix_and_file_range){
+  auto path = sample_file();
+  flv::pseudo_server server;
+  FLV_CHECK(server.listen("127.0.0.1", 0) == 0 && server.bound_port != 0);
+  std::thread accepting([&server]{ server.run(); });
+  auto response = http_get(server.bound_port, "/" + path + "?start=4.5");
+  auto missing = http_get(server.bound_port, "/missing.flv");
+  server.stop();
+  accepting.join();
+
+  auto head_end = response.find("\r\n\r\n");
+  FLV_CHECK(response.compare(0, 15, "HTTP/1.1 200 OK") == 0 && head_end != std::string::npos);
+  if (head_end == std::string::npos)
+    return;
+  auto body = response.substr(head_end + 4);
+  auto length = response.find("Content-Length: ");
+  FLV_CHECK(length < head_end && strtoull(response.c_str() + length + 16, nullptr, 10) == body.size());
+
+  flv::pseudo_stream v;
+  FLV_CHECK(v.open(path.c_str()) == 0);
+  std::vector<uint8_t> expected;
+  FLV_CHECK(expected_body(v, 4500, &expected) == 0);
+  FLV_CHECK(body.size() == expected.size() && memcmp(body.data(), expected.data(), body.size()) == 0);
+  FLV_CHECK(body.size() < v.rd.file_size);  // seeked, not the whole file
+  FLV_CHECK(missing.compare(0, 22, "HTTP/1.1 404 Not Found") == 0);
+  v.source.close();
+  flv::test::remove_file(path);
+}
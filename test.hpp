@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// tests of the portable flv code, built into FlvTests.exe by FlvTests.vcxproj.
+// a test is a function registered with FLV_TEST, FLV_CHECK records a failure and goes on
+namespace flv{
+namespace test{
+typedef void(*test_function)();
+
+struct registrar{
+  registrar(char const*name, test_function fn);
+};
+
+void     fail(char const*file, int line, char const*expression);
+uint32_t failures();
+// a file name in the working directory unique to this run, removed by remove_file
+std::string temp_path(char const*name);
+void        remove_file(std::string const&path);
+}
+}
+
+#define FLV_TEST(name) \
+  static void name(); \
+  static flv::test::registrar name##_registrar(#name, &name); \
+  static void name()
+
+#define FLV_CHECK(e) do{ if (!(e)) flv::test::fail(__FILE__, __LINE__, #e); }while (0)
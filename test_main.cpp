@@ -0,0 +1,65 @@
+#include "test.hpp"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace{
+struct registered{
+  char const                *name;
+  flv::test::test_function   fn;
+};
+
+// filled by static registrars before main runs
+std::vector<registered>&tests(){
+  static std::vector<registered> v;
+  return v;
+}
+uint32_t failed = 0;
+}
+
+flv::test::registrar::registrar(char const*name, test_function fn){
+  registered t = { name, fn };
+  tests().push_back(t);
+}
+
+void flv::test::fail(char const*file, int line, char const*expression){
+  ++failed;
+  fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+}
+
+uint32_t flv::test::failures(){
+  return failed;
+}
+
+std::string flv::test::temp_path(char const*name){
+  char pid[32];
+  sprintf(pid, "%d", static_cast<int>(getpid()));
+  return std::string("flv_test_") + pid + "_" + name;
+}
+
+void flv::test::remove_file(std::string const&path){
+  ::remove(path.c_str());
+}
+
+// FlvTests [name...]: runs the named tests, every test without names. returns the number of failed tests
+int main(int argc, char**argv){
+  int failed_tests = 0;
+  for (auto&t : tests()){
+    bool selected = argc < 2;
+    for (int i = 1; i < argc && !selected; ++i)
+      selected = strcmp(argv[i], t.name) == 0;
+    if (!selected)
+      continue;
+    auto before = failed;
+    t.fn();
+    printf("%s %s\n", failed == before ? "ok  " : "FAIL", t.name);
+    failed_tests += failed == before ? 0 : 1;
+  }
+  return failed_tests;
+}
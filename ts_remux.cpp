@@ -0,0 +1,344 @@
+#include "ts_remux.hpp"
+#include <algorithm>
+#include <cstring>
+
+const static uint32_t ts_block_size    = 1 << 20;
+const static uint32_t ts_payload       = flv::ts_packet_length - 4;
+const static uint64_t ts_delay         = 100 * 90;  // pts and dts run 100ms ahead of pcr, 90kHz
+const static uint8_t  ts_stream_avc    = 0x1b;
+const static uint8_t  ts_stream_aac    = 0x0f;
+const static uint8_t  start_code[]     = { 0, 0, 0, 1 };
+const static uint8_t  access_unit[]    = { 0, 0, 0, 1, 0x09, 0xf0 };  // access unit delimiter, any slice type
+
+namespace{
+// crc32 of iso 13818-1 annex b, msb first
+uint32_t crc32(uint8_t const*data, uint32_t length){
+  uint32_t crc = 0xffffffff;
+  for (uint32_t i = 0; i < length; ++i){
+    crc ^= uint32_t(data[i]) << 24;
+    for (int k = 0; k < 8; ++k)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+  return crc;
+}
+
+// psi section in one packet, stuffed with 0xff
+void psi(uint8_t*p, uint16_t pid, uint8_t const*section, uint32_t length){
+  memset(p, 0xff, flv::ts_packet_length);
+  p[0] = 0x47;
+  p[1] = uint8_t(0x40 | (pid >> 8));  // payload_unit_start_indicator
+  p[2] = uint8_t(pid);
+  p[3] = 0x10;  // payload only, continuity counter set when sent
+  p[4] = 0;     // pointer_field
+  memcpy(p + 5, section, length);
+  auto crc = crc32(section, length);
+  bigendian::binary_writer(p + 5 + length, 4).ui32(crc);
+}
+
+void timestamp(uint8_t*p, uint8_t prefix, uint64_t v){
+  p[0] = uint8_t(prefix << 4 | ((v >> 29) & 0x0e) | 1);
+  p[1] = uint8_t(v >> 22);
+  p[2] = uint8_t(((v >> 14) & 0xfe) | 1);
+  p[3] = uint8_t(v >> 7);
+  p[4] = uint8_t(((v << 1) & 0xfe) | 1);
+}
+
+struct file_sink : public flv::ts_sink{
+  explicit file_sink(flv::file&f) : out(f){}
+  int32_t write(uint8_t const*packets, uint32_t length) override{
+    if (out.write(pos, packets, length) != length)
+      return -1;
+    pos += length;
+    return 0;
+  }
+  flv::file&out;
+  uint64_t  pos = 0;
+};
+}
+
+flv::ts_remuxer::ts_remuxer(byte_source*src)
+  : rd(src), ring(ts_ring_packets * ts_packet_length), block(ts_block_size){
+  memset(continuity, 0, sizeof(continuity));
+  chunks.reserve(64);
+}
+
+int32_t flv::ts_remuxer::open(){
+  if (rd.open() != 0)
+    return -1;
+  auto&avc = rd.avc_sequence_header;
+  auto&aac = rd.aac_sequence_header;
+  const uint32_t avc_head = flv_video_header_length + flv_avc_packet_type_length;
+  const uint32_t aac_head = flv_audio_header_length + flv_aac_packet_type_length;
+  if (rd.avc_tag.type != flv::tag_type::eof && avc.length > avc_head + 6){
+    avcc = flv::avcc_reader(avc._ + avc_head, avc.length - avc_head).avcc();
+    has_video = !avcc.sps.empty() && !avcc.pps.empty();
+    if (has_video)
+      parameter_sets = avcc.code_private_data();
+  }
+  if (rd.aac_tag.type != flv::tag_type::eof && aac.length >= aac_head + 2)
+    has_audio = flv::audio_specific_config_reader(aac._ + aac_head, aac.length - aac_head).audio_specific_config(&asc) == 0;
+  if (!has_video && !has_audio)
+    return -1;
+
+  uint8_t section[32];
+  bigendian::binary_writer w(section, sizeof(section));
+  w.byte(0);              // table_id, program_association_section
+  w.ui16(0xb000 | 13);    // section_syntax_indicator, section_length
+  w.ui16(1);              // transport_stream_id
+  w.byte(0xc1);           // version 0, current_next_indicator
+  w.byte(0);              // section_number
+  w.byte(0);              // last_section_number
+  w.ui16(1);              // program_number
+  w.ui16(0xe000 | ts_pmt_pid);
+  psi(pat, 0, section, w.pointer);
+
+  auto pcr_pid = has_video ? ts_video_pid : ts_audio_pid;
+  uint16_t length = uint16_t(9 + 5 * (has_video + has_audio) + 4);
+  w.pointer = 0;
+  w.byte(2);              // table_id, ts_program_map_section
+  w.ui16(0xb000 | length);
+  w.ui16(1);              // program_number
+  w.byte(0xc1);
+  w.byte(0);
+  w.byte(0);
+  w.ui16(0xe000 | pcr_pid);
+  w.ui16(0xf000);         // program_info_length
+  if (has_video){
+    w.byte(ts_stream_avc);
+    w.ui16(0xe000 | ts_video_pid);
+    w.ui16(0xf000);
+  }
+  if (has_audio){
+    w.byte(ts_stream_aac);
+    w.ui16(0xe000 | ts_audio_pid);
+    w.ui16(0xf000);
+  }
+  psi(pmt, ts_pmt_pid, section, w.pointer);
+
+  // adts without crc, frame length is filled per frame
+  adts[0] = 0xff;
+  adts[1] = 0xf1;
+  adts[2] = uint8_t(((asc.object_type - 1) & 3) << 6 | (asc.sampling_index & 0x0f) << 2 | ((asc.channels >> 2) & 1));
+  adts[3] = uint8_t((asc.channels & 3) << 6);
+  adts[4] = 0;
+  adts[5] = 0x1f;  // buffer fullness 0x7ff
+  adts[6] = 0xfc;
+  return 0;
+}
+
+uint8_t* flv::ts_remuxer::next_packet(){
+  if (ring_used == ts_ring_packets && flush() != 0)
+    return nullptr;
+  return ring.data() + ts_packet_length * ring_used++;
+}
+
+int32_t flv::ts_remuxer::flush(){
+  if (!ring_used)
+    return 0;
+  auto hr = sink ? sink->write(ring.data(), ring_used * ts_packet_length) : -1;
+  counters.packets += ring_used;
+  ring_used = 0;
+  return hr ? -1 : 0;
+}
+
+int32_t flv::ts_remuxer::tables(){
+  auto p = next_packet();
+  if (!p)
+    return -1;
+  memcpy(p, pat, ts_packet_length);
+  p[3] = uint8_t(0x10 | (pat_continuity++ & 0x0f));
+  if (!(p = next_packet()))
+    return -1;
+  memcpy(p, pmt, ts_packet_length);
+  p[3] = uint8_t(0x10 | (continuity[0]++ & 0x0f));
+  return 0;
+}
+
+// tables before keyframes, and before any frame once the last ones are ts_table_interval old.
+// a dts before the last tables, a range remuxed out of order, counts as due
+int32_t flv::ts_remuxer::repeat_tables(bool keyframe, uint64_t dts){
+  if (!keyframe && tables_sent && dts >= tables_at && dts - tables_at < ts_table_interval)
+    return 0;
+  tables_sent = true;
+  tables_at = dts;
+  return tables();
+}
+
+// header then chunks, split into packets. the first packet may carry pcr,
+// the last one is stuffed through the adaptation field
+int32_t flv::ts_remuxer::pes(uint16_t pid, uint8_t&cc, uint8_t const*header, uint32_t header_length, bool pcr, uint64_t pcr_base){
+  uint32_t left = header_length;
+  for (auto&c : chunks)
+    left += c.length;
+  uint32_t written = 0;  // of header
+  size_t ci = 0;
+  uint32_t co = 0;       // offset in chunks[ci]
+  for (auto first = true; left; first = false){
+    auto p = next_packet();
+    if (!p)
+      return -1;
+    uint32_t af = (first && pcr) ? 8 : 0;  // adaptation_field_length, flags and pcr
+    uint32_t room = ts_payload - af;
+    if (left < room){
+      af += room - left;
+      room = left;
+    }
+    p[0] = 0x47;
+    p[1] = uint8_t((first ? 0x40 : 0) | (pid >> 8));
+    p[2] = uint8_t(pid);
+    p[3] = uint8_t((af ? 0x30 : 0x10) | (cc++ & 0x0f));
+    auto q = p + 4;
+    if (af){
+      q[0] = uint8_t(af - 1);
+      if (af > 1){
+        uint32_t k = 2;
+        q[1] = (first && pcr) ? 0x10 : 0;  // pcr_flag
+        if (first && pcr){
+          q[2] = uint8_t(pcr_base >> 25);
+          q[3] = uint8_t(pcr_base >> 17);
+          q[4] = uint8_t(pcr_base >> 9);
+          q[5] = uint8_t(pcr_base >> 1);
+          q[6] = uint8_t((pcr_base & 1) << 7 | 0x7e);  // reserved, extension 0
+          q[7] = 0;
+          k = 8;
+        }
+        memset(q + k, 0xff, af - k);
+      }
+      q += af;
+    }
+    left -= room;
+    if (written < header_length){
+      auto n = std::min(room, header_length - written);
+      memcpy(q, header + written, n);
+      written += n;
+      q += n;
+      room -= n;
+    }
+    while (room){
+      auto n = std::min(room, chunks[ci].length - co);
+      memcpy(q, chunks[ci].data + co, n);
+      q += n;
+      room -= n;
+      co += n;
+      if (co == chunks[ci].length){
+        ++ci;
+        co = 0;
+      }
+    }
+  }
+  ++counters.frames;
+  return 0;
+}
+
+// length prefixed nal units to annex-b, parameter sets in front of keyframes
+int32_t flv::ts_remuxer::video_frame(raw_tag const&t, uint8_t const*data){
+  const uint32_t head = flv_video_header_length + flv_avc_packet_type_length;
+  auto cts = int32_t(bigendian::touint24(data + 2) << 8) >> 8;  // si24
+  auto payload = data + head;
+  auto length = t.data_size - head;
+  auto key = t.keyframe();
+  if (repeat_tables(key, uint64_t(t.timestamp) * 90) != 0)
+    return -1;
+  chunks.clear();
+  chunks.push_back(chunk{ access_unit, sizeof(access_unit) });
+  if (key)
+    chunks.push_back(chunk{ parameter_sets._, parameter_sets.length });
+  uint32_t nal = avcc.nal ? avcc.nal : 4;
+  for (uint32_t p = 0; p + nal <= length;){
+    uint32_t l = 0;
+    for (uint32_t i = 0; i < nal; ++i)
+      l = (l << 8) | payload[p + i];
+    p += nal;
+    if (l == 0 || p + l > length)
+      break;
+    if ((payload[p] & 0x1f) != 9){  // the stream's own delimiters are replaced
+      chunks.push_back(chunk{ start_code, sizeof(start_code) });
+      chunks.push_back(chunk{ payload + p, l });
+    }
+    p += l;
+  }
+  auto dts = uint64_t(t.timestamp) * 90 + ts_delay;
+  auto pts = uint64_t(int64_t(dts) + int64_t(cts) * 90);
+  uint8_t header[19] = { 0, 0, 1, 0xe0, 0, 0, 0x80 };  // PES_packet_length 0, unbounded
+  header[7] = cts ? 0xc0 : 0x80;
+  header[8] = cts ? 10 : 5;
+  timestamp(header + 9, cts ? 3 : 2, pts);
+  if (cts)
+    timestamp(header + 14, 1, dts);
+  return pes(ts_video_pid, continuity[1], header, 9 + header[8], true, dts - ts_delay);
+}
+
+int32_t flv::ts_remuxer::audio_frame(raw_tag const&t, uint8_t const*data){
+  const uint32_t head = flv_audio_header_length + flv_aac_packet_type_length;
+  auto length = t.data_size - head;
+  uint8_t frame_header[sizeof(adts)];
+  memcpy(frame_header, adts, sizeof(adts));
+  auto frame_length = length + sizeof(adts);
+  frame_header[3] = uint8_t(frame_header[3] | ((frame_length >> 11) & 3));
+  frame_header[4] = uint8_t(frame_length >> 3);
+  frame_header[5] = uint8_t((frame_length & 7) << 5 | 0x1f);
+  if (repeat_tables(false, uint64_t(t.timestamp) * 90) != 0)
+    return -1;
+  chunks.clear();
+  chunks.push_back(chunk{ frame_header, sizeof(frame_header) });
+  chunks.push_back(chunk{ data + head, length });
+  auto pts = uint64_t(t.timestamp) * 90 + ts_delay;
+  auto pes_length = 3 + 5 + frame_length;
+  uint8_t header[14] = { 0, 0, 1, 0xc0, uint8_t(pes_length > 0xffff ? 0 : pes_length >> 8), uint8_t(pes_length > 0xffff ? 0 : pes_length), 0x80, 0x80, 5 };
+  timestamp(header + 9, 2, pts);
+  return pes(ts_audio_pid, continuity[2], header, sizeof(header), !has_video, pts - ts_delay);
+}
+
+int32_t flv::ts_remuxer::remux_range(uint64_t from, uint64_t to, ts_sink*out){
+  sink = out;
+  uint64_t block_pos = from;
+  uint32_t block_len = 0;
+  raw_tag t;
+  for (auto pos = from; pos < to; pos = t.next()){
+    // the whole tag data must be in the block, nothing past to is read
+    if (pos + flv_tag_header_length > block_pos + block_len){
+      auto cb = rd.source->read(pos, block.data(), static_cast<uint32_t>(std::min<uint64_t>(block.size(), to - pos)));
+      if (cb < 0)
+        return -1;
+      block_pos = pos;
+      block_len = static_cast<uint32_t>(cb);
+      if (block_len < flv_tag_header_length)
+        break;
+    }
+    decode_raw_tag(block.data() + (pos - block_pos), static_cast<uint32_t>(block_pos + block_len - pos), pos, &t);
+    if (t.data_offset() + t.data_size > block_pos + block_len){
+      if (t.data_offset() + t.data_size > std::min(to, rd.file_size))
+        break;  // incomplete tag at the end of a recording
+      if (block.size() < flv_tag_header_length + t.data_size)
+        block.resize(flv_tag_header_length + t.data_size);
+      auto length = static_cast<uint32_t>(std::min<uint64_t>(block.size(), to - pos));
+      if (rd.source->read(pos, block.data(), length) != length)
+        return -1;
+      block_pos = pos;
+      block_len = length;
+    }
+    auto data = block.data() + (t.data_offset() - block_pos);
+    int32_t hr = 0;
+    if (has_video && t.is_avc() && t.codec[1] == uint8_t(flv::avc_packet_type::avc_nalu) && t.data_size > flv_video_header_length + flv_avc_packet_type_length)
+      hr = video_frame(t, data);
+    else if (has_audio && t.is_aac() && t.codec[1] == uint8_t(flv::aac_packet_type::aac_raw) && t.data_size > flv_audio_header_length + flv_aac_packet_type_length)
+      hr = audio_frame(t, data);
+    if (hr)
+      return -1;
+  }
+  return 0;
+}
+
+int32_t flv::ts_remuxer::remux(file&out, ts_result*r){
+  auto s = file_sink(out);
+  sink = &s;
+  auto hr = tables() == 0 && remux_range(rd.first_media_tag, rd.file_size, &s) == 0 && flush() == 0 ? 0 : -1;
+  sink = nullptr;  // s is gone after this call, packets left by a failure are dropped with it
+  if (hr){
+    ring_used = 0;
+    return -1;
+  }
+  if (r)
+    *r = counters;
+  return 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "avcc.hpp"
+#include "aac.hpp"
+#include "flv_reader.hpp"
+#include "file_io.hpp"
+
+namespace flv{
+const static uint32_t ts_packet_length = 188;
+const static uint32_t ts_ring_packets  = 512;    // packets buffered before the sink sees them
+const static uint16_t ts_pmt_pid       = 0x1000;
+const static uint16_t ts_video_pid     = 0x100;
+const static uint16_t ts_audio_pid     = 0x101;
+const static uint64_t ts_table_interval = 100 * 90;  // PAT and PMT are repeated at least this often, 90kHz
+
+// receives remuxed output, whole packets from ts_remuxer
+struct ts_sink{
+  virtual ~ts_sink() = default;
+  virtual int32_t write(uint8_t const*packets, uint32_t length) = 0;  // 0: ok, nonzero aborts
+};
+
+struct ts_result{
+  uint32_t frames  = 0;
+  uint64_t packets = 0;
+};
+
+// remuxes avc and aac of a flv file into mpeg-ts.
+// avc becomes annex-b with sps/pps in front of keyframes, aac gets adts headers.
+// PAT and PMT go in front of keyframes and every ts_table_interval in between.
+// packets are built in a preallocated ring from header templates,
+// frames are gathered from the source block without being copied before packetization
+struct ts_remuxer{
+  explicit ts_remuxer(byte_source*src);
+  ts_remuxer(ts_remuxer const&) = delete;
+
+  int32_t open();                                       // 0: ok, -1: not flv or neither avc nor aac
+  int32_t tables();                                     // PAT and PMT now
+  // remuxes tags starting in [from, to), from must be a tag header
+  int32_t remux_range(uint64_t from, uint64_t to, ts_sink*out);
+  int32_t remux(file&out, ts_result*r);                 // tables and every tag
+  int32_t flush();                                      // hands buffered packets to the sink
+
+  struct chunk{
+    uint8_t const*data;
+    uint32_t      length;
+  };
+
+  flv::reader                rd;
+  flv::avcc                  avcc;
+  flv::audio_specific_config asc;
+  bool                       has_video = false;
+  bool                       has_audio = false;
+  packet                     parameter_sets;  // annex-b sps and pps
+  uint8_t                    pat[ts_packet_length];
+  uint8_t                    pmt[ts_packet_length];
+  uint8_t                    adts[7];         // template, frame length patched per frame
+  uint8_t                    continuity[3];   // pmt, video, audio, pat has its own
+  uint8_t                    pat_continuity = 0;
+  bool                       tables_sent = false;
+  uint64_t                   tables_at   = 0;  // dts of the last PAT and PMT sent with a frame
+  ts_result                  counters;
+
+  ts_sink                   *sink = nullptr;
+  std::vector<uint8_t>       ring;            // ts_ring_packets packets
+  uint32_t                   ring_used = 0;
+  std::vector<uint8_t>       block;           // source bytes, grows only for tags larger than it
+  std::vector<chunk>         chunks;          // gathered frame of the current pes
+
+  uint8_t *next_packet();
+  int32_t  repeat_tables(bool keyframe, uint64_t dts);
+  int32_t  pes(uint16_t pid, uint8_t&cc, uint8_t const*header, uint32_t header_length, bool pcr, uint64_t pcr_base);
+  int32_t  video_frame(raw_tag const&t, uint8_t const*data);
+  int32_t  audio_frame(raw_tag const&t, uint8_t const*data);
+};
+}
@@ -0,0 +1,162 @@
+#include "ts_remux.hpp"
+#include <map>
+#include <string>
+#include <vector>
+#include "flv_synth.hpp"
+#include "test.hpp"
+
+namespace{
+std::vector<uint8_t> read_file(std::string const&path){
+  std::vector<uint8_t> v;
+  flv::file f;
+  uint64_t size = 0;
+  if (f.open(path.c_str()) == 0 && f.size(&size) == 0){
+    v.resize(static_cast<size_t>(size));
+    if (f.read(0, v.data(), static_cast<uint32_t>(size)) != int64_t(size))
+      v.clear();
+  }
+  return v;
+}
+
+uint64_t timestamp(uint8_t const*p){
+  return (uint64_t((p[0] >> 1) & 7) << 30) | (uint64_t(p[1]) << 22) | (uint64_t(p[2] >> 1) << 15) | (uint64_t(p[3]) << 7) | (p[4] >> 1);
+}
+
+// a pes put together from its packets
+struct pes_packet{
+  uint16_t             pid;
+  std::vector<uint8_t> data;
+  uint64_t             dts()const{ return timestamp(data.data() + ((data[7] & 0x40) ? 14 : 9)); }
+};
+}
+
+FLV_TEST(ts_packets_tables_and_adts){
+  auto path = flv::test::temp_path("ts.flv");
+  auto ts = flv::test::temp_path("ts.ts");
+  flv::synth_options o;
+  o.duration_ms = 5000;
+  o.width = 320;
+  o.height = 240;
+  o.gop_frames = 25;
+  flv::synth_result sr;
+  FLV_CHECK(flv::synthesize(path.c_str(), o, &sr) == 0);
+
+  // raw aac frames of the source, in file order
+  flv::file in;
+  FLV_CHECK(in.open(path.c_str()) == 0);
+  std::vector<uint32_t> aac_sizes;
+  {
+    auto rd = flv::reader(&in);
+    FLV_CHECK(rd.open() == 0);
+    flv::raw_tag t;
+    for (auto pos = rd.first_media_tag; rd.read_tag(pos, &t) == 0; pos = t.next()){
+      if (t.is_aac() && !t.sequence_header())
+        aac_sizes.push_back(t.data_size - 2);
+    }
+  }
+  FLV_CHECK(aac_sizes.size() == sr.audio_frames);
+
+  flv::ts_remuxer m(&in);
+  FLV_CHECK(m.open() == 0 && m.has_video && m.has_audio);
+  flv::ts_result r;
+  {
+    flv::file out;
+    FLV_CHECK(out.create(ts.c_str()) == 0);
+    FLV_CHECK(m.remux(out, &r) == 0);
+    FLV_CHECK(m.sink == nullptr);
+  }
+  FLV_CHECK(r.frames == sr.video_frames + sr.audio_frames);
+  auto d = read_file(ts);
+  FLV_CHECK(!d.empty() && d.size() % flv::ts_packet_length == 0 && d.size() / flv::ts_packet_length == r.packets);
+
+  std::map<uint16_t, uint8_t> continuity;
+  std::map<uint16_t, pes_packet> open;
+  std::vector<pes_packet> done;
+  bool synced = true, counted = true;
+  uint32_t pats = 0, pmts = 0;
+  int64_t tables_at = -1;   // dts of the first pes after the last PAT, 90kHz
+  bool table_pending = false, spaced = true;
+  for (size_t at = 0; at + flv::ts_packet_length <= d.size(); at += flv::ts_packet_length){
+    auto p = d.data() + at;
+    synced = synced && p[0] == 0x47;
+    uint16_t pid = uint16_t((p[1] & 0x1f) << 8 | p[2]);
+    bool start = (p[1] & 0x40) != 0;
+    auto afc = (p[3] >> 4) & 3;
+    auto cc = uint8_t(p[3] & 0x0f);
+    if (afc & 1){
+      auto i = continuity.find(pid);
+      counted = counted && (i == continuity.end() || cc == ((i->second + 1) & 0x0f));
+      continuity[pid] = cc;
+    }
+    if (pid == 0){
+      ++pats;
+      table_pending = true;
+      continue;
+    }
+    if (pid == flv::ts_pmt_pid){
+      ++pmts;
+      continue;
+    }
+    size_t payload = 4 + ((afc & 2) ? 1 + p[4] : 0);
+    if (start){
+      if (open.count(pid))
+        done.push_back(open[pid]);
+      open[pid] = pes_packet{ pid, std::vector<uint8_t>() };
+      std::vector<uint8_t> head(p + payload, p + flv::ts_packet_length);
+      auto dts = int64_t(pes_packet{ pid, head }.dts());
+      // tables go out at least every 100ms of dts
+      if (table_pending)
+        tables_at = dts;
+      spaced = spaced && tables_at >= 0 && dts - tables_at < 100 * 90;
+      table_pending = false;
+    }
+    auto&v = open[pid].data;
+    v.insert(v.end(), p + payload, p + flv::ts_packet_length);
+  }
+  for (auto&v : open)
+    done.push_back(v.second);
+  FLV_CHECK(synced && counted && spaced);
+  FLV_CHECK(pats == pmts && pats >= sr.keyframes);
+
+  // every audio pes holds one adts frame as long as its source frame
+  size_t a = 0, video = 0;
+  bool adts = true;
+  for (auto&v : done){
+    if (v.pid == flv::ts_video_pid){
+      ++video;
+      continue;
+    }
+    if (v.pid != flv::ts_audio_pid || v.data.size() < 14 + 7)
+      continue;
+    auto h = v.data.data() + 14;
+    uint32_t frame_length = (uint32_t(h[3] & 3) << 11) | (uint32_t(h[4]) << 3) | (h[5] >> 5);
+    uint32_t pes_length = uint32_t(v.data[4]) << 8 | v.data[5];
+    adts = adts && h[0] == 0xff && (h[1] & 0xf6) == 0xf0 && a < aac_sizes.size()
+      && frame_length == aac_sizes[a] + 7 && pes_length == 8 + frame_length && v.data.size() == 14 + frame_length;
+    ++a;
+  }
+  FLV_CHECK(adts && a == aac_sizes.size() && video == sr.video_frames);
+  in.close();
+  flv::test::remove_file(ts);
+  flv::test::remove_file(path);
+}
+
+// a sink that fails leaves the remuxer without a sink pointing at the stack
+FLV_TEST(ts_remux_failure_resets_the_sink){
+  auto path = flv::test::temp_path("ts_fail.flv");
+  flv::synth_options o;
+  o.duration_ms = 2000;
+  o.width = 320;
+  o.height = 240;
+  flv::synth_result sr;
+  FLV_CHECK(flv::synthesize(path.c_str(), o, &sr) == 0);
+  flv::file in, read_only;
+  FLV_CHECK(in.open(path.c_str()) == 0 && read_only.open(path.c_str()) == 0);
+  flv::ts_remuxer m(&in);
+  FLV_CHECK(m.open() == 0);
+  FLV_CHECK(m.remux(read_only, nullptr) == -1);
+  FLV_CHECK(m.sink == nullptr && m.ring_used == 0);
+  in.close();
+  read_only.close();
+  flv::test::remove_file(path);
+}